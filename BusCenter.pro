@@ -1,29 +1,21 @@
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    mainwindow.h
-
-FORMS += \
-    mainwindow.ui
-
-TRANSLATIONS += \
-    BusCenter_zh_CN.ts
-CONFIG += lrelease
-CONFIG += embed_translations
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+TEMPLATE = subdirs
+
+# core: 查询引擎静态库（不依赖界面）
+# app:  图形界面 BusCenter
+# cli:  命令行查询工具 busrouter-cli
+# bench: 性能基准 busrouter-bench
+# citygen: 合成线网生成器 busrouter-citygen
+# server: 查询服务 busrouter-server
+SUBDIRS += \
+    core \
+    app \
+    cli \
+    bench \
+    citygen \
+    server
+
+app.depends = core
+cli.depends = core
+bench.depends = core
+citygen.depends = core
+server.depends = core
@@ -12,29 +12,110 @@
 #include <QMessageBox>
 #include <QMenu>
 #include <QApplication>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QFileDialog>
 #include <QFile>
 #include <QDialog>
 #include <QTimeEdit>
+#include <QCheckBox>
 #include <QScrollArea>
 #include <QIntValidator>
-
-struct TripOption {
-    enum Type { Direct, Transfer1, Transfer2 };
-    Type type;
-    int totalTime = 0;
-    QString summary;
-    QString html;
-};
+#include <QStatusBar>
+#include <QTimer>
+#include <QProgressDialog>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QScopeGuard>
+#include <QThread>
+#include "routeio.h"
+#include "routeimporter.h"
+#include "networksnapshot.h"
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
+    setupMetrics();
+    patternPool.setMaxThreadCount(1);
+    patternPool.setThreadPriority(QThread::LowestPriority);
     loadMockData();
     setupUI();
     stackedWidget->setCurrentWidget(loginPage);
+    connect(this, &MainWindow::searchFinished, this, &MainWindow::onSearchFinished);
+
+    // 修改不多时日志也不会一直攒着：定期在后台压缩进数据文件
+    auto compactTimer = new QTimer(this);
+    compactTimer->setInterval(COMPACT_INTERVAL_MS);
+    connect(compactTimer, &QTimer::timeout, this, [this] {
+        if (journal.records() > 0) compactJournal();
+    });
+    compactTimer->start();
+}
+
+MainWindow::~MainWindow()
+{
+    // 后台查询会向本对象发信号，析构前先让它们结束
+    cancelSearch();
+    if (activeImport) activeImport->cancel();
+    if (activePatterns) activePatterns->cancel();
+    searchPool.waitForDone();
+    patternPool.waitForDone();
+    // 日志里还有没写回的修改时当场压缩，其他只读数据文件的程序下次就能直接用上
+    if (journal.records() > 0 || compactAgain) saveRoutesToFile();
+    flushMetrics();
+}
+
+void MainWindow::setupMetrics()
+{
+    const QString seconds = "耗时（秒）";
+    meters.searchTopK = metrics.histogram("busrouter_search_seconds", "查询" + seconds + "，含生成结果 HTML",
+                                          "kind=\"topk\"");
+    meters.searchAt = metrics.histogram("busrouter_search_seconds", "", "kind=\"at\"");
+    meters.searchCancelled = metrics.counter("busrouter_search_cancelled_total", "被新查询或修改条件取消的查询数");
+    meters.searchEmpty = metrics.counter("busrouter_search_empty_total", "没有找到可行方案的查询数");
+    meters.cacheHits = metrics.counter("busrouter_query_cache_hits_total", "查询结果缓存命中数");
+    meters.cacheMisses = metrics.counter("busrouter_query_cache_misses_total", "查询结果缓存未命中数");
+    meters.cacheInvalidated = metrics.counter("busrouter_query_cache_invalidated_total", "因线路变化淘汰的缓存条目数");
+    meters.cacheDisplaced = metrics.counter("busrouter_query_cache_displaced_total", "因容量不足挤出的缓存条目数");
+    meters.cacheEntries = metrics.gauge("busrouter_query_cache_entries", "查询结果缓存当前条目数");
+    meters.routeLookup = metrics.histogram("busrouter_route_lookup_seconds", "按编号查看线路详情的" + seconds);
+    meters.loadSnapshot = metrics.histogram("busrouter_load_seconds", "启动时读入线路数据的" + seconds,
+                                            "source=\"snapshot\"");
+    meters.loadJson = metrics.histogram("busrouter_load_seconds", "", "source=\"json\"");
+    meters.importTime = metrics.histogram("busrouter_import_seconds", "导入线路文件（解析与建网）的" + seconds);
+    meters.importedRoutes = metrics.counter("busrouter_imported_routes_total", "导入的线路条数");
+    meters.importErrors = metrics.counter("busrouter_import_errors_total", "导入时跳过的有问题线路条数");
+    meters.saveTime = metrics.histogram("busrouter_save_seconds", "整体写回线路数据与快照的" + seconds);
+    meters.saveFailures = metrics.counter("busrouter_save_failures_total", "写回线路数据失败次数");
+    meters.routeCount = metrics.gauge("busrouter_routes", "当前线路条数");
+    meters.stopCount = metrics.gauge("busrouter_stops", "当前有线路经过的站点数");
+
+    // 无人值守的终端上由 node_exporter 之类的采集程序定期读取这个文件
+    metricsFile = qEnvironmentVariable(METRICS_FILE_ENV);
+    if (metricsFile.isEmpty()) return;
+    auto timer = new QTimer(this);
+    timer->setInterval(METRICS_FLUSH_MS);
+    connect(timer, &QTimer::timeout, this, &MainWindow::flushMetrics);
+    timer->start();
+}
+
+// 同步由其他对象自己统计的值，再整体写出；在界面线程调用
+void MainWindow::flushMetrics()
+{
+    if (metricsFile.isEmpty()) return;
+    // 缓存的统计本身只增不减，按差额补到计数器上
+    const QueryCacheStats st = planCache.stats();
+    meters.cacheHits->add(st.hits - meters.cacheHits->load());
+    meters.cacheMisses->add(st.misses - meters.cacheMisses->load());
+    meters.cacheInvalidated->add(st.invalidated - meters.cacheInvalidated->load());
+    meters.cacheDisplaced->add(st.displaced - meters.cacheDisplaced->load());
+    meters.cacheEntries->set(st.size);
+
+    const BusNetwork& net = engine.network();
+    int liveStops = 0;
+    for (int s = 0; s < net.stopCount(); ++s)
+        if (net.stopInUse(StopId(s))) ++liveStops;
+    meters.routeCount->set(routes.size());
+    meters.stopCount->set(liveStops);
+
+    metrics.writeTo(metricsFile);
 }
 
 void MainWindow::loadMockData()
@@ -54,100 +135,221 @@ void MainWindow::loadMockData()
 
 void MainWindow::saveRoutesToFile()
 {
-    QJsonArray root;
-    for (const auto &r : std::as_const(routes)) {
-        QJsonObject obj;
-        obj["id"] = r.id;
-        obj["name"] = r.name;
-        QJsonArray stops;
-        for (const auto &s : r.stops) stops.append(s);
-        obj["stops"] = stops;
-
-        QJsonArray times;
-        for (int t : r.travelTimes) times.append(t);
-        obj["travelTimes"] = times;
-
-        obj["firstBus"] = r.firstBus.toString("HH:mm");
-        obj["lastBus"] = r.lastBus.toString("HH:mm");
-
-        root.append(obj);
+    // 整体写回：调用前 engine 已按 routes 重建，快照与写出的 JSON 对应；日志随之清空
+    QElapsedTimer timer;
+    timer.start();
+    if (!journal.compact(journal.beginCompaction(), routes, engine.network())) meters.saveFailures->add();
+    meters.saveTime->observe(timer.nsecsElapsed());
+}
+
+void MainWindow::recordPut(const Route& route)
+{
+    // 数据文件还不存在时日志无处依附，直接整体保存
+    if (!QFile::exists(SAVE_FILE) || !journal.appendPut(route)) {
+        saveRoutesToFile();
+        return;
+    }
+    if (journal.records() >= RouteJournal::COMPACT_RECORDS) compactJournal();
+}
+
+void MainWindow::recordRemove(const QString& id)
+{
+    if (!QFile::exists(SAVE_FILE) || !journal.appendRemove(id)) {
+        saveRoutesToFile();
+        return;
     }
-    QJsonDocument doc(root);
-    QFile file(SAVE_FILE);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    if (journal.records() >= RouteJournal::COMPACT_RECORDS) compactJournal();
+}
+
+void MainWindow::compactJournal()
+{
+    // 正在写回时记下来，等它结束再压缩一次（如导入的线路不经过日志，不能漏写）
+    if (compacting) {
+        compactAgain = true;
+        return;
     }
+    compacting = true;
+    // 线路与线网都是隐式共享的副本，后台写出期间界面可以继续修改，新的修改进新日志
+    const quint64 generation = journal.beginCompaction();
+    searchPool.start([this, generation, snapshot = routes, net = engine.network()] {
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = journal.compact(generation, snapshot, net);
+        meters.saveTime->observe(timer.nsecsElapsed());
+        if (!ok) meters.saveFailures->add();
+        QMetaObject::invokeMethod(this, [this, ok] {
+            compacting = false;
+            if (!ok) statusBar()->showMessage("写回线路数据失败，修改仍保存在日志中", 5000);
+            if (compactAgain) {
+                compactAgain = false;
+                compactJournal();
+            }
+        }, Qt::QueuedConnection);
+    });
 }
 
-void MainWindow::loadRoutesFromFile()
+// 后台核查修改过的线路影响了哪些起点，再补算查询过、还没有有效换乘模式的起点和受修改影响的起点。
+// 重建线网后先读入数据文件旁边保存的那份，算出新的起点后写回。
+// 算完时线网又变过就丢弃结果重来；正在计算时再次调用只取消它，由它结束时重新发起
+void MainWindow::refreshTransferPatterns()
 {
-    QFile file(SAVE_FILE);
-    if (!file.open(QIODevice::ReadOnly)) {
-        // 如果文件不存在，可以保留空 routes
-        refreshAllStops();
+    if (activePatterns) {
+        activePatterns->cancel();
         return;
     }
+    const TransferPatterns& current = engine.transferPatterns();
+    const quint64 version = engine.network().version();
+    const bool readFile = current.originCount() == 0 && !current.hasPendingEdits() && patternsReadFor != version;
+    if (!readFile && !current.hasPendingEdits() && current.wantedOrigins(engine.network()).isEmpty()) return;
+    if (readFile) patternsReadFor = version;
+    auto token = std::make_shared<CancelToken>();
+    activePatterns = token;
+    patternPool.start([this, net = engine.network(), refreshed = current, version, readFile, token]() mutable {
+        const QString fileName = TransferPatterns::pathFor(SAVE_FILE);
+        if (readFile) refreshed.load(fileName, net);   // 没有或已过期就只算查询过的起点
+        refreshed.settle();
+        const QVector<StopId> wanted = refreshed.wantedOrigins(net);
+        refreshed.merge(TransferPatterns::compute(net, wanted, token.get()));
+        // 写不进去（如只读目录）也不影响本次使用
+        if (!wanted.isEmpty() && !token->isCancelled()) refreshed.save(fileName, net);
+        QMetaObject::invokeMethod(this, [this, refreshed, version, token] {
+            if (activePatterns == token) activePatterns.reset();
+            engine.mergeTransferPatterns(refreshed, version);
+            refreshTransferPatterns();
+        }, Qt::QueuedConnection);
+    });
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
+// 后台准备前 k 方案用的地标表：读入数据文件旁边保存的那份，没有或已过期就重算并写回。
+// 每次修改线路都会清空它，修改期间查询改用反向 Dijkstra；算完时线网又变过就丢弃，按当前线网重新发起
+void MainWindow::refreshLandmarks()
+{
+    if (preparingLandmarks || !engine.landmarks().isEmpty() || engine.network().stopCount() == 0) return;
+    preparingLandmarks = true;
+    const quint64 version = engine.network().version();
+    searchPool.start([this, prepared = RouteEngine(engine), version]() mutable {
+        prepared.prepareLandmarks(SAVE_FILE);
+        QMetaObject::invokeMethod(this, [this, table = prepared.landmarks(), version] {
+            preparingLandmarks = false;
+            if (!engine.setLandmarks(table, version)) refreshLandmarks();
+        }, Qt::QueuedConnection);
+    });
+}
 
-    if (!doc.isArray()) {
+void MainWindow::loadRoutesFromFile()
+{
+    // 快照与 JSON 内容一致时直接读入编译好的线网，免去解析与建网；上次退出前没写回的修改随之重放
+    QElapsedTimer timer;
+    timer.start();
+    BusNetwork loaded;
+    RouteJournal::LoadInfo info;
+    if (!RouteJournal::load(SAVE_FILE, loaded, &info)) {
+        // 文件不存在或格式不对时保留现有 routes
         refreshAllStops();
         return;
     }
+    // 读入成功后的各条路径（建网、补写快照）都计入读入耗时
+    const auto recordLoad = qScopeGuard([&] {
+        (info.fromSnapshot ? meters.loadSnapshot : meters.loadJson)->observe(timer.nsecsElapsed());
+    });
 
-    routes.clear();
-    QJsonArray root = doc.array();
-    for (const auto v : std::as_const(root)) {
-        QJsonObject obj = v.toObject();
-        Route r;
-        r.id   = obj["id"].toString();
-        r.name = obj["name"].toString();
-
-        // 加载 stops
-        for (const auto& s : obj["stops"].toArray()) {
-            r.stops.append(s.toString());
-        }
+    cancelSearch();
+    planCache.clear();
+    engine.setNetwork(loaded);
+    routes = engine.network().routes();
+    rebuildStopIndex();
+    routeListsStale = true;
+    refreshTransferPatterns();
+    refreshLandmarks();
+    if (info.replayed > 0) {
+        compactJournal();       // 数据文件落后于日志，连同快照在后台写回
+    } else if (!info.fromSnapshot) {
+        QFile file(SAVE_FILE);
+        if (file.open(QIODevice::ReadOnly))
+            NetworkSnapshot::save(NetworkSnapshot::pathFor(SAVE_FILE), engine.network(), file.readAll());
+    }
+}
 
-        // === 新增字段：travelTimes ===
-        if (obj.contains("travelTimes") && obj["travelTimes"].isArray()) {
-            QJsonArray timesArr = obj["travelTimes"].toArray();
-            for (const auto& t : std::as_const(timesArr)) {
-                r.travelTimes.append(t.toInt());
-            }
-        } else {
-            // 兼容旧数据：默认每段 3 分钟
-            for (int i = 0; i < r.stops.size() - 1; ++i) {
-                r.travelTimes.append(3);
-            }
-        }
+void MainWindow::refreshAllStops() {
+    cancelSearch();     // 线路已变化，进行中的查询结果作废
+    planCache.invalidate(engine.network(), routes);     // 须在重建前与旧线网比较
+    engine.setRoutes(routes);
+    rebuildStopIndex();
+    routeListsStale = true;
+    refreshTransferPatterns();
+    refreshLandmarks();
+}
 
-        // === 新增字段：首末班车 ===
-        if (obj.contains("firstBus")) {
-            r.firstBus = QTime::fromString(obj["firstBus"].toString(), "HH:mm");
-        }
-        if (obj.contains("lastBus")) {
-            r.lastBus = QTime::fromString(obj["lastBus"].toString(), "HH:mm");
-        }
+void MainWindow::rebuildStopIndex()
+{
+    stopIndex = stopIndexFor(engine.network());
+}
 
-        // 设置默认首末班（防止无效时间）
-        if (!r.firstBus.isValid()) r.firstBus = QTime(6, 0);   // 06:00
-        if (!r.lastBus.isValid())  r.lastBus = QTime(22, 30);  // 22:30
+// 不碰界面对象，导入时在后台线程调用
+StopIndex MainWindow::stopIndexFor(const BusNetwork& net)
+{
+    // 驻留表里可能留有已无线路经过的站
+    QVector<QString> stops;
+    stops.reserve(net.stopCount());
+    for (const QString& s : net.stops())
+        if (net.stopId(s) != INVALID_STOP) stops.append(s);
+    std::sort(stops.begin(), stops.end());
+    StopIndex index;
+    index.build(stops);
+    return index;
+}
 
-        routes.append(r);
+// 单条线路的增删改（updated 为空表示删除 id）：线网、时刻表、站名索引、查询缓存和两个线路列表
+// 都只改动与这条线路相关的部分，代价与线路长度相当，不随线网规模增长
+void MainWindow::applyRouteChange(const QString& id, const Route* updated)
+{
+    cancelSearch();
+    int row = -1;
+    for (int i = 0; i < routes.size(); ++i)
+        if (routes[i].id == id) { row = i; break; }
+
+    // 查询缓存：可能变快时整体清空，否则按这条线路新旧两版经过的站淘汰
+    QSet<QString> touched;
+    if (row >= 0)
+        for (const QString& s : std::as_const(routes[row].stops)) touched.insert(s);
+    Route route;
+    if (updated) {
+        route = *updated;
+        for (const QString& s : std::as_const(route.stops)) touched.insert(s);
     }
+    planCache.invalidate(QSet<QString>{ id }, touched,
+                         QueryCache::mayImprove(row >= 0 ? &routes[row] : nullptr, updated ? &route : nullptr));
 
-    refreshAllStops();
-}
+    NetworkDelta delta;
+    const bool incremental = updated ? engine.updateRoute(route, &delta) : engine.removeRoute(id, &delta);
+    if (!updated) {
+        routes.erase(std::remove_if(routes.begin(), routes.end(),
+                                    [&](const Route& r) { return r.id == id; }), routes.end());
+    } else if (row >= 0) {
+        routes[row] = route;
+    } else {
+        row = int(routes.size());
+        routes.append(route);
+    }
 
-void MainWindow::refreshAllStops() {
-    QSet<QString> stops;
-    for (const auto& r : std::as_const(routes)) {
-        for (const auto& s : r.stops) stops.insert(s);
+    if (!incremental) {
+        // 数据里有重复编号时无法确定改的是哪一条，退回整体重建
+        engine.setRoutes(routes);
+        rebuildStopIndex();
+        rebuildRouteLists();
+        refreshTransferPatterns();
+        refreshLandmarks();
+        return;
     }
-    allStops = stops.values();
-    std::sort(allStops.begin(), allStops.end());
+    refreshTransferPatterns();      // 只补算被这次修改影响到的起点
+    refreshLandmarks();
+    for (const QString& s : std::as_const(delta.removedStops)) stopIndex.remove(s);
+    for (const QString& s : std::as_const(delta.addedStops)) stopIndex.insert(s);
+    if (routeListsStale || row < 0) return;
+    if (updated)
+        setRouteItem(row, route);
+    else
+        removeRouteItem(row);
 }
 
  void MainWindow::setupUI() {
@@ -333,6 +535,22 @@ void MainWindow::refreshAllStops() {
         endSuggest->setEditable(true);
         startSuggest->hide(); endSuggest->hide();
 
+        // 勾选后按出发时刻查询，只返回当天仍有车次的最早到达方案
+        departByTimeCheck = new QCheckBox("按出发时间查询");
+        departTimeEdit = new QTimeEdit(QTime::currentTime());
+        departTimeEdit->setDisplayFormat("HH:mm");
+        departTimeEdit->setEnabled(false);
+        auto departLayout = new QHBoxLayout;
+        departLayout->addWidget(departByTimeCheck);
+        departLayout->addWidget(departTimeEdit);
+        departLayout->addStretch();
+
+        // 勾选后记录每次查询各阶段的耗时与候选数，摘要显示在状态栏，悬停可看本次会话的历史
+        traceCheck = new QCheckBox("记录查询耗时");
+        traceLabel = new QLabel;
+        traceLabel->hide();
+        statusBar()->addPermanentWidget(traceLabel);
+
         searchLineBtn = new QPushButton("🔍 查询线路");
         searchLineBtn->setMinimumHeight(40);
         searchLineBtn->setStyleSheet("font-size: 16px; background: #3B82F6; color: white; border-radius: 6px;");
@@ -353,11 +571,29 @@ void MainWindow::refreshAllStops() {
         layout->addRow("", startSuggest);
         layout->addRow("终点站:", endEdit);
         layout->addRow("", endSuggest);
+        layout->addRow("出发时间:", departLayout);
+        layout->addRow("", traceCheck);
         layout->addRow(searchLineBtn);
         layout->addRow(resultDisplay);
 
-        connect(startEdit, &QLineEdit::textEdited, this, &MainWindow::updateStartSuggestions);
-        connect(endEdit, &QLineEdit::textEdited, this, &MainWindow::updateEndSuggestions);
+        // 联想去抖：连续输入时只在停顿后按当时的文本更新一次
+        startSuggestTimer = new QTimer(this);
+        endSuggestTimer = new QTimer(this);
+        for (QTimer* timer : { startSuggestTimer, endSuggestTimer }) {
+            timer->setSingleShot(true);
+            timer->setInterval(SUGGEST_DEBOUNCE_MS);
+        }
+        connect(startEdit, &QLineEdit::textEdited, startSuggestTimer, QOverload<>::of(&QTimer::start));
+        connect(endEdit, &QLineEdit::textEdited, endSuggestTimer, QOverload<>::of(&QTimer::start));
+        connect(startSuggestTimer, &QTimer::timeout, this, [this] { updateStartSuggestions(startEdit->text()); });
+        connect(endSuggestTimer, &QTimer::timeout, this, [this] { updateEndSuggestions(endEdit->text()); });
+        // 修改查询条件即取消尚未返回的查询
+        connect(startEdit, &QLineEdit::textEdited, this, &MainWindow::cancelSearch);
+        connect(endEdit, &QLineEdit::textEdited, this, &MainWindow::cancelSearch);
+        connect(departByTimeCheck, &QCheckBox::toggled, this, &MainWindow::cancelSearch);
+        connect(departTimeEdit, &QTimeEdit::timeChanged, this, &MainWindow::cancelSearch);
+        connect(departByTimeCheck, &QCheckBox::toggled, departTimeEdit, &QTimeEdit::setEnabled);
+        connect(traceCheck, &QCheckBox::toggled, traceLabel, &QLabel::setVisible);
         connect(searchLineBtn, &QPushButton::clicked, this, &MainWindow::searchLines);
     }
 
@@ -582,7 +818,7 @@ void MainWindow::loginAsUser() {
     stackedWidget->setCurrentWidget(searchPage);
     backToManage->setVisible(false);
     updateBtnState(true);
-    refreshRouteIdList();
+    if (routeListsStale) rebuildRouteLists();
 }
 
 void MainWindow::loginAsAdmin() {
@@ -590,7 +826,7 @@ void MainWindow::loginAsAdmin() {
     stackedWidget->setCurrentWidget(searchPage);
     backToManage->setVisible(true);
     updateBtnState(true);
-    refreshRouteIdList();
+    if (routeListsStale) rebuildRouteLists();
 }
 
 void MainWindow::updateBtnState(bool state)
@@ -609,50 +845,45 @@ void MainWindow::logout() {
 }
 
 void MainWindow::switchToSearch() { stackedWidget->setCurrentWidget(searchPage); }
-void MainWindow::switchToRoute() { stackedWidget->setCurrentWidget(routePage); }
+void MainWindow::switchToRoute() {
+    if (routeListsStale) rebuildRouteLists();
+    stackedWidget->setCurrentWidget(routePage);
+}
 void MainWindow::switchToManage() {
     if (currentUserRole != "admin") return;
-    routeList->clear();
-    for (const auto& r : std::as_const(routes)) {
-        QString itemText = QString("%1 (%2)").arg(r.name, r.id);
-        auto item = new QListWidgetItem(itemText);
-        item->setData(Qt::UserRole, r.id);
-        routeList->addItem(item);
-    }
+    if (routeListsStale) rebuildRouteLists();
     stackedWidget->setCurrentWidget(managePage);
-    refreshRouteIdList();
 }
 
-void MainWindow::updateStartSuggestions(const QString& text) {
-    startSuggest->clear();
+// 用索引求出按匹配质量排序的站点，只有列表内容变化时才重建下拉框
+void MainWindow::showSuggestions(QComboBox* box, StopMatches& matches, const QString& text)
+{
     if (text.isEmpty()) {
-        startSuggest->hide();
+        matches = StopMatches();
+        box->clear();
+        box->hide();
         return;
     }
-    for (const auto& stop : std::as_const(allStops)) {
-        if (stop.contains(text, Qt::CaseInsensitive)) {
-            startSuggest->addItem(stop);
-            if (startSuggest->count() >= 50) break;
-        }
+    stopIndex.update(matches, text);
+
+    // 子串匹配之外，还认拼音首字母（zygc -> 中央广场）和少量错字
+    QStringList items;
+    for (int id : stopIndex.suggest(matches, SUGGEST_LIMIT)) items.append(stopIndex.name(id));
+    bool same = box->count() == items.size();
+    for (int i = 0; same && i < items.size(); ++i) same = box->itemText(i) == items[i];
+    if (!same) {
+        box->clear();
+        box->addItems(items);
     }
-    startSuggest->show();
-    //startSuggest->showPopup();
+    box->show();
+}
+
+void MainWindow::updateStartSuggestions(const QString& text) {
+    showSuggestions(startSuggest, startMatches, text);
 }
 
 void MainWindow::updateEndSuggestions(const QString& text) {
-    endSuggest->clear();
-    if (text.isEmpty()) {
-        endSuggest->hide();
-        return;
-    }
-    for (const auto& stop : std::as_const(allStops)) {
-        if (stop.contains(text, Qt::CaseInsensitive)) {
-            endSuggest->addItem(stop);
-            if (endSuggest->count() >= 50) break;
-        }
-    }
-    endSuggest->show();
-    //endSuggest->showPopup();
+    showSuggestions(endSuggest, endMatches, text);
 }
 
 void MainWindow::fillStartFromSuggestion(int idx)
@@ -677,28 +908,6 @@ void MainWindow::fillEndFromSuggestion(int idx)
     endEdit->setFocus();
 }
 
-QVector<Route> MainWindow::findDirectRoutes(const QString& start, const QString& end) {
-    QVector<Route> found;
-    for (const auto& r : std::as_const(routes)) {
-        if (r.stops.contains(start) && r.stops.contains(end))
-            found.append(r);
-    }
-    return found;
-}
-
-QVector<QString> MainWindow::getStopPath(const Route& r, const QString& start, const QString& end) {
-    int i1 = r.stops.indexOf(start);
-    int i2 = r.stops.indexOf(end);
-    if (i1 == -1 || i2 == -1) return {};
-    if (i1 < i2)
-        return r.stops.mid(i1, i2 - i1 + 1);
-    else {
-        auto rev = r.stops.mid(i2, i1 - i2 + 1);
-        std::reverse(rev.begin(), rev.end());
-        return rev;
-    }
-}
-
 void MainWindow::searchLines()
 {
     QString start = startEdit->text().trimmed();
@@ -712,234 +921,126 @@ void MainWindow::searchLines()
         return;
     }
 
-    struct Plan {
-        int totalTime = 0;
-        QString html;
-    };
-    QVector<Plan> allPlans;
-
-    // === 1. 直达方案 ===
-    for (const auto& r : std::as_const(routes)) {
-        if (!r.stops.contains(start) || !r.stops.contains(end)) continue;
-        auto path = getStopPath(r, start, end);
-        if (path.isEmpty()) continue;
-        int minutes = calculateTravelTime(r, start, end);
-        if (minutes <= 0) continue;
-        QString timeStr = QString("（约 %1 分钟）").arg(minutes);
-        QString busInfo = QString("🕒 首班 %1 &nbsp; 末班 %2")
-                              .arg(r.firstBus.toString("HH:mm"), r.lastBus.toString("HH:mm"));
-        // 构建带每段耗时的路径
-        QString detailedPath = "";
-        for (int i = 0; i < path.size(); ++i) {
-            detailedPath += path[i];
-            if (i < path.size() - 1) {
-                int segTime = calculateTravelTime(r, path[i], path[i+1]);
-                detailedPath += QString(" <span style=\"color:#666;\">↓ %1分钟</span> → ").arg(segTime);
-            }
-        }
-        QString html = QString(
-                           "<div style=\"margin: 16px 0; padding: 16px; border-radius: 8px; background: #1E1E1E; border-bottom: 1px solid #333333; box-shadow: 0 2px 4px rgba(0,0,0,0.3);\">"
-                           "<div style=\"display: inline-block; width: 4px; height: 100%; background: #10B981; margin-left: -12px; margin-right: 12px; vertical-align: top;\"></div>"
-                           "<div style=\"display: inline-block; width: calc(100% - 16px);\">"
-                           "<h3 style=\"margin: 0 0 8px 0; color: #00A65B;\">🚌 直达 <span style=\"color: #00A65B; font-weight: bold;\">%1</span></h3>"
-                           "<p>从 <b>%2</b> 到 <b>%3</b>（共 <b>%4</b> 站）%5</p>"
-                           "<div style=\"margin: 6px 0 0 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">%6</div>"
-                           "<div style=\"margin-top: 6px; color: #A0A0A0; font-size: 13px;\">%7</div>"
-                           "</div></div>")
-                           .arg(r.name, start, end, QString::number(path.size()), timeStr, detailedPath, busInfo);
-        allPlans.append({minutes, html});
+    // 新查询作废上一次：取消其计算，迟到的结果也会按编号丢弃
+    cancelSearch();
+    const bool byTime = departByTimeCheck->isChecked();
+    const QTime departTime = departTimeEdit->time();
+
+    // 热门起终点直接取缓存
+    const QString cacheKey = QueryCache::key(start, end, byTime ? "at " + departTime.toString("HH:mm")
+                                                                : QString("top %1").arg(PLAN_LIMIT));
+    QString cached;
+    if (planCache.lookup(cacheKey, cached)) {
+        resultDisplay->setHtml(cached);
+        const QueryCacheStats st = planCache.stats();
+        statusBar()->showMessage(QString("结果来自缓存（命中率 %1%，因线路变化淘汰 %2 条）")
+                                     .arg(st.hitRate() * 100, 0, 'f', 1).arg(st.invalidated), 5000);
+        return;
     }
 
-    // === 2. 一次换乘 ===
-    for (const auto& r1 : std::as_const(routes)) {
-        if (!r1.stops.contains(start)) continue;
-        for (const auto& r2 : std::as_const(routes)) {
-            if (r1.id == r2.id || !r2.stops.contains(end)) continue;
-            for (const QString& mid : r1.stops) {
-                if (!r2.stops.contains(mid)) continue;
-                auto p1 = getStopPath(r1, start, mid);
-                auto p2 = getStopPath(r2, mid, end);
-                if (p1.isEmpty() || p2.isEmpty()) continue;
-                int t1 = calculateTravelTime(r1, start, mid);
-                int t2 = calculateTravelTime(r2, mid, end);
-                if (t1 <= 0 || t2 <= 0) continue;
-                int total = t1 + t2 + 3;
-                // 构建详细路径（含每段耗时）
-                QString path1Detail = "";
-                for (int i = 0; i < p1.size(); ++i) {
-                    path1Detail += p1[i];
-                    if (i < p1.size() - 1) {
-                        int seg = calculateTravelTime(r1, p1[i], p1[i+1]);
-                        path1Detail += QString(" <span style=\"color:#666;\">↓ %1分钟</span> → ").arg(seg);
-                    }
-                }
-                QString path2Detail = "";
-                for (int i = 0; i < p2.size(); ++i) {
-                    path2Detail += p2[i];
-                    if (i < p2.size() - 1) {
-                        int seg = calculateTravelTime(r2, p2[i], p2[i+1]);
-                        path2Detail += QString(" <span style=\"color:#666;\">↓ %1分钟</span> → ").arg(seg);
-                    }
-                }
-                QString totalStr = QString("（约 %1 分钟，含换乘）").arg(total);
-                QString busInfo = QString(
-                                      "<div style=\"font-size: 13px; color: #A0A0A0; margin-top: 6px;\">"
-                                      "第1段（%1）：首班 %2 末班 %3<br>"
-                                      "第2段（%4）：首班 %5 末班 %6"
-                                      "</div>")
-                                      .arg(r1.name, r1.firstBus.toString("HH:mm"), r1.lastBus.toString("HH:mm"),
-                                           r2.name, r2.firstBus.toString("HH:mm"), r2.lastBus.toString("HH:mm"));
-                QString html = QString(
-                                   "<div style=\"margin: 16px 0; padding: 16px; border-radius: 8px; background: #1E1E1E; border-bottom: 1px solid #333333; box-shadow: 0 2px 4px rgba(0,0,0,0.3);\">"
-                                   "<div style=\"display: inline-block; width: 4px; height: 100%; background: #3B82F6; margin-left: -12px; margin-right: 12px; vertical-align: top;\"></div>"
-                                   "<div style=\"display: inline-block; width: calc(100% - 16px);\">"
-                                   "<h3 style=\"margin: 0 0 8px 0; color: #4F46E5;\">🔄 一次换乘 ------------------------------------------------------------------------------------------</h3>"
-                                   "<p>从 <b>%1</b> 到 <b>%2</b>%3</p>"
-                                   "<div style=\"margin: 8px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
-                                   "<b>第1段</b>：乘坐 <span style=\"color: #4F46E5; font-weight: bold;\">%4</span>（%5 站）<br>%6"
-                                   "</div>"
-                                   "<div style=\"text-align: center; margin: 4px 0; color: #3B82F6;\">↓ 在 <b>%7</b> 换乘（步行约3分钟）↓</div>"
-                                   "<div style=\"margin: 8px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
-                                   "<b>第2段</b>：乘坐 <span style=\"color: #4F46E5; font-weight: bold;\">%8</span>（%9 站）<br>%10"
-                                   "</div>"
-                                   "%11"
-                                   "</div></div>")
-                                   .arg(start, end, totalStr,
-                                        r1.name, QString::number(p1.size()), path1Detail,
-                                        mid,
-                                        r2.name, QString::number(p2.size()), path2Detail,
-                                        busInfo);
-                allPlans.append({total, html});
-            }
-        }
+    const quint64 requestId = searchSerial;
+    const quint64 cacheGeneration = planCache.generation();
+    const bool tracing = traceCheck->isChecked();
+    auto token = std::make_shared<CancelToken>();
+    activeSearch = token;
+    resultDisplay->setHtml("<p style=\"color: #A0A0A0;\">⏳ 正在查询…</p>");
+
+    // 按线路查询的起点记入换乘模式：还没有的在后台排队计算，下次从这里出发就按模式求值
+    if (!byTime) {
+        engine.noteQuery(start);
+        if (!activePatterns) refreshTransferPatterns();
     }
 
-    // === 3. 两次换乘 ===
-    for (const auto& r1 : std::as_const(routes)) {
-        if (!r1.stops.contains(start)) continue;
-        for (const auto& r2 : std::as_const(routes)) {
-            if (r1.id == r2.id) continue;
-            for (const QString& mid1 : r1.stops) {
-                if (!r2.stops.contains(mid1)) continue;
-                for (const auto& r3 : std::as_const(routes)) {
-                    if (r3.id == r1.id || r3.id == r2.id || !r3.stops.contains(end)) continue;
-                    for (const QString& mid2 : r2.stops) {
-                        if (!r3.stops.contains(mid2)) continue;
-                        auto p1 = getStopPath(r1, start, mid1);
-                        auto p2 = getStopPath(r2, mid1, mid2);
-                        auto p3 = getStopPath(r3, mid2, end);
-                        if (p1.isEmpty() || p2.isEmpty() || p3.isEmpty()) continue;
-                        int t1 = calculateTravelTime(r1, start, mid1);
-                        int t2 = calculateTravelTime(r2, mid1, mid2);
-                        int t3 = calculateTravelTime(r3, mid2, end);
-                        if (t1 <= 0 || t2 <= 0 || t3 <= 0) continue;
-                        int total = t1 + t2 + t3 + 6;
-                        // 构建详细路径
-                        auto buildDetail = [&](const Route& r, const QVector<QString>& p) -> QString {
-                            QString s;
-                            for (int i = 0; i < p.size(); ++i) {
-                                s += p[i];
-                                if (i < p.size() - 1) {
-                                    int seg = calculateTravelTime(r, p[i], p[i+1]);
-                                    s += QString(" <span style=\"color:#666;\">↓ %1分钟</span> → ").arg(seg);
-                                }
-                            }
-                            return s;
-                        };
-                        QString d1 = buildDetail(r1, p1);
-                        QString d2 = buildDetail(r2, p2);
-                        QString d3 = buildDetail(r3, p3);
-                        QString totalStr = QString("（约 %1 分钟，含换乘）").arg(total);
-                        QString busInfo = QString(
-                                              "<div style=\"font-size: 13px; color: #A0A0A0; margin-top: 6px;\">"
-                                              "第1段（%1）：首班 %2 末班 %3<br>"
-                                              "第2段（%4）：首班 %5 末班 %6<br>"
-                                              "第3段（%7）：首班 %8 末班 %9"
-                                              "</div>")
-                                              .arg(r1.name, r1.firstBus.toString("HH:mm"), r1.lastBus.toString("HH:mm"),
-                                                   r2.name, r2.firstBus.toString("HH:mm"), r2.lastBus.toString("HH:mm"),
-                                                   r3.name, r3.firstBus.toString("HH:mm"), r3.lastBus.toString("HH:mm"));
-                        QString html = QString(
-                                           "<div style=\"margin: 16px 0; padding: 16px; border-radius: 8px; background: #1E1E1E; border-bottom: 1px solid #333333; box-shadow: 0 2px 4px rgba(0,0,0,0.3);\">"
-                                           "<div style=\"display: inline-block; width: 4px; height: 100%; background: #8B5CF6; margin-left: -12px; margin-right: 12px; vertical-align: top;\"></div>"
-                                           "<div style=\"display: inline-block; width: calc(100% - 16px);\">"
-                                           "<h3 style=\"margin: 0 0 8px 0; color: #E56C4F;\">🔄 两次换乘 ------------------------------------------------------------------------------------------</h3>"
-                                           "<p>从 <b>%1</b> 到 <b>%2</b>%3</p>"
-                                           "<div style=\"margin: 6px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
-                                           "<b>第1段</b>：乘坐 <span style=\"color: #E56C4F; font-weight: bold;\">%4</span>（%5 站）<br>%6"
-                                           "</div>"
-                                           "<div style=\"text-align: center; margin: 4px 0; color: #3B82F6;\">↓ 在 <b>%7</b> 换乘（步行约3分钟）↓</div>"
-                                           "<div style=\"margin: 6px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
-                                           "<b>第2段</b>：乘坐 <span style=\"color: #E56C4F; font-weight: bold;\">%8</span>（%9 站）<br>%10"
-                                           "</div>"
-                                           "<div style=\"text-align: center; margin: 4px 0; color: #3B82F6;\">↓ 在 <b>%11</b> 换乘（步行约3分钟）↓</div>"
-                                           "<div style=\"margin: 6px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
-                                           "<b>第3段</b>：乘坐 <span style=\"color: #E56C4F; font-weight: bold;\">%12</span>（%13 站）<br>%14"
-                                           "</div>"
-                                           "%15"
-                                           "</div></div>")
-                                           .arg(start, end, totalStr,
-                                                r1.name, QString::number(p1.size()), d1, mid1,
-                                                r2.name, QString::number(p2.size()), d2, mid2,
-                                                r3.name, QString::number(p3.size()), d3,
-                                                busInfo);
-                        allPlans.append({total, html});
-                    }
-                }
+    // 引擎副本与界面线程共享线网数据（隐式共享），查询期间编辑线路不会影响后台这份
+    searchPool.start([this, snapshot = RouteEngine(engine), start, end, byTime, departTime, token, requestId,
+                      cacheKey, cacheGeneration, tracing]() mutable {
+        QElapsedTimer timer;
+        timer.start();
+        QString htmlOutput;
+        QVector<Journey> shown;
+        SearchTrace trace;
+        SearchTrace* tp = tracing ? &trace : nullptr;
+        if (tracing) trace.query = start + " → " + end;
+        if (byTime) {
+            // 按出发时间：Connection Scan 给出当天该时刻之后最早到达的一条方案
+            const Journey j = snapshot.searchAt(start, end, departTime.hour() * 60 + departTime.minute(),
+                                                token.get(), tp);
+            if (token->isCancelled()) {
+                meters.searchCancelled->add();
+                return;
+            }
+            SearchTrace::Scope phase(tp, SearchTrace::Render);
+            if (j.legs.isEmpty()) {
+                htmlOutput = "<p style=\"color: #EF4444; font-style: italic;\">⚠️ " + departTime.toString("HH:mm")
+                             + " 之后已没有从 <b>" + start + "</b> 到 <b>" + end + "</b> 的可乘车次。</p>";
+            } else {
+                renderer.renderJourney(htmlOutput, snapshot.network(), j, start, end);
+                shown.append(j);
+            }
+        } else {
+            // 搜索只产出紧凑的方案描述，只有最终显示的 PLAN_LIMIT 个才生成 HTML
+            shown = snapshot.searchTopK(start, end, PLAN_LIMIT, -1, token.get(), tp);
+            if (token->isCancelled()) {
+                meters.searchCancelled->add();
+                return;
+            }
+            SearchTrace::Scope phase(tp, SearchTrace::Render);
+            if (shown.isEmpty()) {
+                htmlOutput = "<p style=\"color: #EF4444; font-style: italic;\">⚠️ 未找到从 <b>" + start + "</b> 到 <b>" + end + "</b> 的可行路线。</p>";
+            } else {
+                renderer.renderPlans(htmlOutput, snapshot.network(), shown, start, end);
             }
         }
-    }
-
-    // === 4. 按总时间排序并显示 ===
-    std::sort(allPlans.begin(), allPlans.end(), [](const Plan& a, const Plan& b) {
-        return a.totalTime < b.totalTime;
+        (byTime ? meters.searchAt : meters.searchTopK)->observe(timer.nsecsElapsed());
+        if (shown.isEmpty()) meters.searchEmpty->add();
+        planCache.insert(cacheKey, cacheGeneration, htmlOutput, snapshot.network(), start, end, shown);
+        emit searchFinished(requestId, htmlOutput, trace);
     });
+}
 
-    QString htmlOutput;
-    if (allPlans.isEmpty()) {
-        htmlOutput = "<p style=\"color: #EF4444; font-style: italic;\">⚠️ 未找到从 <b>" + start + "</b> 到 <b>" + end + "</b> 的可行路线（最多两次换乘）。</p>";
-    } else {
-        int shown = 0;
-        for (const auto& p : std::as_const(allPlans)) {
-            if (shown >= 5) break;
-            htmlOutput += p.html;
-            shown++;
-        }
+// 只显示最近一次查询的结果
+void MainWindow::onSearchFinished(quint64 requestId, const QString& html, const SearchTrace& trace)
+{
+    if (requestId != searchSerial) return;
+    activeSearch.reset();
+    if (trace.query.isEmpty()) {
+        resultDisplay->setHtml(html);
+        return;
     }
-    resultDisplay->setHtml(htmlOutput);
+
+    // 显示也算一个阶段：结果较长时 QTextEdit 排版可能比查询本身还慢
+    SearchTrace shown = trace;
+    {
+        SearchTrace::Scope phase(&shown, SearchTrace::Display);
+        resultDisplay->setHtml(html);
+    }
+    searchHistory.record(shown);
+    traceLabel->setText(shown.summary());
+    traceLabel->setToolTip(searchHistory.report());
+}
+
+// 取消正在进行的查询；编号前移，使已在途的结果失效
+void MainWindow::cancelSearch()
+{
+    ++searchSerial;
+    if (!activeSearch) return;
+    activeSearch->cancel();
+    activeSearch.reset();
+    resultDisplay->clear();
 }
 
 void MainWindow::searchRouteById() {
     QString id = routeIdEdit->text().trimmed();
-    for (const auto& r : std::as_const(routes)) {
-        if (r.id == id) {
-            // 计算全程时间
-            int totalTime = 0;
-            for (int t : r.travelTimes) totalTime += t;
-            QString timeInfo = QString("（全程约 <b>%1 分钟</b>）").arg(totalTime);
-            QString busInfo = QString("🕒 首班 <b>%1</b> &nbsp; 末班 <b>%2</b>")
-                                  .arg(r.firstBus.toString("HH:mm"), r.lastBus.toString("HH:mm"));
-
-            QString stationsHtml = "<ul style=\"padding-left: 20px; margin: 8px 0;\">";
-            for (int i = 0; i < r.stops.size(); ++i) {
-                stationsHtml += "<li>" + r.stops[i];
-                if (i < r.travelTimes.size()) {
-                    stationsHtml += QString(" <span style=\"color:#666;\">↓ %1分钟</span>").arg(r.travelTimes[i]);
-                }
-                stationsHtml += "</li>";
-            }
-            stationsHtml += "</ul>";
-
-            QString html = QString(
-                               "<h3>🚍 %1 (%2)</h3>"
-                               "<p style=\"color: #A0A0A0;\">全程共 %3 站 %4</p>"
-                               "<p style=\"color: #A0A0A0; margin-top: 4px;\">%5</p>"
-                               "%6")
-                               .arg(r.name, r.id)
-                               .arg(r.stops.size())
-                               .arg(timeInfo)
-                               .arg(busInfo)
-                               .arg(stationsHtml);
+    QElapsedTimer timer;
+    timer.start();
+    const auto recordLookup = qScopeGuard([&] { meters.routeLookup->observe(timer.nsecsElapsed()); });
+    const BusNetwork& net = engine.network();
+    for (int i = 0; i < net.routeCount(); ++i) {
+        if (net.isVacant(i)) continue;
+        if (net.route(i).id() == id) {
+            QString html;
+            renderer.renderRoute(html, net.route(i).toRoute());
+            renderer.renderConnections(html, net, i);
             routeDetailDisplay->setHtml(html);
             return;
         }
@@ -962,10 +1063,8 @@ void MainWindow::editRoute(const QString& id)
 
 void MainWindow::deleteRoute(const QString& id) {
     if (QMessageBox::question(this, "确认", "确定删除？") == QMessageBox::Yes) {
-        routes.erase(std::remove_if(routes.begin(), routes.end(),
-                                    [&](const Route& r) { return r.id == id; }), routes.end());
-        refreshAllStops();
-        saveRoutesToFile();
+        applyRouteChange(id, nullptr);
+        recordRemove(id);
         QMessageBox::information(this, "成功", "路线已删除");
     }
 }
@@ -993,7 +1092,6 @@ void MainWindow::onRouteContextMenu(const QPoint &pos)
         editRoute(id);
     } else if (selected == deleteAction) {
         deleteRoute(id);
-        switchToManage();
     }
 }
 
@@ -1015,38 +1113,7 @@ void MainWindow::exportRoutes()
         "JSON 文件 (*.json)");
     if (fileName.isEmpty()) return;
 
-    QJsonArray root;
-    for (const auto &r : std::as_const(routes)) {
-        QJsonObject obj;
-        obj["id"] = r.id;
-        obj["name"] = r.name;
-
-        // 导出站点
-        QJsonArray stops;
-        for (const auto &s : r.stops) {
-            stops.append(s);
-        }
-        obj["stops"] = stops;
-
-        // ✅ 导出站点间时间（travelTimes）
-        QJsonArray travelTimes;
-        for (int t : r.travelTimes) {
-            travelTimes.append(t);
-        }
-        obj["travelTimes"] = travelTimes;
-
-        // ✅ 导出首末班车时间
-        obj["firstBus"] = r.firstBus.toString("HH:mm");
-        obj["lastBus"] = r.lastBus.toString("HH:mm");
-
-        root.append(obj);
-    }
-
-    QJsonDocument doc(root);
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    if (saveRoutes(fileName, routes)) {
         QMessageBox::information(this, "成功", "路线已导出至\n" + fileName);
     } else {
         QMessageBox::warning(this, "错误", "无法写入文件");
@@ -1055,71 +1122,95 @@ void MainWindow::exportRoutes()
 
 void MainWindow::importRoutes()
 {
+    if (activeImport) return;   // 上一次导入还没结束
+
     QString fileName = QFileDialog::getOpenFileName(
         this, "导入路线", QDir::homePath(),
         "JSON 文件 (*.json)");
     if (fileName.isEmpty()) return;
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, "错误", "无法打开文件");
-        return;
-    }
-
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
-    if (!doc.isArray()) {
-        QMessageBox::warning(this, "错误", "JSON 格式不正确（顶层应为数组）");
-        return;
-    }
-
-    QJsonArray root = doc.array();
-    QVector<Route> imported;
-    for (const auto v : std::as_const(root)) {
-        QJsonObject obj = v.toObject();
-        Route r;
-        r.id   = obj["id"].toString();
-        r.name = obj["name"].toString();
-        for (const auto& s : obj["stops"].toArray()) {
-            r.stops.append(s.toString());
-        }
-
-        // ✅ 导入新字段
-        if (obj.contains("travelTimes")) {
-            for (const auto& t : obj["travelTimes"].toArray()) {
-                r.travelTimes.append(t.toInt());
-            }
-        }
-        while (r.travelTimes.size() < r.stops.size() - 1) {
-            r.travelTimes.append(3);
-        }
-
-        if (obj.contains("firstBus")) {
-            r.firstBus = QTime::fromString(obj["firstBus"].toString(), "HH:mm");
-        }
-        if (obj.contains("lastBus")) {
-            r.lastBus = QTime::fromString(obj["lastBus"].toString(), "HH:mm");
-        }
-        if (!r.firstBus.isValid()) r.firstBus = QTime(6, 0);
-        if (!r.lastBus.isValid())  r.lastBus = QTime(22, 30);
-
-        imported.append(r);
-    }
-
-    if (imported.isEmpty()) return;
-
+    // 大文件要读很久，先问清导入方式，再交给后台线程
     auto ans = QMessageBox::question(
         this, "导入方式",
         "是否清空现有路线后再导入？\n选“否”则追加",
         QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
     if (ans == QMessageBox::Cancel) return;
-    if (ans == QMessageBox::Yes) routes.clear();
+    const QVector<Route> base = ans == QMessageBox::Yes ? QVector<Route>() : routes;
+
+    auto token = std::make_shared<CancelToken>();
+    activeImport = token;
+    auto dialog = new QProgressDialog("正在读取线路文件…", "取消", 0, 1000, this);
+    dialog->setWindowTitle("导入路线");
+    dialog->setWindowModality(Qt::WindowModal);
+    dialog->setMinimumDuration(300);
+    connect(dialog, &QProgressDialog::canceled, this, [token] { token->cancel(); });
+    QPointer<QProgressDialog> progress = dialog;
+
+    // 解析、建网、展开时刻表和站名索引都在后台完成，界面线程只负责换上；进度按千分比变化才投递
+    searchPool.start([this, fileName, base, token, progress] {
+        QElapsedTimer timer;
+        timer.start();
+        RouteImporter importer(fileName);
+        QVector<Route> combined = base;
+        int lastPermille = -1;
+        const bool ok = importer.run(combined, token.get(), [&](qint64 read, qint64 total, int count) {
+            const int permille = total > 0 ? int(read * 1000 / total) : 1000;
+            if (permille == lastPermille) return;
+            lastPermille = permille;
+            QMetaObject::invokeMethod(this, [progress, permille, count] {
+                if (!progress) return;
+                progress->setValue(permille);
+                progress->setLabelText(QString("正在读取线路文件…已读入 %1 条").arg(count));
+            }, Qt::QueuedConnection);
+        });
+        const int imported = int(combined.size() - base.size());
+        RouteEngine prepared;
+        StopIndex index;
+        if (ok && imported > 0) {
+            prepared.setRoutes(combined);
+            index = stopIndexFor(prepared.network());
+        }
+        if (ok && !importer.wasCancelled()) {
+            meters.importTime->observe(timer.nsecsElapsed());
+            meters.importedRoutes->add(quint64(qMax(0, imported)));
+            meters.importErrors->add(quint64(importer.errors().size()));
+        }
 
-    routes.append(imported);
-    refreshAllStops();
-    switchToManage();
-    saveRoutesToFile();
-    QMessageBox::information(this, "成功", QString("已导入 %1 条路线").arg(imported.size()));
+        QMetaObject::invokeMethod(this, [this, ok, imported, importer, combined, prepared, index, token, progress] {
+            if (activeImport == token) activeImport.reset();
+            if (progress) progress->deleteLater();
+            if (importer.wasCancelled()) return;
+            if (!ok) {
+                QMessageBox::warning(this, "错误", "无法导入路线：" + importer.errorString());
+                return;
+            }
+            if (imported > 0) {
+                // 整体换网，缓存不逐条比较直接清空；数据文件与快照在后台写回
+                cancelSearch();
+                planCache.clear();
+                engine = prepared;
+                routes = combined;
+                stopIndex = index;
+                routeListsStale = true;
+                if (stackedWidget->currentWidget() == managePage) rebuildRouteLists();     // 列表就在眼前
+                refreshTransferPatterns();
+                refreshLandmarks();
+                compactJournal();
+            }
+
+            QString message = QString("已导入 %1 条路线").arg(imported);
+            const QVector<ImportError>& errors = importer.errors();
+            if (!errors.isEmpty()) {
+                message += QString("，跳过 %1 条有问题的线路：").arg(errors.size());
+                for (int i = 0; i < qMin(int(errors.size()), 5); ++i)
+                    message += QString("\n第 %1 条（第 %2 字节）：%3")
+                                   .arg(errors[i].index + 1).arg(errors[i].offset).arg(errors[i].message);
+                if (errors.size() > 5) message += "\n……";
+            }
+            if (errors.isEmpty()) QMessageBox::information(this, "成功", message);
+            else QMessageBox::warning(this, "导入完成", message);
+        }, Qt::QueuedConnection);
+    });
 }
 
 bool MainWindow::eventFilter(QObject *obj, QEvent *event) {
@@ -1144,14 +1235,33 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event) {
     return QMainWindow::eventFilter(obj, event);
 }
 
-void MainWindow::refreshRouteIdList()
+// 两个列表的第 i 行都对应 routes[i]；整体重建只在批量变化（载入、导入）之后做
+void MainWindow::rebuildRouteLists()
 {
+    routeList->clear();
     routeIdList->clear();
-    for (const auto& r : std::as_const(routes)) {
-        auto item = new QListWidgetItem(QString("%1 - %2").arg(r.id, r.name));
-        item->setData(Qt::UserRole, r.id);
-        routeIdList->addItem(item);
+    for (int i = 0; i < routes.size(); ++i) setRouteItem(i, routes[i]);
+    routeListsStale = false;
+}
+
+void MainWindow::setRouteItem(int row, const Route& r)
+{
+    if (row == routeList->count()) {
+        routeList->addItem(new QListWidgetItem);
+        routeIdList->addItem(new QListWidgetItem);
     }
+    QListWidgetItem* item = routeList->item(row);
+    item->setText(QString("%1 (%2)").arg(r.name, r.id));
+    item->setData(Qt::UserRole, r.id);
+    item = routeIdList->item(row);
+    item->setText(QString("%1 - %2").arg(r.id, r.name));
+    item->setData(Qt::UserRole, r.id);
+}
+
+void MainWindow::removeRouteItem(int row)
+{
+    delete routeList->takeItem(row);
+    delete routeIdList->takeItem(row);
 }
 
 void MainWindow::openRouteEditDialog(const Route* routeToEdit)
@@ -1313,6 +1423,11 @@ void MainWindow::openRouteEditDialog(const Route* routeToEdit)
             QMessageBox::warning(&dialog, "输入错误", "请填写路线编号和名称");
             return;
         }
+        if (!routeToEdit && std::any_of(routes.cbegin(), routes.cend(),
+                                        [&](const Route& r) { return r.id == id; })) {
+            QMessageBox::warning(&dialog, "输入错误", "线路编号已存在");
+            return;
+        }
 
         QVector<QString> stops;
         for (auto* edit : stopEdits) {
@@ -1341,44 +1456,11 @@ void MainWindow::openRouteEditDialog(const Route* routeToEdit)
         r.firstBus = firstBusEdit->time();
         r.lastBus = lastBusEdit->time();
 
-        if (routeToEdit) {
-            // 更新
-            for (auto& existing : routes) {
-                if (existing.id == id) {
-                    existing = r;
-                    break;
-                }
-            }
-        } else {
-            // 新增
-            routes.append(r);
-        }
-
         dialog.accept();
-        if (routeIdList) refreshRouteIdList();
-        saveRoutesToFile();
+        applyRouteChange(id, &r);   // 编号已存在时更新，否则新增在最后
+        recordPut(r);
         switchToManage();
     });
 
     dialog.exec();
 }
-
-int MainWindow::calculateTravelTime(const Route& route, const QString& from, const QString& to)
-{
-    int i1 = route.stops.indexOf(from);
-    int i2 = route.stops.indexOf(to);
-    if (i1 == -1 || i2 == -1) return -1;
-    if (route.travelTimes.size() != route.stops.size() - 1) return -1;
-
-    int total = 0;
-    if (i1 < i2) {
-        for (int i = i1; i < i2; ++i) {
-            total += route.travelTimes[i];
-        }
-    } else {
-        for (int i = i1 - 1; i >= i2; --i) {
-            total += route.travelTimes[i];
-        }
-    }
-    return total;
-}
@@ -0,0 +1,198 @@
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QMainWindow>
+#include <QVector>
+#include <QString>
+#include <QTime>
+#include <QQueue>
+#include <QSet>
+#include <QThreadPool>
+#include <memory>
+#include "routeengine.h"
+#include "planrenderer.h"
+#include "querycache.h"
+#include "stopindex.h"
+#include "routejournal.h"
+#include "metrics.h"
+
+QT_BEGIN_NAMESPACE
+class QLineEdit;
+class QPushButton;
+class QStackedWidget;
+class QWidget;
+class QLabel;
+class QTextEdit;
+class QListWidget;
+class QComboBox;
+class QListWidgetItem;
+class QCheckBox;
+class QTimeEdit;
+class QTimer;
+QT_END_NAMESPACE
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    MainWindow(QWidget *parent = nullptr);
+    ~MainWindow() override;
+    static constexpr auto SAVE_FILE = "bus_routes.json";
+    static constexpr int PLAN_LIMIT = 5;    // 查询结果最多显示的方案数
+    static constexpr int SUGGEST_LIMIT = 50;        // 联想下拉框最多列出的站点数
+    static constexpr int SUGGEST_DEBOUNCE_MS = 120; // 停止输入这么久后才更新联想
+    static constexpr auto METRICS_FILE_ENV = "BUSCENTER_METRICS_FILE";  // 设置后定期把运行指标写到该文件
+    static constexpr int METRICS_FLUSH_MS = 15000;
+    static constexpr int COMPACT_INTERVAL_MS = 60000;     // 定期压缩修改日志的间隔
+    void loadRoutesFromFile();
+    void saveRoutesToFile();
+
+private slots:
+    void loginAsUser();
+    void loginAsAdmin();
+    void logout();
+    void exportRoutes();
+    void importRoutes();
+    void updateBtnState(bool state);
+    void switchToSearch();
+    void switchToRoute();
+    void switchToManage();
+    void searchLines();
+    void searchRouteById();
+    void editRoute(const QString& id);
+    void deleteRoute(const QString& id);
+    void updateStartSuggestions(const QString& text);
+    void updateEndSuggestions(const QString& text);
+    void fillStartFromSuggestion(int idx);
+    void fillEndFromSuggestion(int idx);
+    void onRouteItemDoubleClicked(QListWidgetItem *item);
+    void onRouteContextMenu(const QPoint &pos);
+    void onRouteIdListItemClicked(QListWidgetItem* item);
+    void openRouteEditDialog(const Route* route = nullptr);
+    void onSearchFinished(quint64 requestId, const QString& html, const SearchTrace& trace);
+    void cancelSearch();
+
+signals:
+    // 后台查询完成（在工作线程发出，排队送达界面线程）；未开启耗时记录时 trace 为空
+    void searchFinished(quint64 requestId, const QString& html, const SearchTrace& trace);
+
+
+private:
+    void setupUI();
+    void loadMockData();
+    void refreshAllStops();
+    void rebuildStopIndex();
+    static StopIndex stopIndexFor(const BusNetwork& net);
+    void applyRouteChange(const QString& id, const Route* updated);
+    void rebuildRouteLists();
+    void setRouteItem(int row, const Route& r);
+    void removeRouteItem(int row);
+    void showCurrentTab();
+    void showSuggestions(QComboBox* box, StopMatches& matches, const QString& text);
+    void recordPut(const Route& route);
+    void recordRemove(const QString& id);
+    void compactJournal();
+    void refreshTransferPatterns();
+    void refreshLandmarks();
+    void setupMetrics();
+    void flushMetrics();
+    QVector<Route> routes;
+    RouteEngine engine;       // 由 routes 编译出的线网与查询算法
+    PlanRenderer renderer;    // 方案卡片模板与分段片段缓存，后台查询线程共用
+    QueryCache planCache;     // 已渲染的查询结果，线路变化时按线路淘汰
+    RouteJournal journal{SAVE_FILE};    // 单条修改先记日志，攒够了再在后台写回数据文件
+    bool compacting = false;
+    bool compactAgain = false;          // 写回期间又有需要写回的变化
+    bool routeListsStale = true;    // 线路批量变化后，两个线路列表下次显示前整体重建
+
+    // 后台查询：只接受编号等于 searchSerial 的结果
+    QThreadPool searchPool;
+    quint64 searchSerial = 0;
+    std::shared_ptr<CancelToken> activeSearch;
+    std::shared_ptr<CancelToken> activeImport;    // 后台导入进行中时非空
+    std::shared_ptr<CancelToken> activePatterns;  // 后台计算换乘模式时非空
+    QThreadPool patternPool;                      // 换乘模式专用：单线程、最低优先级，不占查询的线程
+    quint64 patternsReadFor = 0;                  // 已经尝试读过换乘模式文件的线网版本
+    bool preparingLandmarks = false;              // 后台准备地标表时为 true
+    SearchHistory searchHistory;    // 开启耗时记录后每次查询的分阶段耗时，状态栏摘要的提示里列出
+
+    // 运行指标：记录点在 setupMetrics() 中注册一次，后台线程也直接通过这些指针记录（无锁）
+    struct Meters {
+        MetricHistogram* searchTopK;
+        MetricHistogram* searchAt;
+        MetricCounter* searchCancelled;
+        MetricCounter* searchEmpty;
+        MetricHistogram* routeLookup;
+        MetricHistogram* loadSnapshot;
+        MetricHistogram* loadJson;
+        MetricHistogram* importTime;
+        MetricCounter* importedRoutes;
+        MetricCounter* importErrors;
+        MetricHistogram* saveTime;
+        MetricCounter* saveFailures;
+        // 以下在写出前由 flushMetrics() 从引擎与缓存的状态同步
+        MetricCounter* cacheHits;
+        MetricCounter* cacheMisses;
+        MetricCounter* cacheInvalidated;
+        MetricCounter* cacheDisplaced;
+        MetricGauge* cacheEntries;
+        MetricGauge* routeCount;
+        MetricGauge* stopCount;
+    };
+    MetricsRegistry metrics;
+    Meters meters;
+    QString metricsFile;
+    StopIndex stopIndex;      // 按字母序排列的全部站点及其子串索引
+    StopMatches startMatches;
+    StopMatches endMatches;
+    QString currentUserRole;
+
+    // Main layout
+    QStackedWidget* stackedWidget;
+    QWidget* loginPage;
+    QWidget* searchPage;
+    QWidget* routePage;
+    QWidget* managePage;
+
+    // Login
+    QLabel* currentUserLabel;
+    QPushButton* backToManage;
+    QPushButton* backToSearch;
+    QPushButton* backToRoute;
+    QPushButton* logoutBtn;
+
+    // Search Page
+    QLineEdit* startEdit;
+    QLineEdit* endEdit;
+    QComboBox* startSuggest;
+    QComboBox* endSuggest;
+    QTimer* startSuggestTimer;
+    QTimer* endSuggestTimer;
+    QCheckBox* departByTimeCheck;
+    QTimeEdit* departTimeEdit;
+    QPushButton* searchLineBtn;
+    QTextEdit* resultDisplay;
+    QCheckBox* traceCheck;
+    QLabel* traceLabel;
+    // Route Page
+    QLineEdit* routeIdEdit;
+    QPushButton* searchRouteBtn;
+    QTextEdit* routeDetailDisplay;
+    QListWidget* routeIdList;
+
+    // Manage Page
+    QListWidget* routeList;
+    QPushButton* addRouteBtn;
+
+    // Dialogs
+    QWidget* newRouteDialog = nullptr;
+    QLineEdit *newIdEdit, *newNameEdit;
+    QTextEdit *newStopsEdit;
+    QString editingRouteId;
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+};
+
+#endif // MAINWINDOW_H
@@ -0,0 +1,11 @@
+# 性能基准：各热点路径的延迟分位数、吞吐与内存分配，结果输出为 JSON
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = busrouter-bench
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp
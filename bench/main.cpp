@@ -0,0 +1,426 @@
+// 性能基准：对读入建网、查询、换乘枚举与方案渲染等热点路径逐个计时，
+// 在自带数据集和按倍数放大的合成线网上各跑一遍，结果以 JSON 写出，便于不同版本间比较
+#include "routeengine.h"
+#include "routeio.h"
+#include "routejournal.h"
+#include "citygenerator.h"
+#include "networksnapshot.h"
+#include "planrenderer.h"
+#include "utils.h"
+#include "batchrunner.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QRandomGenerator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QHash>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+// ---- 内存分配计数：替换全局 operator new，只统计次数与申请的字节数 ----
+static std::atomic<quint64> allocCount{0};
+static std::atomic<quint64> allocBytes{0};
+
+void* operator new(std::size_t size)
+{
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Dataset {
+    QString name;
+    QString jsonFile;       // 读入场景用的 JSON 文件
+    QVector<Route> routes;
+};
+
+struct Options {
+    int minIterations = 20;
+    qint64 minTimeMs = 300;     // 每个场景至少跑这么久（且不少于 minIterations 次）
+    int maxIterations = 100000;
+    QString filter;
+};
+
+struct Result {
+    QString dataset;
+    QString scenario;
+    int routes = 0;
+    int stops = 0;
+    int iterations = 0;
+    double p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0, meanUs = 0;
+    double opsPerSecond = 0;
+    double allocsPerOp = 0;
+    double bytesPerOp = 0;
+};
+
+double percentile(const QVector<qint64>& sorted, double q)
+{
+    if (sorted.isEmpty()) return 0;
+    const qsizetype i = qMin(sorted.size() - 1, qsizetype(q * double(sorted.size())));
+    return double(sorted[i]) / 1000.0;
+}
+
+// 反复调用 op，逐次计时；op 的参数是第几次调用，场景据此轮换起终点
+Result measure(const Options& opt, const std::function<void(int)>& op)
+{
+    op(0);      // 预热：填充渲染缓存、查询的临时数组等
+
+    QVector<qint64> samples;
+    QElapsedTimer total;
+    QElapsedTimer timer;
+    const quint64 allocs0 = allocCount.load();
+    const quint64 bytes0 = allocBytes.load();
+    total.start();
+    int n = 0;
+    while (n < opt.maxIterations && (n < opt.minIterations || total.elapsed() < opt.minTimeMs)) {
+        timer.start();
+        op(n);
+        samples.append(timer.nsecsElapsed());
+        ++n;
+    }
+    const qint64 elapsedNs = total.nsecsElapsed();
+    const quint64 allocs = allocCount.load() - allocs0;
+    const quint64 bytes = allocBytes.load() - bytes0;
+
+    std::sort(samples.begin(), samples.end());
+    Result r;
+    r.iterations = n;
+    r.p50Us = percentile(samples, 0.50);
+    r.p90Us = percentile(samples, 0.90);
+    r.p99Us = percentile(samples, 0.99);
+    r.maxUs = double(samples.last()) / 1000.0;
+    qint64 sum = 0;
+    for (qint64 s : std::as_const(samples)) sum += s;
+    r.meanUs = double(sum) / n / 1000.0;
+    r.opsPerSecond = elapsedNs > 0 ? n * 1e9 / double(elapsedNs) : 0;
+    // 计数包含 samples 自身扩容，相对每次操作的分配可以忽略
+    r.allocsPerOp = double(allocs) / n;
+    r.bytesPerOp = double(bytes) / n;
+    return r;
+}
+
+// 按倍数放大的合成线网：数据集复制 factor 份，经停线路最多的一成站点（枢纽）各份共用，
+// 其余站点按份改名，于是各份之间只能经枢纽换乘
+QVector<Route> scaled(const QVector<Route>& base, int factor)
+{
+    QHash<QString, int> visits;
+    for (const Route& r : base)
+        for (const QString& s : r.stops) ++visits[s];
+    QVector<QPair<int, QString>> ranked;
+    for (auto it = visits.cbegin(); it != visits.cend(); ++it) ranked.append({ -it.value(), it.key() });
+    std::sort(ranked.begin(), ranked.end());
+    QHash<QString, bool> hubs;
+    for (qsizetype i = 0; i < qMax<qsizetype>(1, ranked.size() / 10); ++i) hubs.insert(ranked[i].second, true);
+
+    QVector<Route> out;
+    out.reserve(base.size() * factor);
+    for (int k = 0; k < factor; ++k) {
+        const QString suffix = QString("·%1").arg(k);
+        for (Route r : base) {
+            r.id += suffix;
+            r.name += suffix;
+            for (QString& s : r.stops)
+                if (!hubs.contains(s)) s += suffix;
+            out.append(r);
+        }
+    }
+    return out;
+}
+
+// 确定性的起终点样本，保证多次运行可比
+QVector<OdPair> samplePairs(const BusNetwork& net, int count)
+{
+    QVector<QString> names;
+    for (const QString& s : net.stops())
+        if (net.stopId(s) != INVALID_STOP) names.append(s);
+    std::sort(names.begin(), names.end());
+    QVector<OdPair> pairs;
+    if (names.size() < 2) return pairs;
+    QRandomGenerator rng(20240601);
+    while (pairs.size() < count) {
+        const QString& a = names[rng.bounded(int(names.size()))];
+        const QString& b = names[rng.bounded(int(names.size()))];
+        if (a != b) pairs.append({ a, b });
+    }
+    return pairs;
+}
+
+void runDataset(const Dataset& data, const Options& opt, QVector<Result>& results, QTextStream& log)
+{
+    QVector<Route> routes = data.routes;
+    RouteEngine engine;
+    engine.setRoutes(routes);
+    const BusNetwork& net = engine.network();
+    const QVector<OdPair> pairs = samplePairs(net, 256);
+    if (pairs.isEmpty()) return;
+
+    auto run = [&](const QString& scenario, const std::function<void(int)>& op) {
+        if (!opt.filter.isEmpty() && !scenario.contains(opt.filter)) return;
+        Result r = measure(opt, op);
+        r.dataset = data.name;
+        r.scenario = scenario;
+        r.routes = int(routes.size());
+        r.stops = net.stopCount();
+        log << QString("%1 %2  n=%3  p50=%4us p99=%5us  %6 op/s  %7 alloc/op\n")
+                   .arg(data.name, -16).arg(scenario, -18).arg(r.iterations, 6)
+                   .arg(r.p50Us, 0, 'f', 1).arg(r.p99Us, 0, 'f', 1)
+                   .arg(r.opsPerSecond, 0, 'f', 0).arg(r.allocsPerOp, 0, 'f', 1);
+        log.flush();
+        results.append(r);
+    };
+
+    // 读入：解析 JSON、建网（含倒排索引、换乘图与时刻表）、读快照。
+    // 快照写到临时目录，不碰数据文件旁边界面自己的那份
+    const QString snapshotFile = QDir::temp().filePath(QString("busrouter-bench-%1-%2.snap")
+                                                           .arg(QCoreApplication::applicationPid()).arg(data.name));
+    QFile json(data.jsonFile);
+    const QByteArray jsonData = json.open(QIODevice::ReadOnly) ? json.readAll() : QByteArray();
+    // 快照写不出或读回时对不上 JSON，计时的就只是失败路径，这种情况跳过 load.snapshot
+    BusNetwork probe;
+    QString snapshotError;
+    const bool snapshotOk = NetworkSnapshot::save(snapshotFile, net, jsonData)
+                            && NetworkSnapshot::load(snapshotFile, data.jsonFile, probe, &snapshotError);
+    if (!snapshotOk) {
+        log << QString("%1 load.snapshot 跳过：快照不可用 %2\n").arg(data.name, snapshotError);
+        log.flush();
+    }
+    run("load.parse", [&](int) {
+        QVector<Route> parsed;
+        routesFromJson(jsonData, parsed);
+    });
+    run("load.build", [&](int) {
+        QVector<Route> copy = routes;
+        RouteEngine e;
+        e.setRoutes(copy);
+    });
+    if (snapshotOk) {
+        run("load.snapshot", [&](int) {
+            BusNetwork loaded;
+            NetworkSnapshot::load(snapshotFile, data.jsonFile, loaded);
+        });
+    }
+    QFile::remove(snapshotFile);
+
+    // 查询：与界面的 searchLines 相同的入口
+    run("search.topk", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        engine.searchTopK(p.start, p.end, 5);
+    });
+    run("search.pareto", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        engine.search(p.start, p.end);
+    });
+    run("search.at", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        engine.searchAt(p.start, p.end, 7 * 60 + (i * 7) % 720);
+    });
+    // 最快方案：地标表只算一次（也单独计时），与不带地标的同一 A*（即 Dijkstra）对比
+    run("load.landmarks", [&](int) {
+        LandmarkTable table;
+        table.build(net);
+    });
+    LandmarkTable landmarks;
+    landmarks.build(net);
+    engine.setLandmarks(landmarks);
+    run("search.fastest", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        engine.searchFastest(p.start, p.end);
+    });
+    RouteEngine unguided(engine);
+    unguided.setLandmarks(LandmarkTable());
+    run("search.dijkstra", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        unguided.searchFastest(p.start, p.end);
+    });
+    // 换乘模式：只为样本里出现的起点预先计算，放在副本上，不影响上面各场景的 RAPTOR 计时
+    QVector<StopId> origins;
+    for (const OdPair& p : pairs) origins.append(net.stopId(p.start));
+    std::sort(origins.begin(), origins.end());
+    origins.erase(std::unique(origins.begin(), origins.end()), origins.end());
+    RouteEngine patterned(engine);
+    patterned.mergeTransferPatterns(TransferPatterns::compute(net, origins), net.version());
+    run("search.patterns", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        patterned.search(p.start, p.end);
+    });
+    run("transfers.once", [&](int i) {
+        const OdPair& p = pairs[i % pairs.size()];
+        calculateTransfers(net, p.start, p.end);
+    });
+
+    // 渲染：先把各起终点的方案算好，只计 HTML 生成；渲染器共用，片段缓存处于热状态
+    QVector<QVector<Journey>> plans;
+    for (const OdPair& p : pairs) plans.append(engine.searchTopK(p.start, p.end, 5));
+    PlanRenderer html(PlanRenderer::Html);
+    run("render.html", [&](int i) {
+        QString out;
+        const int k = i % int(pairs.size());
+        html.renderPlans(out, net, plans[k], pairs[k].start, pairs[k].end);
+    });
+    run("render.html.cold", [&](int i) {
+        PlanRenderer fresh(PlanRenderer::Html);
+        QString out;
+        const int k = i % int(pairs.size());
+        fresh.renderPlans(out, net, plans[k], pairs[k].start, pairs[k].end);
+    });
+}
+
+QJsonObject toJson(const Result& r)
+{
+    QJsonObject o;
+    o["dataset"] = r.dataset;
+    o["scenario"] = r.scenario;
+    o["routes"] = r.routes;
+    o["stops"] = r.stops;
+    o["iterations"] = r.iterations;
+    o["p50Us"] = r.p50Us;
+    o["p90Us"] = r.p90Us;
+    o["p99Us"] = r.p99Us;
+    o["maxUs"] = r.maxUs;
+    o["meanUs"] = r.meanUs;
+    o["opsPerSecond"] = r.opsPerSecond;
+    o["allocsPerOp"] = r.allocsPerOp;
+    o["bytesPerOp"] = r.bytesPerOp;
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("busrouter-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "查询引擎性能基准。对每个数据集依次测量：\n"
+        "  load.parse / load.build / load.snapshot   解析 JSON、建网、读快照\n"
+        "  search.topk / search.pareto / search.at   前 k 个方案、Pareto 方案、按时刻查询\n"
+        "  load.landmarks                             选地标并计算地标距离表\n"
+        "  search.fastest / search.dijkstra          总时间最短的方案（地标引导的 A* / 无地标）\n"
+        "  search.patterns                            按预先算好的换乘模式求 Pareto 方案\n"
+        "  transfers.once                             一次换乘方案枚举（calculateTransfers）\n"
+        "  render.html / render.html.cold             方案卡片 HTML（片段缓存热 / 冷）\n"
+        "结果（延迟分位数、吞吐、每次操作的内存分配）以 JSON 写到 --output 或标准输出，进度写到标准错误。");
+    parser.addHelpOption();
+    parser.addPositionalArgument("data", "线路数据文件，可给多个（默认 bus_routes0.json bus_routes1.json）", "[data...]");
+    QCommandLineOption scaleOption("scale", "再把最后一个数据集放大这些倍数（逗号分隔），如 10,100", "factors", "10,50");
+    QCommandLineOption timeOption("min-time", "每个场景至少运行的毫秒数", "ms", "300");
+    QCommandLineOption iterOption("min-iterations", "每个场景至少运行的次数", "n", "20");
+    QCommandLineOption filterOption("filter", "只运行名称包含该字符串的场景", "text");
+    QCommandLineOption outputOption({ "o", "output" }, "JSON 结果文件（默认标准输出）", "file");
+    QCommandLineOption syntheticOption("synthetic", "另外生成这些线路条数的合成线网（逗号分隔，默认参数），如 1000,5000",
+                                       "routes");
+    parser.addOption(scaleOption);
+    parser.addOption(syntheticOption);
+    parser.addOption(timeOption);
+    parser.addOption(iterOption);
+    parser.addOption(filterOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    Options opt;
+    opt.minTimeMs = parser.value(timeOption).toLongLong();
+    opt.minIterations = qMax(1, parser.value(iterOption).toInt());
+    opt.filter = parser.value(filterOption);
+
+    QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) files = QStringList{ "bus_routes0.json", "bus_routes1.json" };
+    QVector<Dataset> datasets;
+    for (const QString& f : std::as_const(files)) {
+        Dataset d;
+        d.name = QFileInfo(f).completeBaseName();
+        d.jsonFile = f;
+        // 与界面读到的一致：含修改日志里还没写回数据文件的修改
+        BusNetwork network;
+        QString error;
+        if (!RouteJournal::load(f, network, nullptr, &error)) {
+            err << "无法读取线路数据 " << f << "：" << error << "\n";
+            return 1;
+        }
+        d.routes = network.routes();
+        datasets.append(d);
+    }
+
+    // 放大的数据集和合成线网写到临时目录，读入场景照样从文件开始
+    QStringList temporary;
+    auto addTemporary = [&](Dataset d) {
+        d.jsonFile = QDir::temp().filePath(QString("busrouter-bench-%1-%2.json")
+                                               .arg(QCoreApplication::applicationPid()).arg(d.name));
+        if (!saveRoutes(d.jsonFile, d.routes)) {
+            err << "无法写入临时文件 " << d.jsonFile << "\n";
+            return false;
+        }
+        temporary.append(d.jsonFile);
+        datasets.append(d);
+        return true;
+    };
+    const Dataset base = datasets.last();
+    for (const QString& f : parser.value(scaleOption).split(',', Qt::SkipEmptyParts)) {
+        const int factor = f.toInt();
+        if (factor <= 1) continue;
+        Dataset d;
+        d.name = QString("%1x%2").arg(base.name).arg(factor);
+        d.routes = scaled(base.routes, factor);
+        if (!addTemporary(d)) return 1;
+    }
+    for (const QString& n : parser.value(syntheticOption).split(',', Qt::SkipEmptyParts)) {
+        CityParams city;
+        city.routes = n.toInt();
+        if (city.routes <= 0) continue;
+        Dataset d;
+        d.name = QString("city%1").arg(city.routes);
+        d.routes = generateCity(city);
+        if (!addTemporary(d)) return 1;
+    }
+
+    QVector<Result> results;
+    for (const Dataset& d : std::as_const(datasets)) runDataset(d, opt, results, err);
+    for (const QString& f : std::as_const(temporary)) QFile::remove(f);
+
+    QJsonObject root;
+    root["format"] = 1;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qt"] = QString(qVersion());
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["os"] = QSysInfo::prettyProductName();
+    QJsonArray list;
+    for (const Result& r : std::as_const(results)) list.append(toJson(r));
+    root["results"] = list;
+    const QByteArray out = QJsonDocument(root).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            err << "无法写入 " << file.fileName() << "：" << file.errorString() << "\n";
+            return 1;
+        }
+        file.write(out);
+    } else {
+        QFile stdoutFile;
+        stdoutFile.open(stdout, QIODevice::WriteOnly);
+        stdoutFile.write(out);
+    }
+    return 0;
+}
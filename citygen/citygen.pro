@@ -0,0 +1,11 @@
+# 合成线网生成器：按参数和种子生成大规模线路数据，用于本地复现生产规模的负载
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = busrouter-citygen
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp
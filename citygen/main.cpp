@@ -0,0 +1,122 @@
+// 合成线网生成器：输出与 bus_routes*.json 相同格式的线路数据，规模、枢纽密度和换乘重叠度可调，
+// 同样的参数和种子总是得到同一份文件
+#include "citygenerator.h"
+#include "routeio.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFile>
+#include <QSet>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("busrouter-citygen");
+
+    const CityParams defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "生成网格状城市的合成公交线网（JSON，格式与 bus_routes0.json 相同）。\n"
+        "站点位于街道交叉口，线路沿街道经过若干枢纽；--overlap 越大，线路之间共用的站点越多。\n"
+        "统计信息（站点数、枢纽数、每站平均线路数）写到标准错误。");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "随机种子", "n", QString::number(defaults.seed));
+    QCommandLineOption routesOption({ "r", "routes" }, "线路条数", "n", QString::number(defaults.routes));
+    QCommandLineOption stopsOption("stops", "每条线路的站数范围", "min-max",
+                                   QString("%1-%2").arg(defaults.minStops).arg(defaults.maxStops));
+    QCommandLineOption hubOption("hub-ratio", "枢纽站占全部站点的比例", "ratio", QString::number(defaults.hubRatio));
+    QCommandLineOption hubsPerRouteOption("hubs-per-route", "每条线路途经的枢纽数", "n",
+                                          QString::number(defaults.hubsPerRoute));
+    QCommandLineOption overlapOption("overlap", "换乘重叠度 0~1：经停中落在其他线路已有站点上的大致比例",
+                                     "ratio", QString::number(defaults.overlap));
+    QCommandLineOption segmentOption("segment", "相邻两站的行驶分钟数范围", "min-max",
+                                     QString("%1-%2").arg(defaults.minSegment).arg(defaults.maxSegment));
+    QCommandLineOption outputOption({ "o", "output" }, "输出文件（默认标准输出）", "file");
+    parser.addOption(seedOption);
+    parser.addOption(routesOption);
+    parser.addOption(stopsOption);
+    parser.addOption(hubOption);
+    parser.addOption(hubsPerRouteOption);
+    parser.addOption(overlapOption);
+    parser.addOption(segmentOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    // "12-30" 或单个数 "20"（上下限相同）
+    auto parseRange = [&](const QCommandLineOption& option, int& low, int& high) {
+        const QStringList parts = parser.value(option).split('-');
+        bool okLow = false, okHigh = false;
+        low = parts.value(0).toInt(&okLow);
+        high = parts.value(parts.size() - 1).toInt(&okHigh);
+        if (parts.size() > 2 || !okLow || !okHigh || low < 1 || high < low) {
+            err << "无效的范围 --" << option.names().constLast() << " " << parser.value(option) << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    CityParams p;
+    bool ok = true;
+    p.seed = parser.value(seedOption).toUInt(&ok);
+    if (!ok) {
+        err << "无效的种子：" << parser.value(seedOption) << "\n";
+        return 1;
+    }
+    p.routes = parser.value(routesOption).toInt(&ok);
+    if (!ok || p.routes < 1) {
+        err << "无效的线路条数：" << parser.value(routesOption) << "\n";
+        return 1;
+    }
+    if (!parseRange(stopsOption, p.minStops, p.maxStops)) return 1;
+    if (p.minStops < 2) {
+        err << "每条线路至少 2 站\n";
+        return 1;
+    }
+    if (!parseRange(segmentOption, p.minSegment, p.maxSegment)) return 1;
+    p.hubRatio = parser.value(hubOption).toDouble(&ok);
+    if (!ok || p.hubRatio < 0 || p.hubRatio > 1) {
+        err << "枢纽比例应在 0~1 之间：" << parser.value(hubOption) << "\n";
+        return 1;
+    }
+    p.hubsPerRoute = parser.value(hubsPerRouteOption).toInt(&ok);
+    if (!ok || p.hubsPerRoute < 0) {
+        err << "无效的枢纽数：" << parser.value(hubsPerRouteOption) << "\n";
+        return 1;
+    }
+    p.overlap = parser.value(overlapOption).toDouble(&ok);
+    if (!ok || p.overlap < 0 || p.overlap >= 1) {
+        err << "重叠度应在 0~1 之间（不含 1）：" << parser.value(overlapOption) << "\n";
+        return 1;
+    }
+
+    const QVector<Route> routes = generateCity(p);
+
+    QFile out;
+    const QString outFile = parser.value(outputOption);
+    const bool opened = outFile.isEmpty() ? out.open(stdout, QIODevice::WriteOnly)
+                                          : (out.setFileName(outFile), out.open(QIODevice::WriteOnly));
+    if (!opened) {
+        err << "无法写入 " << outFile << "：" << out.errorString() << "\n";
+        return 1;
+    }
+    out.write(routesToJson(routes));
+    out.close();
+
+    QSet<QString> stops;
+    int hubs = 0;
+    qint64 visits = 0;
+    for (const Route& r : routes) {
+        visits += r.stops.size();
+        for (const QString& s : r.stops)
+            if (!stops.contains(s)) {
+                stops.insert(s);
+                if (s.endsWith(QStringLiteral("枢纽"))) ++hubs;
+            }
+    }
+    err << QString("%1 条线路，%2 个站点（%3 个枢纽），每站平均 %4 条线路\n")
+               .arg(routes.size()).arg(stops.size()).arg(hubs)
+               .arg(stops.isEmpty() ? 0.0 : double(visits) / stops.size(), 0, 'f', 2);
+    return 0;
+}
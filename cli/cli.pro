@@ -0,0 +1,16 @@
+# 命令行查询工具：从标准输入逐行读取查询，结果写到标准输出
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = busrouter-cli
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,196 @@
+#include "routeengine.h"
+#include "routejournal.h"
+#include "batchrunner.h"
+#include "planrenderer.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTime>
+#include <QFile>
+
+// 处理一行查询：  起点 终点 [HH:mm]
+// Json 格式下每行查询输出一个对象 {"from","to","journeys":[…]}，出错时带 "error"。
+// fastest 时不限时刻的查询只给出总时间最短的一个方案
+static void runQuery(QTextStream& out, RouteEngine& engine, PlanRenderer& renderer,
+                     const QStringList& args, int maxTransfers, bool fastest)
+{
+    const QString& start = args[0];
+    const QString& end = args[1];
+    const bool json = renderer.format() == PlanRenderer::Json;
+    QString text;
+    auto fail = [&](const QString& message) {
+        if (json) {
+            text = QLatin1String("{\"from\":");
+            PlanRenderer::appendJsonString(text, start);
+            text += QLatin1String(",\"to\":");
+            PlanRenderer::appendJsonString(text, end);
+            text += QLatin1String(",\"error\":");
+            PlanRenderer::appendJsonString(text, message);
+            text += QLatin1String("}\n");
+        } else {
+            text = message + "\n";
+        }
+        out << text;
+    };
+    auto emitPlans = [&](const QVector<Journey>& journeys) {
+        if (json) {
+            text = QLatin1String("{\"from\":");
+            PlanRenderer::appendJsonString(text, start);
+            text += QLatin1String(",\"to\":");
+            PlanRenderer::appendJsonString(text, end);
+            text += QLatin1String(",\"journeys\":");
+        }
+        renderer.renderPlans(text, engine.network(), journeys, start, end);
+        if (json) text += QLatin1String("}\n");
+        out << text;
+    };
+
+    for (const QString& stop : { start, end }) {
+        if (engine.network().stopId(stop) == INVALID_STOP) {
+            fail("未知站点：" + stop);
+            return;
+        }
+    }
+    if (start == end) {
+        fail("起点与终点相同，无需乘车。");
+        return;
+    }
+
+    if (args.size() >= 3) {
+        const QTime t = QTime::fromString(args[2], "HH:mm");
+        if (!t.isValid()) {
+            fail("出发时间格式应为 HH:mm：" + args[2]);
+            return;
+        }
+        const Journey j = engine.searchAt(start, end, t.hour() * 60 + t.minute());
+        if (j.legs.isEmpty())
+            fail(args[2] + " 之后已没有从 " + start + " 到 " + end + " 的可乘车次。");
+        else
+            emitPlans({ j });
+        return;
+    }
+
+    if (fastest) {
+        const Journey j = engine.searchFastest(start, end);
+        if (j.legs.isEmpty())
+            fail("未找到从 " + start + " 到 " + end + " 的可行路线。");
+        else
+            emitPlans({ j });
+        return;
+    }
+
+    const QVector<Journey> journeys = engine.search(start, end, maxTransfers);
+    if (journeys.isEmpty()) {
+        fail("未找到从 " + start + " 到 " + end + " 的可行路线。");
+        return;
+    }
+    emitPlans(journeys);
+}
+
+// 批量模式：结果以 JSON Lines 流式写出，吞吐量统计写到标准错误
+static int runBatch(const BusNetwork& network, const QString& odFile, const QString& outFile,
+                    int threads, int maxTransfers)
+{
+    QTextStream err(stderr);
+    QVector<OdPair> pairs;
+    QString error;
+    if (!BatchRunner::readOdFile(odFile, pairs, &error)) {
+        err << "无法读取起终点列表 " << odFile << "：" << error << "\n";
+        return 1;
+    }
+
+    QFile out;
+    const bool opened = outFile.isEmpty() ? out.open(stdout, QIODevice::WriteOnly)
+                                          : (out.setFileName(outFile), out.open(QIODevice::WriteOnly));
+    if (!opened) {
+        err << "无法写入 " << outFile << "：" << out.errorString() << "\n";
+        return 1;
+    }
+
+    BatchRunner runner(network);
+    const BatchStats stats = runner.run(pairs, [&out](const QByteArray& lines) { out.write(lines); },
+                                        threads, maxTransfers);
+    out.close();
+
+    err << QString("%1 条查询（%2 条有可行方案），%3 个线程，用时 %4 秒，%5 条/秒\n")
+               .arg(stats.queries).arg(stats.found).arg(stats.threads)
+               .arg(stats.elapsedMs / 1000.0, 0, 'f', 3)
+               .arg(stats.queriesPerSecond(), 0, 'f', 0);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("busrouter-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "公交线路查询（命令行）。从标准输入逐行读取查询：\n"
+        "  起点 终点          不限时刻，列出 (总时间, 换乘次数) 的 Pareto 方案\n"
+        "  起点 终点 HH:mm    按出发时间查询最早到达的方案\n"
+        "输入 quit 退出。\n"
+        "指定 --batch 时改为批量模式：读取起终点列表文件，多线程查询，每条结果输出一行 JSON。");
+    parser.addHelpOption();
+    QCommandLineOption fileOption({ "f", "file" }, "线路数据文件", "file", "bus_routes.json");
+    QCommandLineOption transfersOption({ "n", "max-transfers" }, "最多换乘次数（默认不限）", "n", "-1");
+    QCommandLineOption batchOption("batch", "批量查询的起终点列表（每行“起点 终点”）", "od-file");
+    QCommandLineOption threadsOption({ "j", "threads" }, "批量模式的工作线程数（默认等于 CPU 核数）", "n", "0");
+    QCommandLineOption outputOption({ "o", "output" }, "批量模式的 JSON Lines 输出文件（默认标准输出）", "file");
+    QCommandLineOption formatOption("format", "交互模式的输出格式：text 或 json（每行查询一个 JSON 对象）", "format", "text");
+    QCommandLineOption fastestOption("fastest", "交互模式不限时刻的查询只给出总时间最短的一个方案（地标引导的 A*）");
+    parser.addOption(fileOption);
+    parser.addOption(transfersOption);
+    parser.addOption(batchOption);
+    parser.addOption(threadsOption);
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(fastestOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QString format = parser.value(formatOption);
+    if (format != "text" && format != "json") {
+        err << "未知的输出格式：" << format << "（可选 text、json）\n";
+        return 1;
+    }
+
+    // 图形界面保存线路时会在旁边写一份线网快照，与 JSON 内容一致时直接使用；界面还没写回的修改日志一并重放
+    const QString dataFile = parser.value(fileOption);
+    BusNetwork network;
+    QString error;
+    if (!RouteJournal::load(dataFile, network, nullptr, &error)) {
+        err << "无法读取线路数据 " << dataFile << "：" << error << "\n";
+        return 1;
+    }
+    RouteEngine engine;
+    engine.setNetwork(network);
+    const int maxTransfers = parser.value(transfersOption).toInt();
+
+    if (parser.isSet(batchOption))
+        return runBatch(engine.network(), parser.value(batchOption), parser.value(outputOption),
+                        parser.value(threadsOption).toInt(), maxTransfers);
+
+    // 地标表（前 k 方案与 --fastest 的下界）同样保存在数据文件旁边，只有第一次或线网变化后才重新计算
+    const bool fastest = parser.isSet(fastestOption);
+    engine.prepareLandmarks(dataFile);
+
+    PlanRenderer renderer(format == "json" ? PlanRenderer::Json : PlanRenderer::Text);
+    QTextStream in(stdin);
+    QString line;
+    while (in.readLineInto(&line)) {
+        const QStringList args = line.split(' ', Qt::SkipEmptyParts);
+        if (args.isEmpty() || args[0].startsWith('#')) continue;
+        if (args[0] == "quit" || args[0] == "exit") break;
+        if (args.size() < 2) {
+            out << "用法：起点 终点 [HH:mm]\n";
+        } else {
+            runQuery(out, engine, renderer, args, maxTransfers, fastest);
+        }
+        out.flush();
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "altplanner.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+namespace {
+constexpr int INF = INT_MAX / 2;
+}
+
+AltPlanner::AltPlanner(const BusNetwork& network)
+    : net(network)
+{
+}
+
+// 线网每次修改都换版本号，线路节点的编号随之重排，临时数组一并重新分配
+void AltPlanner::prepareLayout()
+{
+    if (layoutVersion == net.version() && routeBase.size() == net.routeCount()) return;
+    layoutVersion = net.version();
+    const int stopCount = net.stopCount();
+    routeBase.resize(net.routeCount());
+    nodeRoute.clear();
+    int next = stopCount;
+    for (int r = 0; r < net.routeCount(); ++r) {
+        routeBase[r] = next;
+        const int n = net.route(r).stopCount();
+        nodeRoute.insert(nodeRoute.size(), n, r);
+        next += n;
+    }
+    best.fill(INF, next);
+    parent.fill(-1, next);
+    heuristic.fill(-1, stopCount);
+    touchedNodes.clear();
+    touchedStops.clear();
+}
+
+StopId AltPlanner::stopOf(int node) const
+{
+    if (node < net.stopCount()) return StopId(node);
+    const int r = nodeRoute[node - net.stopCount()];
+    return net.route(r).stopAt(node - routeBase[r]);
+}
+
+Journey AltPlanner::plan(StopId from, StopId to, const LandmarkTable& landmarks,
+                         const CancelToken* cancel, SearchTrace* trace)
+{
+    SearchTrace::Scope scope(trace, SearchTrace::AStar);
+    if (from == INVALID_STOP || to == INVALID_STOP || from == to) return Journey();
+    prepareLayout();
+
+    // 上一次查询留下的改动
+    for (int n : std::as_const(touchedNodes)) {
+        best[n] = INF;
+        parent[n] = -1;
+    }
+    for (StopId s : std::as_const(touchedStops)) heuristic[s] = -1;
+    touchedNodes.clear();
+    touchedStops.clear();
+
+    // 地标表与线网不对应（如增量修改后还没重算）时不用它，退化为 Dijkstra
+    const bool guided = landmarks.stopCount() == net.stopCount();
+    auto estimate = [&](StopId s) {
+        if (!guided) return 0;
+        if (heuristic[s] < 0) {
+            heuristic[s] = landmarks.lowerBound(s, to);
+            touchedStops.append(s);
+        }
+        return heuristic[s];
+    };
+
+    // (f, g, 节点)；同一节点可能入队多次，出队时 g 大于已知值的直接丢弃
+    using Item = std::tuple<int, int, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    auto relax = [&](int node, int g, int via) {
+        if (g >= best[node]) return;
+        if (best[node] == INF) touchedNodes.append(node);
+        best[node] = g;
+        parent[node] = via;
+        const int h = estimate(stopOf(node));
+        if (h < LandmarkTable::UNREACHABLE) queue.push({g + h, g, node});
+    };
+
+    relax(int(from), 0, -1);
+    if (queue.empty()) return Journey();    // 下界表明两站不连通
+    const int stopCount = net.stopCount();
+    quint64 settled = 0;
+    bool reached = false;
+    while (!queue.empty()) {
+        if (cancel && cancel->isCancelled()) return Journey();
+        const auto [f, g, node] = queue.top();
+        queue.pop();
+        if (g > best[node]) continue;
+        ++settled;
+        if (node == int(to)) {
+            reached = true;
+            break;
+        }
+
+        if (node < stopCount) {
+            // 在站上：登上经过本站的各线路；起点上车不算换乘
+            const StopId s = StopId(node);
+            const int boardAt = g + (s == from ? 0 : TRANSFER_MINUTES);
+            for (const StopVisit& v : net.visitsAt(s)) {
+                const RouteView rv = net.route(v.route);
+                if (!rv.hasTravelTimes()) continue;
+                for (int p = int(v.pos); p <= int(v.lastPos); ++p)
+                    if (rv.stopAt(p) == s) relax(routeBase[v.route] + p, boardAt, node);
+            }
+        } else {
+            // 在车上：下车，或沿线路前后行驶一站
+            const int r = nodeRoute[node - stopCount];
+            const int p = node - routeBase[r];
+            const RouteView rv = net.route(r);
+            relax(int(rv.stopAt(p)), g, node);
+            if (p > 0) relax(node - 1, g + rv.travelTime(p, p - 1), node);
+            if (p + 1 < rv.stopCount()) relax(node + 1, g + rv.travelTime(p, p + 1), node);
+        }
+    }
+    scope.count(settled);
+    return reached ? extract(to) : Journey();
+}
+
+// 沿 parent 回溯得到节点序列，连续的线路节点合并为一段乘车
+Journey AltPlanner::extract(StopId to) const
+{
+    QVector<int> nodes;
+    for (int n = int(to); n != -1; n = parent[n]) nodes.append(n);
+    std::reverse(nodes.begin(), nodes.end());
+
+    Journey j;
+    j.totalMinutes = best[int(to)];
+    const int stopCount = net.stopCount();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i] < stopCount) continue;
+        const int r = nodeRoute[nodes[i] - stopCount];
+        const int fromPos = nodes[i] - routeBase[r];
+        while (i + 1 < nodes.size() && nodes[i + 1] >= stopCount) ++i;
+        j.legs.append(JourneyLeg{r, fromPos, nodes[i] - routeBase[r]});
+    }
+    return j;
+}
@@ -0,0 +1,47 @@
+#ifndef ALTPLANNER_H
+#define ALTPLANNER_H
+
+#include "network.h"
+#include "journey.h"
+#include "landmarks.h"
+#include "canceltoken.h"
+#include "searchtrace.h"
+#include <QVector>
+
+// 总时间最短的单个方案（行驶时间 + 每次换乘 TRANSFER_MINUTES），A* 搜索，以 LandmarkTable 的下界为启发值。
+// 节点分两类：站点，以及“坐在某条线路第 p 站的车上”；边为上车（首次免费，之后记换乘时间）、
+// 沿线路前后行驶一站、下车。启发值只看所在站点、不计换乘，对每条边都满足一致性，
+// 所以节点首次出队即为最优，终点出队就可以结束，不必像 Dijkstra 那样扫到与终点等距的整个范围。
+// 地标表为空时启发值为 0，退化为 Dijkstra，结果不变。
+// 和 RaptorPlanner 一样持有可复用的临时数组，每个线程各用一个实例
+class AltPlanner
+{
+public:
+    static constexpr int TRANSFER_MINUTES = 3;
+
+    explicit AltPlanner(const BusNetwork& network);
+
+    // 不可达或取消时返回 legs 为空的 Journey；trace 非空时记录 SearchTrace::AStar 阶段（候选为出队的节点）
+    Journey plan(StopId from, StopId to, const LandmarkTable& landmarks,
+                 const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+
+private:
+    void prepareLayout();
+    StopId stopOf(int node) const;
+    Journey extract(StopId to) const;
+
+    const BusNetwork& net;
+    quint64 layoutVersion = 0;      // 下面两个数组对应的线网版本
+    QVector<int> routeBase;         // 线路 r 第 p 站的节点编号为 routeBase[r] + p
+    QVector<int> nodeRoute;         // 线路节点（减去站点数后）所属的线路
+
+    // 以下数组只在布局变化时整体分配；每次查询结束后按 touched 只复位改动过的元素，
+    // 查询的开销与搜索到的范围成正比，而不是与线网规模成正比
+    QVector<int> best;              // 各节点的已知最短时间 g
+    QVector<int> parent;            // 最短路上的前一个节点
+    QVector<int> heuristic;         // 各站到终点的下界，-1 表示还没算过
+    QVector<int> touchedNodes;
+    QVector<StopId> touchedStops;
+};
+
+#endif // ALTPLANNER_H
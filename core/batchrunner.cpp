@@ -0,0 +1,160 @@
+#include "batchrunner.h"
+#include "raptor.h"
+#include "planrenderer.h"
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QRegularExpression>
+#include <memory>
+
+namespace {
+
+constexpr int GRAIN = 16;                   // 每次从自己的区间取出的查询数
+constexpr int FLUSH_BYTES = 64 * 1024;      // 线程本地输出缓冲攒到这么大才交给 sink
+
+// 一个工作线程尚未处理的下标区间 [begin, end)
+struct WorkRange {
+    QMutex lock;
+    int begin = 0;
+    int end = 0;
+};
+
+bool takeOwn(WorkRange& r, int& b, int& e)
+{
+    QMutexLocker locker(&r.lock);
+    if (r.begin >= r.end) return false;
+    b = r.begin;
+    e = qMin(r.end, b + GRAIN);
+    r.begin = e;
+    return true;
+}
+
+// 从 victim 尾部取走剩余的一半放进 own；同一时刻只持有一把锁，不会死锁
+bool steal(WorkRange& victim, WorkRange& own)
+{
+    int b, e;
+    {
+        QMutexLocker locker(&victim.lock);
+        const int remaining = victim.end - victim.begin;
+        if (remaining <= 0) return false;
+        e = victim.end;
+        b = e - (remaining + 1) / 2;
+        victim.end = b;
+    }
+    QMutexLocker locker(&own.lock);
+    own.begin = b;
+    own.end = e;
+    return true;
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(const BusNetwork& network)
+    : net(network)
+{
+}
+
+BatchStats BatchRunner::run(const QVector<OdPair>& pairs, const Sink& sink, int threads, int maxTransfers)
+{
+    BatchStats stats;
+    stats.queries = pairs.size();
+    stats.threads = threads > 0 ? threads : qMax(1, QThread::idealThreadCount());
+    const int workers = stats.threads;
+
+    // 先均分，之后靠窃取平衡
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[workers]);
+    for (int w = 0; w < workers; ++w) {
+        ranges[w].begin = int(qint64(pairs.size()) * w / workers);
+        ranges[w].end = int(qint64(pairs.size()) * (w + 1) / workers);
+    }
+
+    QMutex sinkLock;
+    QAtomicInt found;
+    QElapsedTimer timer;
+    timer.start();
+
+    auto work = [&](int self) {
+        RaptorPlanner planner(net);     // 查询临时数组按线程独占，线网只读共享
+        PlanRenderer renderer(PlanRenderer::Json);
+        QByteArray buffer;
+        QString line;
+        auto flush = [&] {
+            if (buffer.isEmpty()) return;
+            QMutexLocker locker(&sinkLock);
+            sink(buffer);
+            buffer.clear();
+        };
+
+        int b, e;
+        for (;;) {
+            if (!takeOwn(ranges[self], b, e)) {
+                bool stolen = false;
+                for (int k = 1; k < workers && !stolen; ++k)
+                    stolen = steal(ranges[(self + k) % workers], ranges[self]);
+                if (!stolen) break;     // 所有区间都空了（正在转移中的区间由窃取者负责）
+                continue;
+            }
+            for (int i = b; i < e; ++i) {
+                const OdPair& od = pairs[i];
+                line = QString("{\"id\":%1,\"from\":").arg(i);
+                PlanRenderer::appendJsonString(line, od.start);
+                line += QLatin1String(",\"to\":");
+                PlanRenderer::appendJsonString(line, od.end);
+                const StopId from = net.stopId(od.start);
+                const StopId to = net.stopId(od.end);
+                if (from == INVALID_STOP || to == INVALID_STOP) {
+                    line += QLatin1String(",\"error\":\"unknown stop\"}");
+                } else {
+                    const QVector<Journey> journeys = planner.plan(from, to, maxTransfers);
+                    line += QLatin1String(",\"journeys\":");
+                    renderer.renderPlans(line, net, journeys, od.start, od.end);
+                    line += '}';
+                    if (!journeys.isEmpty()) found.fetchAndAddRelaxed(1);
+                }
+                buffer += line.toUtf8();
+                buffer += '\n';
+            }
+            if (buffer.size() >= FLUSH_BYTES) flush();
+        }
+        flush();
+    };
+
+    QVector<QThread*> pool;
+    for (int w = 1; w < workers; ++w) {
+        pool.append(QThread::create(work, w));
+        pool.last()->start();
+    }
+    work(0);    // 调用线程自己也做 0 号工作线程
+    for (QThread* t : std::as_const(pool)) {
+        t->wait();
+        delete t;
+    }
+
+    stats.elapsedMs = timer.elapsed();
+    stats.found = found.loadRelaxed();
+    return stats;
+}
+
+bool BatchRunner::readOdFile(const QString& fileName, QVector<OdPair>& pairs, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    static const QRegularExpression separators("[\\s,]+");
+    QTextStream in(&file);
+    QString line;
+    while (in.readLineInto(&line)) {
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        const QStringList parts = line.split(separators, Qt::SkipEmptyParts);
+        if (parts.size() < 2) continue;
+        pairs.append(OdPair{parts[0], parts[1]});
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "network.h"
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <functional>
+
+// 一条起终点查询
+struct OdPair {
+    QString start;
+    QString end;
+};
+
+struct BatchStats {
+    int queries = 0;
+    int found = 0;          // 有可行方案的查询数
+    int threads = 0;
+    qint64 elapsedMs = 0;
+
+    double queriesPerSecond() const { return elapsedMs > 0 ? queries * 1000.0 / elapsedMs : 0.0; }
+};
+
+// 批量起终点查询：多个工作线程共享只读的线网，各自持有一个 RaptorPlanner。
+// 查询按下标区间分给各线程，做完自己的区间后从其他线程的区间尾部窃取一半（work stealing），
+// 避免个别线程分到慢查询时其余线程空等。
+// 每条查询的结果序列化为一行 JSON，由各线程攒够一批后交给 sink；sink 的调用已加锁串行化，
+// 但行的先后顺序不保证与输入一致，以 "id"（输入下标）对应。
+class BatchRunner
+{
+public:
+    using Sink = std::function<void(const QByteArray& lines)>;
+
+    explicit BatchRunner(const BusNetwork& network);
+
+    // threads <= 0 时使用 QThread::idealThreadCount()；maxTransfers < 0 表示不限换乘次数
+    BatchStats run(const QVector<OdPair>& pairs, const Sink& sink, int threads = 0, int maxTransfers = -1);
+
+    // 读取起终点列表：每行 "起点 终点"（空格、制表符或逗号分隔），空行和 # 开头的行忽略
+    static bool readOdFile(const QString& fileName, QVector<OdPair>& pairs, QString* error = nullptr);
+
+private:
+    const BusNetwork& net;
+};
+
+#endif // BATCHRUNNER_H
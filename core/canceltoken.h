@@ -0,0 +1,17 @@
+#ifndef CANCELTOKEN_H
+#define CANCELTOKEN_H
+
+#include <QAtomicInt>
+
+// 查询取消标记：发起方在任意线程调用 cancel()，查询循环定期检查 isCancelled() 并提前返回
+class CancelToken
+{
+public:
+    void cancel() { flag.storeRelaxed(1); }
+    bool isCancelled() const { return flag.loadRelaxed() != 0; }
+
+private:
+    QAtomicInt flag;
+};
+
+#endif // CANCELTOKEN_H
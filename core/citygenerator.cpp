@@ -0,0 +1,152 @@
+#include "citygenerator.h"
+
+#include <QRandomGenerator>
+#include <QSet>
+#include <QtMath>
+
+namespace {
+
+// 街名：前 24 条用原名，之后加序号（长江2路、长江3路……），保证任意大小的网格站名都不重复
+const char* const streetNames[] = {
+    "长江", "黄河", "珠江", "淮河", "汉水", "湘江", "松花", "嘉陵",
+    "岷江", "赣江", "闽江", "漓江", "泰山", "华山", "衡山", "嵩山",
+    "庐山", "黄山", "峨眉", "武夷", "天山", "昆仑", "秦岭", "太行",
+};
+constexpr int streetNameCount = int(sizeof(streetNames) / sizeof(streetNames[0]));
+
+QString streetName(int i)
+{
+    const QString base = QString::fromUtf8(streetNames[i % streetNameCount]);
+    return i < streetNameCount ? base : base + QString::number(i / streetNameCount + 1);
+}
+
+class CityGrid
+{
+public:
+    CityGrid(const CityParams& p, QRandomGenerator& rng) : side(1)
+    {
+        // 总经停数乘以 (1 - overlap) 约为不同站点数，取能放下这么多站的最小方格
+        const double overlap = qBound(0.0, p.overlap, 0.99);
+        const double visits = double(p.routes) * (p.minStops + p.maxStops) / 2.0;
+        side = qMax(2, int(qCeil(qSqrt(qMax(4.0, visits * (1.0 - overlap))))));
+
+        const int cells = side * side;
+        const int hubCount = qBound(1, qRound(cells * p.hubRatio), cells);
+        while (hubs.size() < hubCount) {
+            const int c = rng.bounded(cells);
+            if (!hubSet.contains(c)) {
+                hubSet.insert(c);
+                hubs.append(c);
+            }
+        }
+    }
+
+    int size() const { return side; }
+    int cellCount() const { return side * side; }
+    int x(int cell) const { return cell % side; }
+    int y(int cell) const { return cell / side; }
+    int at(int x, int y) const { return y * side + x; }
+    const QVector<int>& hubCells() const { return hubs; }
+
+    QString stopName(int cell) const
+    {
+        QString name = streetName(x(cell)) + QStringLiteral("路") + streetName(y(cell)) + QStringLiteral("街");
+        if (hubSet.contains(cell)) name += QStringLiteral("枢纽");
+        return name;
+    }
+
+private:
+    int side;
+    QVector<int> hubs;
+    QSet<int> hubSet;
+};
+
+int distance(const CityGrid& grid, int a, int b)
+{
+    return qAbs(grid.x(a) - grid.x(b)) + qAbs(grid.y(a) - grid.y(b));
+}
+
+// 依次经过的路点：随机起点、几个枢纽（每次走向最近的一个，避免来回折返）、随机终点
+QVector<int> pickWaypoints(const CityGrid& grid, const CityParams& p, QRandomGenerator& rng)
+{
+    QVector<int> waypoints{ rng.bounded(grid.cellCount()) };
+    QVector<int> candidates;
+    const QVector<int>& hubs = grid.hubCells();
+    const int wanted = qMin(qMax(0, p.hubsPerRoute), int(hubs.size()));
+    while (candidates.size() < wanted) {
+        const int h = hubs[rng.bounded(int(hubs.size()))];
+        if (!candidates.contains(h)) candidates.append(h);
+    }
+    while (!candidates.isEmpty()) {
+        int best = 0;
+        for (int i = 1; i < candidates.size(); ++i)
+            if (distance(grid, waypoints.last(), candidates[i]) < distance(grid, waypoints.last(), candidates[best]))
+                best = i;
+        waypoints.append(candidates.takeAt(best));
+    }
+    waypoints.append(rng.bounded(grid.cellCount()));
+    return waypoints;
+}
+
+Route makeRoute(int index, const CityGrid& grid, const CityParams& p, QRandomGenerator& rng)
+{
+    const int target = qMin(p.minStops + rng.bounded(p.maxStops - p.minStops + 1), grid.cellCount());
+    QVector<int> waypoints = pickWaypoints(grid, p, rng);
+
+    // 沿街道走向下一个路点，多数时候沿同一方向直行；已经经过的交叉口不重复设站，
+    // 这一段的行驶时间累加到下一个站上
+    int cur = waypoints.first();
+    QVector<int> cells{ cur };
+    QList<int> times;
+    QSet<int> seen{ cur };
+    bool alongX = rng.bounded(2) == 0;
+    int minutes = 0;
+    int next = 1;
+    while (cells.size() < target) {
+        if (next >= waypoints.size() || cur == waypoints[next]) {
+            if (next < waypoints.size()) ++next;
+            if (next >= waypoints.size()) waypoints.append(rng.bounded(grid.cellCount()));
+            continue;
+        }
+        const int dx = grid.x(waypoints[next]) - grid.x(cur);
+        const int dy = grid.y(waypoints[next]) - grid.y(cur);
+        if (dx == 0) alongX = false;
+        else if (dy == 0) alongX = true;
+        else if (rng.bounded(10) < 3) alongX = !alongX;
+        cur = alongX ? grid.at(grid.x(cur) + (dx > 0 ? 1 : -1), grid.y(cur))
+                     : grid.at(grid.x(cur), grid.y(cur) + (dy > 0 ? 1 : -1));
+        minutes += p.minSegment + rng.bounded(p.maxSegment - p.minSegment + 1);
+        if (seen.contains(cur)) continue;
+        seen.insert(cur);
+        cells.append(cur);
+        times.append(minutes);
+        minutes = 0;
+    }
+
+    Route r(QString("G%1").arg(index + 1), QString("G%1路").arg(index + 1));
+    r.stops.reserve(cells.size());
+    for (int c : std::as_const(cells)) r.stops.append(grid.stopName(c));
+    r.travelTimes = times;
+    // 首班 05:30~07:00，末班 21:00~23:30，都取整十分钟
+    r.firstBus = QTime(5, 30).addSecs(60 * 10 * rng.bounded(10));
+    r.lastBus = QTime(21, 0).addSecs(60 * 10 * rng.bounded(16));
+    return r;
+}
+
+} // namespace
+
+QVector<Route> generateCity(const CityParams& params)
+{
+    CityParams p = params;
+    p.minStops = qMax(2, p.minStops);
+    p.maxStops = qMax(p.minStops, p.maxStops);
+    p.minSegment = qMax(1, p.minSegment);
+    p.maxSegment = qMax(p.minSegment, p.maxSegment);
+
+    QRandomGenerator rng(p.seed);
+    const CityGrid grid(p, rng);
+    QVector<Route> routes;
+    routes.reserve(qMax(0, p.routes));
+    for (int i = 0; i < p.routes; ++i) routes.append(makeRoute(i, grid, p, rng));
+    return routes;
+}
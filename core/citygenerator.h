@@ -0,0 +1,28 @@
+#ifndef CITYGENERATOR_H
+#define CITYGENERATOR_H
+
+#include "route.h"
+#include <QVector>
+#include <QString>
+
+// 合成线网的参数。同一组参数（含种子）总是生成完全相同的线路
+struct CityParams {
+    quint32 seed = 1;
+    int routes = 200;
+    int minStops = 12;          // 每条线路的站数范围
+    int maxStops = 30;
+    double hubRatio = 0.02;     // 枢纽站占全部站点的比例
+    int hubsPerRoute = 2;       // 每条线路途经的枢纽数（上限，站数不够时少经过几个）
+    double overlap = 0.5;       // 换乘重叠度 0~1：线路经停中落在其他线路已有站点上的大致比例
+    int minSegment = 2;         // 相邻两站的行驶分钟数范围
+    int maxSegment = 5;
+};
+
+// 生成一张网格状城市的公交线网：站点位于 N×N 网格的交叉口，站名由纵横两条街名组成；
+// 其中一部分交叉口是枢纽（站名带“枢纽”），线路从随机起点出发，沿街道折线依次经过几个枢纽，
+// 再走向随机终点，凑够站数为止。
+// 网格大小由总经停数和 overlap 决定：overlap 越大网格越小，线路之间共用的站点越多，
+// 换乘组合越多；枢纽聚集了大量线路，是查询中换乘枚举最重的地方
+QVector<Route> generateCity(const CityParams& params);
+
+#endif // CITYGENERATOR_H
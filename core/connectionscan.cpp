@@ -0,0 +1,162 @@
+#include "connectionscan.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace {
+constexpr int INF = INT_MAX / 2;
+constexpr int DAY_MINUTES = 24 * 60;
+constexpr quint64 CANCEL_CHECK_MASK = 1023;   // 每出队 1024 个站点检查一次取消标记
+
+int minutesOf(const QTime& t)
+{
+    return t.hour() * 60 + t.minute();
+}
+}
+
+ConnectionScan::Schedule ConnectionScan::scheduleOf(const RouteView& rv)
+{
+    Schedule s;
+    if (!rv.hasTravelTimes() || rv.stopCount() < 2) return s;
+    s.first = minutesOf(rv.firstBus());
+    s.last = minutesOf(rv.lastBus());
+    s.overnight = s.last < s.first;
+    if (s.overnight) s.last += DAY_MINUTES;
+    s.duration = rv.minutesAt(rv.stopCount() - 1);
+    return s;
+}
+
+// 在距始发站 offset 分钟的那一站，出发时刻不早于 ready 的最早一班；返回它的始发时刻，没有则为 INF
+int ConnectionScan::nextTrip(const Schedule& s, int offset, int ready) const
+{
+    // 始发时刻在 [from, to] 之间按发车间隔排开的车次中，不早于 earliest 的第一班
+    auto firstFrom = [this](int from, int to, int earliest) {
+        const int k = earliest <= from ? 0 : (earliest - from + tripHeadway - 1) / tripHeadway;
+        const int start = from + k * tripHeadway;
+        return start <= to ? start : INF;
+    };
+    int start = firstFrom(s.first, s.last, ready - offset);
+    // 夜班线前一天发出、零点后仍在运行的车次，供凌晨出发的查询使用
+    if (s.overnight)
+        start = qMin(start, firstFrom(s.first - DAY_MINUTES, s.last - DAY_MINUTES,
+                                      qMax(ready - offset, 1 - s.duration)));
+    return start;
+}
+
+void ConnectionScan::build(const BusNetwork& network, int headway)
+{
+    tripHeadway = qMax(1, headway);
+    stopCount = network.stopCount();
+    schedules.resize(network.routeCount());
+    for (int r = 0; r < network.routeCount(); ++r) schedules[r] = scheduleOf(network.route(r));
+
+    arrival.fill(INF, stopCount);
+    via.resize(stopCount);
+    rides.fill(Ride(), 2 * network.routeCount());
+    touchedStops.clear();
+    touchedRides.clear();
+}
+
+void ConnectionScan::updateRoute(const BusNetwork& network, int route)
+{
+    if (schedules.size() < network.routeCount()) {
+        schedules.resize(network.routeCount());
+        rides.resize(2 * network.routeCount());
+    }
+    schedules[route] = scheduleOf(network.route(route));
+
+    // 新站点的查询数组补齐；已有部分都处于重置状态
+    stopCount = network.stopCount();
+    arrival.resize(stopCount, INF);
+    via.resize(stopCount);
+}
+
+void ConnectionScan::reset()
+{
+    for (StopId s : std::as_const(touchedStops)) arrival[s] = INF;
+    for (int r : std::as_const(touchedRides)) rides[r] = Ride();
+    touchedStops.clear();
+    touchedRides.clear();
+}
+
+Journey ConnectionScan::earliestArrival(const BusNetwork& network, StopId from, StopId to, int departMinutes,
+                                        const CancelToken* cancel, SearchTrace* trace)
+{
+    SearchTrace::Scope phase(trace, SearchTrace::Scan);
+    Journey j;
+    if (from == to || from >= StopId(stopCount) || to >= StopId(stopCount)) return j;
+
+    using Item = std::pair<int, StopId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    arrival[from] = departMinutes;
+    touchedStops.append(from);
+    queue.push({departMinutes, from});
+
+    quint64 settled = 0;
+    while (!queue.empty()) {
+        const auto [t, s] = queue.top();
+        queue.pop();
+        if (t > arrival[s]) continue;
+        if (s == to) break;     // 按到达时刻出队，终点出队即为最早
+        if (cancel && (settled & CANCEL_CHECK_MASK) == 0 && cancel->isCancelled()) {
+            reset();
+            phase.count(settled);
+            return j;
+        }
+        ++settled;
+
+        const int ready = t + (s == from ? 0 : TRANSFER_MINUTES);
+        for (const StopVisit& v : network.visitsAt(s)) {
+            const Schedule& schedule = schedules[v.route];
+            if (schedule.last < schedule.first) continue;
+            const RouteView rv = network.route(v.route);
+            const int n = rv.stopCount();
+            // 环线可能多次经过同一站，[pos, lastPos] 之间逐个确认
+            for (int b = int(v.pos); b <= int(v.lastPos); ++b) {
+                if (rv.stopAt(b) != s) continue;
+                for (int dir : { 1, -1 }) {
+                    const int base = rv.minutesAt(dir > 0 ? 0 : n - 1);
+                    const int start = nextTrip(schedule, qAbs(rv.minutesAt(b) - base), ready);
+                    if (start >= INF) continue;
+                    // 同一方向在上游已经赶上过同一班或更早的车，下游各站都按它放松过了
+                    const int key = int(v.route) * 2 + (dir > 0 ? 0 : 1);
+                    Ride& ride = rides[key];
+                    if (ride.pos >= 0 && (b - ride.pos) * dir >= 0 && start >= ride.start) continue;
+                    if (ride.pos < 0) touchedRides.append(key);
+                    ride = Ride{b, start};
+
+                    for (int i = b + dir; i >= 0 && i < n; i += dir) {
+                        const StopId u = rv.stopAt(i);
+                        const int arr = start + qAbs(rv.minutesAt(i) - base);
+                        if (arr >= arrival[u]) continue;
+                        if (arrival[u] == INF) touchedStops.append(u);
+                        arrival[u] = arr;
+                        via[u] = Hop{int(v.route), dir, b, i, start};
+                        queue.push({arr, u});
+                    }
+                }
+            }
+        }
+    }
+
+    if (arrival[to] != INF) {
+        // 沿各站的来历回溯；上车站都比下车站先出队，最多经过 stopCount 段
+        StopId s = to;
+        while (s != from && j.legs.size() < stopCount) {
+            const Hop& h = via[s];
+            const RouteView rv = network.route(h.route);
+            const int base = rv.minutesAt(h.dir > 0 ? 0 : rv.stopCount() - 1);
+            j.legs.prepend(JourneyLeg{h.route, h.boardPos, h.alightPos,
+                                      h.start + qAbs(rv.minutesAt(h.boardPos) - base), arrival[s]});
+            s = rv.stopAt(h.boardPos);
+        }
+        // 段数用完还没回到起点说明记录不一致，半截行程不能当结果
+        if (s == from) j.totalMinutes = arrival[to] - departMinutes;
+        else j = Journey();
+    }
+    reset();
+    phase.count(settled);
+    return j;
+}
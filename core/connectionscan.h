@@ -0,0 +1,75 @@
+#ifndef CONNECTIONSCAN_H
+#define CONNECTIONSCAN_H
+
+#include "network.h"
+#include "journey.h"
+#include "canceltoken.h"
+#include "searchtrace.h"
+#include <QVector>
+
+// 按出发时刻查询。
+// 线路数据里只有首末班和区间耗时，车次按固定发车间隔排开。车次不逐个展开成 connection：
+// 每条线路只存一行（首班、末班、是否跨零点），各站相对始发站的偏移直接取线网的累计耗时，
+// 某站某时刻之后的下一班车由这一行直接算出。建表与单条线路修改都只是按线路重算这一行，
+// 与车次数无关；图形界面启动、整体重建和批量查询都不必先展开整天的时刻表。
+// 查询是按到站时刻的 Dijkstra：站点按最早到达时刻出队，对经过它的每条线路、每个方向
+// 算出换乘后赶得上的下一班，沿线放松后面各站。先出队的站赶上的车次已经沿线扫过的，
+// 后面在下游赶上同一班或更晚的车时不再重扫。
+// 时刻一律用“当日零点起的分钟数”；末班早于首班的夜班线跨过零点，时刻可超过 1440。
+class ConnectionScan
+{
+public:
+    static constexpr int DEFAULT_HEADWAY = 10;      // 数据中没有发车间隔，默认每 10 分钟一班
+    static constexpr int TRANSFER_MINUTES = 3;      // 与 RaptorPlanner 一致的换乘步行时间
+
+    // 由网络计算各线路的发车规律；网络重建后需要重新调用
+    void build(const BusNetwork& network, int headway = DEFAULT_HEADWAY);
+    // 网络中线路 route 增量修改（含新增、删除）后，只重算这一条线路
+    void updateRoute(const BusNetwork& network, int route);
+
+    // departMinutes 时刻从 from 出发、最早到达 to 的行程；当天已无车可达或被取消时返回空行程（legs 为空）。
+    // network 须是 build() / updateRoute() 所用的线网。trace 非空时把耗时和出队的站点数记到 SearchTrace::Scan
+    Journey earliestArrival(const BusNetwork& network, StopId from, StopId to, int departMinutes,
+                            const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+
+private:
+    // 一条线路的发车规律；两个方向同时从各自的始发站发车
+    struct Schedule {
+        int first = 0;          // 首班
+        int last = -1;          // 末班，跨零点的已加上一天；小于 first 表示不开行（如缺少区间耗时）
+        int duration = 0;       // 全程分钟数
+        bool overnight = false; // 前一天发出的车次零点后仍在运行
+    };
+
+    // 某线路某方向已经沿线扫过的车次：从 pos 起往后的各站都按始发时刻 start 的那一班放松过
+    struct Ride {
+        int pos = -1;
+        int start = 0;
+    };
+
+    // 线路某站到达后的来历，回溯行程用
+    struct Hop {
+        int route;
+        int dir;        // 1 正向，-1 反向
+        int boardPos;
+        int alightPos;
+        int start;      // 所乘车次的始发时刻
+    };
+
+    static Schedule scheduleOf(const RouteView& rv);
+    int nextTrip(const Schedule& s, int offset, int ready) const;
+    void reset();
+
+    int stopCount = 0;
+    int tripHeadway = DEFAULT_HEADWAY;  // build() 时的发车间隔，增量修改沿用
+    QVector<Schedule> schedules;        // 每条线路一行
+
+    // 查询用的临时数组，只重置本次查询写过的位置
+    QVector<int> arrival;               // 各站最早到达时刻
+    QVector<Hop> via;                   // 到达该站所乘的车次与上车位置
+    QVector<Ride> rides;                // 按 线路 * 2 + 方向 排列
+    QVector<StopId> touchedStops;
+    QVector<int> touchedRides;
+};
+
+#endif // CONNECTIONSCAN_H
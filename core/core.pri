@@ -0,0 +1,13 @@
+# 链接查询引擎静态库：在应用的 .pro 中 include(../core/core.pri)
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+win32:CONFIG(release, debug|release): CORE_LIB_DIR = $$OUT_PWD/../core/release
+else:win32:CONFIG(debug, debug|release): CORE_LIB_DIR = $$OUT_PWD/../core/debug
+else: CORE_LIB_DIR = $$OUT_PWD/../core
+
+LIBS += -L$$CORE_LIB_DIR -lbuscore
+
+win32-g++: PRE_TARGETDEPS += $$CORE_LIB_DIR/libbuscore.a
+else:win32: PRE_TARGETDEPS += $$CORE_LIB_DIR/buscore.lib
+else: PRE_TARGETDEPS += $$CORE_LIB_DIR/libbuscore.a
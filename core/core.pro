@@ -0,0 +1,58 @@
+# 查询引擎静态库：线路模型、数据读写与各查询算法，只依赖 QtCore
+QT = core
+
+TEMPLATE = lib
+CONFIG += staticlib c++17
+TARGET = buscore
+
+SOURCES += \
+    altplanner.cpp \
+    batchrunner.cpp \
+    citygenerator.cpp \
+    connectionscan.cpp \
+    landmarks.cpp \
+    metrics.cpp \
+    network.cpp \
+    networksnapshot.cpp \
+    pinyin.cpp \
+    planrenderer.cpp \
+    querycache.cpp \
+    raptor.cpp \
+    route.cpp \
+    routeengine.cpp \
+    routeimporter.cpp \
+    routeio.cpp \
+    routejournal.cpp \
+    searchtrace.cpp \
+    stopindex.cpp \
+    topkplanner.cpp \
+    transfergraph.cpp \
+    transferpatterns.cpp \
+    utils.cpp
+
+HEADERS += \
+    altplanner.h \
+    batchrunner.h \
+    canceltoken.h \
+    citygenerator.h \
+    connectionscan.h \
+    journey.h \
+    landmarks.h \
+    metrics.h \
+    network.h \
+    networksnapshot.h \
+    pinyin.h \
+    planrenderer.h \
+    querycache.h \
+    raptor.h \
+    route.h \
+    routeengine.h \
+    routeimporter.h \
+    routeio.h \
+    routejournal.h \
+    searchtrace.h \
+    stopindex.h \
+    topkplanner.h \
+    transfergraph.h \
+    transferpatterns.h \
+    utils.h
@@ -0,0 +1,22 @@
+#ifndef JOURNEY_H
+#define JOURNEY_H
+
+#include <QVector>
+
+// 行程中的一段乘车：在 route 的 fromPos 上车，toPos 下车（toPos < fromPos 表示反向乘坐）
+struct JourneyLeg {
+    int route;
+    int fromPos;
+    int toPos;
+    int depart = -1;    // 按时刻查询时的上车 / 下车时刻（当日零点起的分钟数，可超过 1440 表示次日）；
+    int arrive = -1;    // 不考虑时刻的查询为 -1
+};
+
+struct Journey {
+    QVector<JourneyLeg> legs;
+    int totalMinutes = 0;   // 行驶时间 + 每次换乘的步行时间；按时刻查询时为出发到到达的全部耗时（含候车）
+
+    int transfers() const { return int(legs.size()) - 1; }
+};
+
+#endif // JOURNEY_H
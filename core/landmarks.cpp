@@ -0,0 +1,271 @@
+#include "landmarks.h"
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'B', 'U', 'S', 'A', 'L', 'T', '\0', '\0' };
+constexpr quint32 BYTE_ORDER_MARK = 0x01020304;
+constexpr int HASH_BYTES = 32;
+
+struct Header {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 byteOrder;
+    char networkHash[HASH_BYTES];
+    quint32 stopCount;
+    quint32 landmarkCount;
+};
+
+static_assert(sizeof(Header) == 56, "landmark header layout");
+
+// 与 s 相邻的站点及区间耗时：同一线路上的前后两站，只算耗时数据有效的线路
+template<typename F>
+void forEachNeighbor(const BusNetwork& net, StopId s, F f)
+{
+    for (const StopVisit& v : net.visitsAt(s)) {
+        const RouteView rv = net.route(v.route);
+        if (!rv.hasTravelTimes()) continue;
+        // 环线可能多次经过同一站，[pos, lastPos] 之间逐个确认
+        for (int p = int(v.pos); p <= int(v.lastPos); ++p) {
+            if (rv.stopAt(p) != s) continue;
+            if (p > 0) f(rv.stopAt(p - 1), rv.travelTime(p, p - 1));
+            if (p + 1 < rv.stopCount()) f(rv.stopAt(p + 1), rv.travelTime(p, p + 1));
+        }
+    }
+}
+
+// 按跳数的广度优先，只用来选地标
+void hopsFrom(const BusNetwork& net, StopId source, QVector<int>& hops)
+{
+    hops.fill(LandmarkTable::UNREACHABLE, net.stopCount());
+    QVector<StopId> frontier{ source };
+    hops[source] = 0;
+    for (int head = 0; head < frontier.size(); ++head) {
+        const StopId s = frontier[head];
+        forEachNeighbor(net, s, [&](StopId t, int) {
+            if (hops[t] != LandmarkTable::UNREACHABLE) return;
+            hops[t] = hops[s] + 1;
+            frontier.append(t);
+        });
+    }
+}
+
+void minutesFrom(const BusNetwork& net, StopId source, QVector<qint32>& minutes)
+{
+    minutes.fill(LandmarkTable::UNREACHABLE, net.stopCount());
+    using Item = std::pair<int, StopId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    minutes[source] = 0;
+    queue.push({0, source});
+    while (!queue.empty()) {
+        const auto [d, s] = queue.top();
+        queue.pop();
+        if (d > minutes[s]) continue;
+        forEachNeighbor(net, s, [&](StopId t, int w) {
+            if (d + w < minutes[t]) {
+                minutes[t] = d + w;
+                queue.push({d + w, t});
+            }
+        });
+    }
+}
+
+// 第一个参照点取经停线路最多的站，大概率落在主连通分量里；
+// 只有零星几条线路的孤立分量选不到地标，其中的查询下界为 0，仍然正确
+StopId busiestStop(const BusNetwork& net)
+{
+    StopId best = INVALID_STOP;
+    qsizetype most = 0;
+    for (StopId s = 0; s < StopId(net.stopCount()); ++s) {
+        const qsizetype n = net.visitsAt(s).size();
+        if (n > most) {
+            most = n;
+            best = s;
+        }
+    }
+    return best;
+}
+
+// 可达范围内离 nearest 最远的站（同远取编号小的，保证结果确定）；都已是地标时返回 INVALID_STOP
+StopId farthest(const QVector<int>& nearest)
+{
+    StopId best = INVALID_STOP;
+    int far = 0;
+    for (StopId s = 0; s < StopId(nearest.size()); ++s) {
+        if (nearest[s] != LandmarkTable::UNREACHABLE && nearest[s] > far) {
+            far = nearest[s];
+            best = s;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+QByteArray LandmarkTable::fingerprint(const BusNetwork& network)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    auto add = [&hash](quint32 v) { hash.addData(reinterpret_cast<const char*>(&v), sizeof v); };
+    add(quint32(network.stopCount()));
+    for (const QString& name : network.stops()) {
+        add(quint32(name.size()));
+        hash.addData(reinterpret_cast<const char*>(name.constData()), name.size() * qsizetype(sizeof(QChar)));
+    }
+    add(quint32(network.routeCount()));
+    for (int r = 0; r < network.routeCount(); ++r) {
+        const RouteView rv = network.route(r);
+        add(network.isVacant(r) ? 0 : quint32(rv.stopCount()));
+        if (network.isVacant(r)) continue;
+        add(rv.hasTravelTimes() ? 1 : 0);
+        for (int p = 0; p < rv.stopCount(); ++p) {
+            add(rv.stopAt(p));
+            add(quint32(rv.minutesAt(p)));
+        }
+    }
+    return hash.result();
+}
+
+void LandmarkTable::build(const BusNetwork& network, int count, int threads)
+{
+    clear();
+    stops = network.stopCount();
+    hash = fingerprint(network);
+    const StopId start = busiestStop(network);
+    if (start == INVALID_STOP || count <= 0) return;
+
+    // 选地标：第一个取离参照点最远的站，之后每次取离已选地标最近距离最大的站。
+    // 用跳数而不是分钟数，一次广度优先远比 Dijkstra 便宜，选出的位置相差无几
+    QVector<int> nearest;
+    QVector<int> hops;
+    hopsFrom(network, start, nearest);
+    StopId next = farthest(nearest);
+    if (next == INVALID_STOP) next = start;     // 只有一个站可达
+    nearest.fill(UNREACHABLE);
+    while (next != INVALID_STOP && marks.size() < count) {
+        marks.append(next);
+        hopsFrom(network, next, hops);
+        for (int s = 0; s < hops.size(); ++s) nearest[s] = qMin(nearest[s], hops[s]);
+        next = farthest(nearest);
+    }
+
+    // 各地标的 Dijkstra 互不相关，分给多个线程；每个线程按下标领取下一个地标
+    const int k = int(marks.size());
+    QVector<QVector<qint32>> columns(k);
+    QAtomicInt taken;
+    auto work = [&] {
+        for (int i = taken.fetchAndAddRelaxed(1); i < k; i = taken.fetchAndAddRelaxed(1))
+            minutesFrom(network, marks[i], columns[i]);
+    };
+    const int workers = qMin(k, threads > 0 ? threads : qMax(1, QThread::idealThreadCount()));
+    QVector<QThread*> pool;
+    for (int w = 1; w < workers; ++w) {
+        pool.append(QThread::create(work));
+        pool.last()->start();
+    }
+    work();     // 调用线程自己也做一份
+    for (QThread* t : std::as_const(pool)) {
+        t->wait();
+        delete t;
+    }
+
+    // 转成按站点排列
+    dist.resize(qsizetype(stops) * k);
+    for (int i = 0; i < k; ++i)
+        for (int s = 0; s < stops; ++s) dist[qsizetype(s) * k + i] = columns[i][s];
+}
+
+void LandmarkTable::clear()
+{
+    marks.clear();
+    dist.clear();
+    stops = 0;
+    hash.clear();
+}
+
+int LandmarkTable::lowerBound(StopId s, StopId t) const
+{
+    const int k = int(marks.size());
+    if (k == 0 || s >= StopId(stops) || t >= StopId(stops)) return 0;
+    const qint32* a = dist.constData() + qsizetype(s) * k;
+    const qint32* b = dist.constData() + qsizetype(t) * k;
+    int bound = 0;
+    for (int i = 0; i < k; ++i) {
+        if (a[i] == UNREACHABLE || b[i] == UNREACHABLE) {
+            // 图是无向的：一站与地标连通而另一站不连通，两站必不连通
+            if (a[i] != b[i]) return UNREACHABLE;
+            continue;
+        }
+        bound = qMax(bound, qAbs(a[i] - b[i]));
+    }
+    return bound;
+}
+
+bool LandmarkTable::save(const QString& fileName) const
+{
+    Header h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.formatVersion = FORMAT_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    std::memcpy(h.networkHash, hash.constData(), size_t(qMin(int(hash.size()), HASH_BYTES)));
+    h.stopCount = quint32(stops);
+    h.landmarkCount = quint32(marks.size());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(reinterpret_cast<const char*>(&h), sizeof h);
+    file.write(reinterpret_cast<const char*>(marks.constData()), marks.size() * qsizetype(sizeof(StopId)));
+    file.write(reinterpret_cast<const char*>(dist.constData()), dist.size() * qsizetype(sizeof(qint32)));
+    return file.commit();
+}
+
+bool LandmarkTable::load(const QString& fileName, const BusNetwork& network, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail(file.errorString());
+    const qint64 size = file.size();
+    const uchar* data = size >= qint64(sizeof(Header)) ? file.map(0, size) : nullptr;
+    if (!data) return fail("无法映射地标文件");
+
+    Header h;
+    std::memcpy(&h, data, sizeof h);
+    if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0) return fail("不是地标文件");
+    if (h.formatVersion != FORMAT_VERSION || h.byteOrder != BYTE_ORDER_MARK) return fail("地标文件格式版本不符");
+
+    const QByteArray current = fingerprint(network);
+    if (h.stopCount != quint32(network.stopCount())
+        || std::memcmp(h.networkHash, current.constData(), size_t(qMin(int(current.size()), HASH_BYTES))) != 0)
+        return fail("地标文件已过期");
+
+    const qint64 expected = qint64(sizeof(Header)) + qint64(h.landmarkCount) * qint64(sizeof(StopId))
+                            + qint64(h.stopCount) * h.landmarkCount * qint64(sizeof(qint32));
+    if (size != expected) return fail("地标文件已损坏");
+
+    QVector<StopId> loadedMarks(h.landmarkCount);
+    QVector<qint32> loadedDist(qsizetype(h.stopCount) * h.landmarkCount);
+    const uchar* p = data + sizeof(Header);
+    if (!loadedMarks.isEmpty()) std::memcpy(loadedMarks.data(), p, size_t(loadedMarks.size()) * sizeof(StopId));
+    p += loadedMarks.size() * qsizetype(sizeof(StopId));
+    if (!loadedDist.isEmpty()) std::memcpy(loadedDist.data(), p, size_t(loadedDist.size()) * sizeof(qint32));
+    for (StopId s : std::as_const(loadedMarks))
+        if (s >= h.stopCount) return fail("地标文件已损坏");
+
+    marks = loadedMarks;
+    dist = loadedDist;
+    stops = int(h.stopCount);
+    hash = current;
+    return true;
+}
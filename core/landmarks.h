@@ -0,0 +1,54 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "network.h"
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+// ALT 预处理：选出若干地标站，预先算出每个站到各地标的最短行驶时间。
+// 图与 TopKPlanner 的下界相同——同一线路上相邻两站相连，边长为区间耗时；线路可双向乘坐，
+// 所以图是无向的，“到地标”与“从地标出发”的距离相同，只存一份。
+// 由三角不等式 d(s, t) >= |d(L, t) - d(L, s)|，对各地标取最大值即得 s 到 t 的时间下界，
+// 每次查询不必再从终点做一遍 Dijkstra。
+// 地标按跳数最远优先选出（每次选离已选地标最远的站），各地标的 Dijkstra 在多个线程上并行。
+// 结果与数据文件并排存放（bus_routes.json -> bus_routes.json.alt），文件头记录线网指纹，
+// 线网变化后即视为过期；与 NetworkSnapshot 一样只读写，不做增量维护
+class LandmarkTable
+{
+public:
+    static constexpr quint32 FORMAT_VERSION = 1;
+    static constexpr int DEFAULT_COUNT = 16;
+    static constexpr int UNREACHABLE = 0x3FFFFFFF;
+
+    static QString pathFor(const QString& dataFile) { return dataFile + ".alt"; }
+    // 线网结构的指纹：站名表与各线路的站点、累计耗时；与线路编号、首末班等展示信息无关
+    static QByteArray fingerprint(const BusNetwork& network);
+
+    // 重新选地标并计算距离表；threads <= 0 时使用 QThread::idealThreadCount()
+    void build(const BusNetwork& network, int count = DEFAULT_COUNT, int threads = 0);
+    void clear();
+
+    // 先写临时文件再替换
+    bool save(const QString& fileName) const;
+    // 文件存在、格式有效且与 network 的指纹一致时读入并返回 true；否则本表不变
+    bool load(const QString& fileName, const BusNetwork& network, QString* error = nullptr);
+
+    bool isEmpty() const { return marks.isEmpty(); }
+    int landmarkCount() const { return int(marks.size()); }
+    StopId landmark(int i) const { return marks[i]; }
+    int stopCount() const { return stops; }
+    // 站点 stop 到第 i 个地标的分钟数，不连通为 UNREACHABLE
+    int distance(StopId stop, int i) const { return dist[qsizetype(stop) * marks.size() + i]; }
+
+    // s 到 t 的时间下界；能判定两站不连通时返回 UNREACHABLE，表为空或站点超出范围时返回 0
+    int lowerBound(StopId s, StopId t) const;
+
+private:
+    QVector<StopId> marks;
+    QVector<qint32> dist;           // 按站点排列：dist[s * 地标数 + i]，一次下界只读两段连续内存
+    int stops = 0;
+    QByteArray hash;                // 生成时的线网指纹
+};
+
+#endif // LANDMARKS_H
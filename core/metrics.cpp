@@ -0,0 +1,143 @@
+#include "metrics.h"
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+
+namespace {
+
+QByteArray escapeHelp(const QString& help)
+{
+    QString s = help;
+    s.replace('\\', QLatin1String("\\\\"));
+    s.replace('\n', QLatin1String("\\n"));
+    return s.toUtf8();
+}
+
+QByteArray withLabels(const QString& name, const QString& labels, const QString& extra = QString())
+{
+    QString s = name;
+    if (!labels.isEmpty() || !extra.isEmpty()) {
+        s += '{' + labels;
+        if (!labels.isEmpty() && !extra.isEmpty()) s += ',';
+        s += extra + '}';
+    }
+    return s.toUtf8();
+}
+
+const char* typeName(int type)
+{
+    static const char* const names[] = { "counter", "gauge", "histogram" };
+    return names[type];
+}
+
+} // namespace
+
+QVector<double> MetricHistogram::latencyBounds()
+{
+    return { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+}
+
+MetricHistogram::MetricHistogram(const QVector<double>& upperBounds)
+{
+    bounds.reserve(upperBounds.size());
+    for (double b : upperBounds) bounds.append(qRound64(b * 1e9));
+    buckets.reset(new QAtomicInteger<quint64>[bounds.size() + 1]);
+}
+
+void MetricHistogram::observe(qint64 nanos)
+{
+    // 桶只有十几个，顺序找比二分更快
+    int i = 0;
+    while (i < bounds.size() && nanos > bounds[i]) ++i;
+    buckets[i].fetchAndAddRelaxed(1);
+    total.fetchAndAddRelaxed(1);
+    sumNanos.fetchAndAddRelaxed(quint64(qMax<qint64>(0, nanos)));
+}
+
+void MetricsRegistry::add(const QString& name, const QString& help, const QString& labels, Type type, int index)
+{
+    entries.append(Entry{ name, help, labels, type, index });
+}
+
+MetricCounter* MetricsRegistry::counter(const QString& name, const QString& help, const QString& labels)
+{
+    QMutexLocker locker(&lock);
+    for (const Entry& e : std::as_const(entries))
+        if (e.type == Type::Counter && e.name == name && e.labels == labels) return counters[e.index].get();
+    counters.push_back(std::make_unique<MetricCounter>());
+    add(name, help, labels, Type::Counter, int(counters.size()) - 1);
+    return counters.back().get();
+}
+
+MetricGauge* MetricsRegistry::gauge(const QString& name, const QString& help, const QString& labels)
+{
+    QMutexLocker locker(&lock);
+    for (const Entry& e : std::as_const(entries))
+        if (e.type == Type::Gauge && e.name == name && e.labels == labels) return gauges[e.index].get();
+    gauges.push_back(std::make_unique<MetricGauge>());
+    add(name, help, labels, Type::Gauge, int(gauges.size()) - 1);
+    return gauges.back().get();
+}
+
+MetricHistogram* MetricsRegistry::histogram(const QString& name, const QString& help, const QString& labels,
+                                            const QVector<double>& upperBounds)
+{
+    QMutexLocker locker(&lock);
+    for (const Entry& e : std::as_const(entries))
+        if (e.type == Type::Histogram && e.name == name && e.labels == labels) return histograms[e.index].get();
+    histograms.push_back(std::make_unique<MetricHistogram>(upperBounds));
+    add(name, help, labels, Type::Histogram, int(histograms.size()) - 1);
+    return histograms.back().get();
+}
+
+QByteArray MetricsRegistry::toPrometheus() const
+{
+    QMutexLocker locker(&lock);
+    QByteArray out;
+    QSet<QString> written;
+    // 按首次注册的顺序，同名指标的各组标签排在一起
+    for (const Entry& first : std::as_const(entries)) {
+        if (written.contains(first.name)) continue;
+        written.insert(first.name);
+        const QByteArray name = first.name.toUtf8();
+        out += "# HELP " + name + ' ' + escapeHelp(first.help) + '\n';
+        out += "# TYPE " + name + ' ' + typeName(int(first.type)) + '\n';
+
+        for (const Entry& e : std::as_const(entries)) {
+            if (e.name != first.name) continue;
+            switch (e.type) {
+            case Type::Counter:
+                out += withLabels(e.name, e.labels) + ' ' + QByteArray::number(counters[e.index]->load()) + '\n';
+                break;
+            case Type::Gauge:
+                out += withLabels(e.name, e.labels) + ' ' + QByteArray::number(gauges[e.index]->load()) + '\n';
+                break;
+            case Type::Histogram: {
+                const MetricHistogram& h = *histograms[e.index];
+                quint64 cumulative = 0;
+                for (int i = 0; i < h.bucketCount(); ++i) {
+                    cumulative += h.bucket(i);
+                    const QString le = i + 1 < h.bucketCount() ? QString::number(h.upperBound(i), 'g', 6)
+                                                               : QStringLiteral("+Inf");
+                    out += withLabels(e.name + "_bucket", e.labels, "le=\"" + le + '"') + ' '
+                           + QByteArray::number(cumulative) + '\n';
+                }
+                out += withLabels(e.name + "_sum", e.labels) + ' ' + QByteArray::number(h.sumSeconds(), 'g', 12) + '\n';
+                // 用各桶之和而不是 count()，保证与 +Inf 桶一致（记录与导出可能同时进行）
+                out += withLabels(e.name + "_count", e.labels) + ' ' + QByteArray::number(cumulative) + '\n';
+                break;
+            }
+            }
+        }
+    }
+    return out;
+}
+
+bool MetricsRegistry::writeTo(const QString& fileName) const
+{
+    const QByteArray text = toPrometheus();
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(text);
+    return file.commit();
+}
@@ -0,0 +1,99 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+// 进程内的运行指标，按 Prometheus 文本格式导出。
+// 指标在启动时向 MetricsRegistry 注册一次，之后调用方只持有返回的指针；
+// 记录只做一次 relaxed 原子加，不加锁，可以在任意线程（包括后台查询线程）调用。
+// 注册和导出才加锁；导出读到的各个值之间不保证同一时刻，对监控足够了
+
+// 只增不减的计数
+class MetricCounter
+{
+public:
+    void add(quint64 n = 1) { value.fetchAndAddRelaxed(n); }
+    quint64 load() const { return value.loadRelaxed(); }
+
+private:
+    QAtomicInteger<quint64> value;
+};
+
+// 当前值，如线路数、缓存条目数
+class MetricGauge
+{
+public:
+    void set(qint64 v) { value.storeRelaxed(v); }
+    void add(qint64 n) { value.fetchAndAddRelaxed(n); }
+    qint64 load() const { return value.loadRelaxed(); }
+
+private:
+    QAtomicInteger<qint64> value;
+};
+
+// 耗时分布：桶的上界固定（秒），记录时找到第一个不小于该耗时的桶原子加一
+class MetricHistogram
+{
+public:
+    // 默认的桶：0.5 ms ~ 10 s，覆盖一次查询到一次大文件导入
+    static QVector<double> latencyBounds();
+
+    explicit MetricHistogram(const QVector<double>& upperBounds = latencyBounds());
+
+    void observe(qint64 nanos);
+
+    int bucketCount() const { return int(bounds.size()) + 1; }     // 最后一个是 +Inf
+    double upperBound(int i) const { return bounds[i] / 1e9; }
+    quint64 bucket(int i) const { return buckets[i].loadRelaxed(); }   // 落在该桶的次数（不累计）
+    quint64 count() const { return total.loadRelaxed(); }
+    double sumSeconds() const { return sumNanos.loadRelaxed() / 1e9; }
+
+private:
+    QVector<qint64> bounds;     // 纳秒，升序
+    std::unique_ptr<QAtomicInteger<quint64>[]> buckets;
+    QAtomicInteger<quint64> total;
+    QAtomicInteger<quint64> sumNanos;
+};
+
+class MetricsRegistry
+{
+public:
+    // name 为 Prometheus 指标名；labels 是已经写好的标签，如 kind="topk"，没有标签时为空。
+    // 同名的多组标签共用一条 HELP/TYPE，导出时排在一起。返回的指针在注册表析构前一直有效
+    MetricCounter* counter(const QString& name, const QString& help, const QString& labels = QString());
+    MetricGauge* gauge(const QString& name, const QString& help, const QString& labels = QString());
+    MetricHistogram* histogram(const QString& name, const QString& help, const QString& labels = QString(),
+                               const QVector<double>& upperBounds = MetricHistogram::latencyBounds());
+
+    // Prometheus 文本格式（0.0.4）
+    QByteArray toPrometheus() const;
+    // 整体替换写入（先写临时文件再改名），适合 node_exporter 的 textfile collector 读取
+    bool writeTo(const QString& fileName) const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Entry {
+        QString name;
+        QString help;
+        QString labels;
+        Type type;
+        int index;      // 在对应类型的数组中的下标
+    };
+
+    void add(const QString& name, const QString& help, const QString& labels, Type type, int index);
+
+    mutable QMutex lock;
+    QVector<Entry> entries;
+    std::vector<std::unique_ptr<MetricCounter>> counters;
+    std::vector<std::unique_ptr<MetricGauge>> gauges;
+    std::vector<std::unique_ptr<MetricHistogram>> histograms;
+};
+
+#endif // METRICS_H
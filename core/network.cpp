@@ -0,0 +1,413 @@
+#include "network.h"
+#include <QAtomicInteger>
+#include <algorithm>
+
+// 全局递增，保证不同网络对象各次构建的版本号互不相同
+static QAtomicInteger<quint64> versionCounter;
+
+void BusNetwork::clear()
+{
+    buildVersion = versionCounter.fetchAndAddRelaxed(1) + 1;
+    routeInfo.clear();
+    vacant.clear();
+    routeIds.clear();
+    stopNames.clear();
+    stopIds.clear();
+    nameOrder.clear();
+    routeOrder.clear();
+    routeSpans.clear();
+    routeStops.clear();
+    cumMinutes.clear();
+    timesValid.clear();
+    visitSpans.clear();
+    visits.clear();
+    transferGraph.clear();
+    image.clear();
+    liveStops = 0;
+    liveVisits = 0;
+    vacantCount = 0;
+    edited = false;
+}
+
+StopId BusNetwork::intern(const QString& name)
+{
+    auto it = stopIds.constFind(name);
+    if (it != stopIds.constEnd()) return it.value();
+    const StopId id = StopId(stopNames.size());
+    stopNames.append(name);
+    stopIds.insert(name, id);
+    visitSpans.append({ 0, 0, 0 });
+    return id;
+}
+
+void BusNetwork::build(QVector<Route>& routes)
+{
+    clear();
+
+    qsizetype total = 0;
+    for (const auto& r : std::as_const(routes)) total += r.stops.size();
+    routeInfo.reserve(routes.size());
+    routeSpans.reserve(routes.size());
+    routeStops.reserve(total);
+    cumMinutes.reserve(total);
+    timesValid.reserve(routes.size());
+
+    for (qsizetype ri = 0; ri < routes.size(); ++ri) {
+        const Route& r = std::as_const(routes)[ri];
+        const bool valid = r.travelTimes.size() == r.stops.size() - 1;
+        const quint32 begin = quint32(routeStops.size());
+        quint32 elapsed = 0;
+        for (qsizetype i = 0; i < r.stops.size(); ++i) {
+            const StopId id = intern(r.stops[i]);
+            routeStops.append(id);
+            cumMinutes.append(elapsed);
+            if (valid && i < r.travelTimes.size()) elapsed += quint32(qMax(0, r.travelTimes[i]));
+
+            // 相同站名只保留一份字符串数据，其余引用隐式共享
+            const QString& shared = stopNames[id];
+            if (r.stops[i].constData() != shared.constData())
+                routes[ri].stops[i] = shared;
+        }
+        timesValid.append(valid);
+        const quint32 size = quint32(routeStops.size()) - begin;
+        routeSpans.append({ begin, size, size });
+        routeInfo.append(infoOf(r));
+    }
+    liveStops = quint32(routeStops.size());
+    vacant.fill(false, routes.size());
+    buildRouteIndex();
+    buildStopIndex();
+    transferGraph.build(*this);
+}
+
+BusNetwork::RouteInfo BusNetwork::infoOf(const Route& route)
+{
+    RouteInfo info{ route.id, route.name, route.firstBus, route.lastBus, {} };
+    bool regular = route.travelTimes.size() == route.stops.size() - 1;
+    for (int t : route.travelTimes) regular = regular && t >= 0;
+    if (!regular) info.rawTimes = route.travelTimes;
+    return info;
+}
+
+Route RouteView::toRoute() const
+{
+    if (net->vacant[idx]) return Route();
+    const BusNetwork::RouteInfo& info = net->routeInfo[idx];
+    Route r(info.id, info.name);
+    r.firstBus = info.firstBus;
+    r.lastBus = info.lastBus;
+    const int n = stopCount();
+    r.stops.reserve(n);
+    for (int p = 0; p < n; ++p) r.stops.append(net->stopNames[stopAt(p)]);
+    if (!hasTravelTimes() || !info.rawTimes.isEmpty()) {
+        r.travelTimes = info.rawTimes;
+    } else {
+        r.travelTimes.reserve(n - 1);
+        for (int p = 1; p < n; ++p) r.travelTimes.append(minutesAt(p) - minutesAt(p - 1));
+    }
+    return r;
+}
+
+QVector<Route> BusNetwork::routes() const
+{
+    QVector<Route> list;
+    list.reserve(routeCount());
+    for (int r = 0; r < routeCount(); ++r) list.append(route(r).toRoute());
+    return list;
+}
+
+BusNetwork BusNetwork::compacted() const
+{
+    QVector<Route> live;
+    live.reserve(routeCount() - vacantCount);
+    for (int r = 0; r < routeCount(); ++r)
+        if (!vacant[r]) live.append(route(r).toRoute());
+    BusNetwork net;
+    net.build(live);
+    return net;
+}
+
+int BusNetwork::routeIndex(const QString& id) const
+{
+    if (!routeOrder.isEmpty()) {
+        const auto it = std::lower_bound(routeOrder.cbegin(), routeOrder.cend(), id,
+                                         [this](int r, const QString& key) { return routeInfo[r].id < key; });
+        if (it == routeOrder.cend() || routeInfo[*it].id != id) return -1;
+        if (it + 1 != routeOrder.cend() && routeInfo[*(it + 1)].id == id) return -1;   // 重复的编号
+        return *it;
+    }
+    const int r = routeIds.value(id, -1);
+    return r == DUPLICATE_ID ? -1 : r;
+}
+
+StopId BusNetwork::findStop(const QString& name) const
+{
+    if (nameOrder.isEmpty()) return stopIds.value(name, INVALID_STOP);
+    const auto it = std::lower_bound(nameOrder.cbegin(), nameOrder.cend(), name,
+                                     [this](StopId s, const QString& key) { return stopNames[s] < key; });
+    return it != nameOrder.cend() && stopNames[*it] == name ? *it : INVALID_STOP;
+}
+
+// 快照读入的网络只有排好序的下标表；增量修改要随时登记新站名和新编号，先改建成哈希表
+void BusNetwork::thawIndexes()
+{
+    if (nameOrder.isEmpty() && routeOrder.isEmpty()) return;
+    stopIds.clear();
+    stopIds.reserve(stopNames.size());
+    for (int s = 0; s < stopNames.size(); ++s) stopIds.insert(stopNames[s], StopId(s));
+    nameOrder.clear();
+    routeOrder.clear();
+    buildRouteIndex();
+}
+
+int BusNetwork::positionOf(StopId stop, int route) const
+{
+    const StopVisitRange range = visitsAt(stop);
+    const StopVisit* it = std::lower_bound(range.begin(), range.end(), quint32(route),
+                                           [](const StopVisit& v, quint32 r) { return v.route < r; });
+    if (it == range.end() || it->route != quint32(route)) return -1;
+    return int(it->pos);
+}
+
+void BusNetwork::buildRouteIndex()
+{
+    routeIds.clear();
+    routeIds.reserve(routeInfo.size());
+    for (int r = 0; r < routeInfo.size(); ++r) {
+        if (vacant[r]) continue;
+        auto it = routeIds.find(routeInfo[r].id);
+        if (it == routeIds.end())
+            routeIds.insert(routeInfo[r].id, r);
+        else
+            it.value() = DUPLICATE_ID;
+    }
+}
+
+// 计数排序构建倒排索引：先统计每站经停次数，再按线路顺序回填，结果天然按线路升序
+void BusNetwork::buildStopIndex()
+{
+    const int n = stopNames.size();
+    QVector<quint32> firstSeen(n, 0xFFFFFFFFu);   // 同一线路重复经过的站只记一次
+    QVector<quint32> counts(n, 0);
+    for (int r = 0; r < routeCount(); ++r) {
+        const Span& span = routeSpans[r];
+        for (quint32 i = span.begin; i < span.begin + span.size; ++i) {
+            const StopId s = routeStops[i];
+            if (firstSeen[s] == quint32(r)) continue;
+            firstSeen[s] = quint32(r);
+            ++counts[s];
+        }
+    }
+    visitSpans.resize(n);
+    quint32 offset = 0;
+    for (int s = 0; s < n; ++s) {
+        visitSpans[s] = { offset, 0, counts[s] };
+        offset += counts[s];
+    }
+
+    visits.resize(offset);
+    liveVisits = offset;
+    firstSeen.fill(0xFFFFFFFFu);
+    for (int r = 0; r < routeCount(); ++r) {
+        const Span& span = routeSpans[r];
+        for (quint32 i = span.begin; i < span.begin + span.size; ++i) {
+            const StopId s = routeStops[i];
+            const quint32 pos = i - span.begin;
+            Span& vs = visitSpans[s];
+            if (firstSeen[s] == quint32(r)) {
+                visits[vs.begin + vs.size - 1].lastPos = pos;
+                continue;
+            }
+            firstSeen[s] = quint32(r);
+            visits[vs.begin + vs.size++] = { quint32(r), pos, pos };
+        }
+    }
+}
+
+// 从沿途各站的经停记录中摘掉这条线路；经停记录因此变空的站记入 emptied
+void BusNetwork::detachRoute(int route, QVector<StopId>& emptied)
+{
+    const Span& span = routeSpans[route];
+    for (quint32 i = span.begin; i < span.begin + span.size; ++i) {
+        const StopId s = routeStops[i];
+        Span& vs = visitSpans[s];
+        StopVisit* first = visits.data() + vs.begin;
+        StopVisit* last = first + vs.size;
+        StopVisit* it = std::lower_bound(first, last, quint32(route),
+                                         [](const StopVisit& v, quint32 r) { return v.route < r; });
+        if (it == last || it->route != quint32(route)) continue;    // 环线重复经过的站已经摘过
+        std::move(it + 1, last, it);
+        --vs.size;
+        --liveVisits;
+        if (vs.size == 0) emptied.append(s);
+    }
+}
+
+void BusNetwork::insertVisit(StopId stop, quint32 route, quint32 pos, QVector<StopId>& added)
+{
+    Span& vs = visitSpans[stop];
+    StopVisit* first = visits.data() + vs.begin;
+    StopVisit* it = std::lower_bound(first, first + vs.size, route,
+                                     [](const StopVisit& v, quint32 r) { return v.route < r; });
+    if (it != first + vs.size && it->route == route) {
+        it->lastPos = pos;
+        return;
+    }
+    qsizetype at = it - first;
+    if (vs.size == vs.capacity) {
+        // 原位置放不下，整段搬到数组末尾并留出余量，旧位置成为空洞
+        const quint32 capacity = qMax(4u, vs.capacity * 2);
+        const quint32 begin = quint32(visits.size());
+        visits.resize(visits.size() + capacity);
+        std::copy(visits.constData() + vs.begin, visits.constData() + vs.begin + vs.size,
+                  visits.data() + begin);
+        vs.begin = begin;
+        vs.capacity = capacity;
+        first = visits.data() + begin;
+    }
+    std::move_backward(first + at, first + vs.size, first + vs.size + 1);
+    first[at] = { route, pos, pos };
+    if (vs.size++ == 0) added.append(stop);
+    ++liveVisits;
+}
+
+// 写入线路的站点序列与累计耗时，并把它登记到沿途各站的经停记录；经停记录由空变非空的站记入 added
+void BusNetwork::attachRoute(int route, Route& data, QVector<StopId>& added)
+{
+    const quint32 n = quint32(data.stops.size());
+    Span& span = routeSpans[route];
+    if (n > span.capacity) {
+        span.begin = quint32(routeStops.size());
+        span.capacity = n;
+        routeStops.resize(routeStops.size() + n);
+        cumMinutes.resize(cumMinutes.size() + n);
+    }
+    liveStops += n;
+    liveStops -= span.size;
+    span.size = n;
+
+    const bool valid = data.travelTimes.size() == data.stops.size() - 1;
+    quint32 elapsed = 0;
+    for (quint32 i = 0; i < n; ++i) {
+        const StopId id = intern(data.stops[i]);
+        routeStops[span.begin + i] = id;
+        cumMinutes[span.begin + i] = elapsed;
+        if (valid && i < quint32(data.travelTimes.size())) elapsed += quint32(qMax(0, data.travelTimes[i]));
+
+        const QString& shared = stopNames[id];
+        if (data.stops[i].constData() != shared.constData())
+            data.stops[i] = shared;
+        insertVisit(id, quint32(route), i, added);
+    }
+    timesValid[route] = valid;
+    routeInfo[route] = infoOf(data);
+}
+
+// 空洞超过存储的一半时把仍在用的区段依次挪到数组前部；线路下标与站点编号不变
+void BusNetwork::compactStorage()
+{
+    if (quint32(routeStops.size()) - liveStops > qMax(4096u, liveStops)) {
+        QVector<StopId> stops;
+        QVector<quint32> minutes;
+        stops.reserve(liveStops);
+        minutes.reserve(liveStops);
+        for (Span& span : routeSpans) {
+            const quint32 begin = quint32(stops.size());
+            for (quint32 i = span.begin; i < span.begin + span.size; ++i) {
+                stops.append(routeStops[i]);
+                minutes.append(cumMinutes[i]);
+            }
+            span = { begin, span.size, span.size };
+        }
+        routeStops = stops;
+        cumMinutes = minutes;
+    }
+    if (quint32(visits.size()) - liveVisits > qMax(4096u, liveVisits)) {
+        QVector<StopVisit> packed;
+        packed.reserve(liveVisits);
+        for (Span& vs : visitSpans) {
+            const quint32 begin = quint32(packed.size());
+            for (quint32 i = vs.begin; i < vs.begin + vs.size; ++i) packed.append(visits[i]);
+            vs = { begin, vs.size, vs.size };
+        }
+        visits = packed;
+    }
+}
+
+void BusNetwork::finishEdit(int route, const QVector<StopId>& emptied, const QVector<StopId>& added,
+                            NetworkDelta* delta)
+{
+    buildVersion = versionCounter.fetchAndAddRelaxed(1) + 1;
+    edited = true;
+    compactStorage();
+    if (!delta) return;
+
+    // 改线时先摘后挂，同一个站可能先变空又被重新经过，这种站不算增删
+    delta->route = route;
+    delta->rebuilt = false;
+    delta->addedStops.clear();
+    delta->removedStops.clear();
+    for (StopId s : emptied)
+        if (!stopInUse(s)) delta->removedStops.append(stopNames[s]);
+    for (StopId s : added)
+        if (!emptied.contains(s)) delta->addedStops.append(stopNames[s]);
+}
+
+bool BusNetwork::upsertRoute(Route& route, NetworkDelta* delta)
+{
+    if (route.id.isEmpty()) return false;
+    thawIndexes();
+    int r = routeIds.value(route.id, -1);
+    if (r == DUPLICATE_ID) return false;
+
+    QVector<StopId> emptied;
+    QVector<StopId> added;
+    if (r < 0) {
+        // 新线路总是追加在最后，保证仍在用的槽位顺序与调用方的线路列表一致
+        r = routeInfo.size();
+        routeInfo.append(RouteInfo());
+        vacant.append(false);
+        timesValid.append(false);
+        routeSpans.append({ quint32(routeStops.size()), 0, 0 });
+        routeIds.insert(route.id, r);
+    } else {
+        detachRoute(r, emptied);
+    }
+    attachRoute(r, route, added);
+    transferGraph.updateRoute(*this, r);
+    finishEdit(r, emptied, added, delta);
+    return true;
+}
+
+bool BusNetwork::removeRoute(const QString& id, NetworkDelta* delta)
+{
+    thawIndexes();
+    const int r = routeIndex(id);
+    if (r < 0) return false;
+
+    QVector<StopId> emptied;
+    detachRoute(r, emptied);
+    liveStops -= routeSpans[r].size;
+    routeSpans[r].size = 0;
+    routeInfo[r] = RouteInfo();
+    vacant[r] = true;
+    timesValid[r] = false;
+    routeIds.remove(id);
+    ++vacantCount;
+    transferGraph.updateRoute(*this, r);
+    finishEdit(r, emptied, {}, delta);
+
+    // 空槽太多时各算法按线路数开的数组都白白变大，整体重新编译一次
+    if (vacantCount > qMax(64, routeCount() / 4)) {
+        QVector<Route> live;
+        live.reserve(routeCount() - vacantCount);
+        for (int i = 0; i < routeCount(); ++i)
+            if (!vacant[i]) live.append(route(i).toRoute());
+        build(live);
+        if (delta) {
+            delta->route = -1;
+            delta->rebuilt = true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,232 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "route.h"
+#include "transfergraph.h"
+#include <QVector>
+#include <QString>
+#include <QHash>
+#include <QByteArray>
+
+// 站点编号：每个站名只驻留一次，映射为从 0 开始的连续整数
+using StopId = quint32;
+constexpr StopId INVALID_STOP = 0xFFFFFFFFu;
+
+class BusNetwork;
+
+// 倒排索引中的一条经停记录：哪条线路、在第几站
+struct StopVisit {
+    quint32 route;
+    quint32 pos;        // 首次出现的位置
+    quint32 lastPos;    // 最后一次出现的位置；环线等重复经过同一站时与 pos 不同
+};
+
+// 一段数据在扁平数组中的位置。线路的站点序列与各站的经停记录都这样存放：
+// 整体编译时首尾相接（等同 CSR），增量修改时在原处收缩、放不下就搬到数组末尾，旧位置留作空洞，
+// 空洞累计过多再整体压紧
+struct Span {
+    quint32 begin;
+    quint32 size;
+    quint32 capacity;
+};
+
+// 一次增量修改的结果
+struct NetworkDelta {
+    int route = -1;                 // 被修改的线路下标
+    bool rebuilt = false;           // 删除留下的空槽过多，已整体重新编译（站点编号、线路下标都变了）
+    QVector<QString> addedStops;    // 原先没有线路经过、现在有了的站
+    QVector<QString> removedStops;  // 最后一条经过它的线路被删除或改线的站
+};
+
+// 某站点全部经停记录的只读区间（按线路下标升序）
+struct StopVisitRange {
+    const StopVisit* first = nullptr;
+    const StopVisit* last = nullptr;
+    const StopVisit* begin() const { return first; }
+    const StopVisit* end() const { return last; }
+    qsizetype size() const { return last - first; }
+    bool isEmpty() const { return first == last; }
+};
+
+// 线路视图：只保存网络指针和线路下标，站点与耗时都从网络的扁平数组中读取
+class RouteView
+{
+public:
+    RouteView(const BusNetwork* network, int index) : net(network), idx(index) {}
+
+    int index() const { return idx; }
+    const QString& id() const;
+    const QString& name() const;
+    QTime firstBus() const;
+    QTime lastBus() const;
+    // 还原成完整的 Route（站名取自驻留表），O(站点数)；只在编辑、导出等需要整条线路时使用
+    Route toRoute() const;
+    int stopCount() const;
+    StopId stopAt(int pos) const;
+    int indexOf(StopId stop) const;     // 站点在线路中的位置（首次出现），不存在返回 -1
+    bool contains(StopId stop) const { return indexOf(stop) != -1; }
+    int travelTime(int fromPos, int toPos) const;   // 两个位置间的行驶分钟数（前缀和相减），耗时数据无效时返回 -1
+    bool hasTravelTimes() const;        // travelTimes 与站点数是否匹配
+    int minutesAt(int pos) const;       // 首站到该位置的累计分钟数
+
+private:
+    const BusNetwork* net;
+    int idx;
+};
+
+// 整个线网的紧凑表示：
+// 站名驻留为 StopId，所有线路的站点序列和区间耗时存放在连续数组中（整体编译后为 CSR 布局）。
+// 单条线路可以增量增删改：线路下标和站点编号保持不变，站点的经停记录数即经过它的线路数，
+// 降为零的站点对外视为不存在（站名仍留在驻留表里，重新有线路经过时沿用原编号）。
+// 从快照读入的网络，扁平数组与换乘图直接引用读入的文件内容，站名与线路编号按快照里排好序的下标表二分查找；
+// 第一次增量修改时才改建哈希表，被修改的数组各自复制出一份（写时复制）
+class BusNetwork
+{
+public:
+    // 由线路列表重新编译网络；同时把 routes 中的站名替换为驻留表里的共享副本
+    void build(QVector<Route>& routes);
+    void clear();
+
+    // 增量修改：替换同编号的线路，编号不存在时追加为最后一条；route 的站名同样换成驻留副本。
+    // 只改动这条线路的站点序列、沿途各站的经停记录和换乘图里与它相连的边，
+    // 代价与线路长度及沿途各站的经停线路数成正比。
+    // 编号为空或在网络中不止一次出现时无法确定改哪一条，返回 false，调用方应整体 build()。
+    // 快照读入后的第一次修改还要先建站名、线路编号的哈希表，多花 O(站点数 + 线路数)
+    bool upsertRoute(Route& route, NetworkDelta* delta = nullptr);
+    // 删除线路：槽位留空（编号为空、没有站点），其余线路的下标不变；空槽过多时整体重新编译。
+    // 编号不存在或重复时返回 false
+    bool removeRoute(const QString& id, NetworkDelta* delta = nullptr);
+
+    // 每次 build()/clear() 和增量修改都换一个全局唯一的版本号；副本与原网络版本相同。
+    // 依附于某一版网络的缓存（如渲染片段）据此判断是否失效
+    quint64 version() const { return buildVersion; }
+
+    // 线路数含删除留下的空槽；routes() 逐条还原（见 RouteView::toRoute()），空槽为默认构造的 Route，
+    // 其余线路的相对顺序与编译时一致
+    int routeCount() const { return routeInfo.size(); }
+    QVector<Route> routes() const;
+    bool isVacant(int route) const { return vacant[route]; }
+    // 编号 -> 线路下标；不存在或重复时返回 -1
+    int routeIndex(const QString& id) const;
+    int stopCount() const { return stopNames.size(); }
+    RouteView route(int index) const { return RouteView(this, index); }
+
+    // 没有线路经过的站点返回 INVALID_STOP
+    StopId stopId(const QString& name) const;
+    const QString& stopName(StopId id) const { return stopNames[id]; }
+    bool stopInUse(StopId id) const { return visitSpans[id].size > 0; }
+    // 驻留表中的全部站名（下标即 StopId），可能含已无线路经过的站
+    const QVector<QString>& stops() const { return stopNames; }
+
+    // 自上次整体编译以来没有增量修改过（快照只保存这种布局）
+    bool isCompact() const { return !edited; }
+    // 去掉空槽与空洞、重新编译出的等价网络
+    BusNetwork compacted() const;
+
+    // 倒排索引：经过该站的所有线路及位置；未知站点返回空区间
+    StopVisitRange visitsAt(StopId stop) const;
+    // 站点在指定线路中的位置（首次出现），不经过返回 -1；O(log 经停线路数)
+    int positionOf(StopId stop, int route) const;
+    // 线路之间的换乘关系，随网络一起构建
+    const TransferGraph& transfers() const { return transferGraph; }
+
+private:
+    friend class RouteView;
+    friend class NetworkSnapshot;
+    static constexpr int DUPLICATE_ID = -2;
+
+    // 线路的展示信息；站点与耗时只存在下面的扁平数组里，站名只在驻留表里存一份
+    struct RouteInfo {
+        QString id;
+        QString name;
+        QTime firstBus;
+        QTime lastBus;
+        QList<int> rawTimes;    // 原始 travelTimes 无法由累计耗时还原（长度不匹配或含负数）时才保存
+    };
+
+    StopId intern(const QString& name);
+    StopId findStop(const QString& name) const;
+    void thawIndexes();
+    void buildStopIndex();
+    void buildRouteIndex();
+    void detachRoute(int route, QVector<StopId>& emptied);
+    void attachRoute(int route, Route& data, QVector<StopId>& added);
+    static RouteInfo infoOf(const Route& route);
+    void insertVisit(StopId stop, quint32 route, quint32 pos, QVector<StopId>& added);
+    void compactStorage();
+    void finishEdit(int route, const QVector<StopId>& emptied, const QVector<StopId>& added,
+                    NetworkDelta* delta);
+
+    QVector<RouteInfo> routeInfo;    // 各线路的编号、名称、首末班
+    QVector<bool> vacant;            // 槽位是否已被删除
+    QHash<QString, int> routeIds;    // 线路编号 -> 下标，重复的编号为 DUPLICATE_ID
+    QVector<QString> stopNames;      // 站点编号 -> 站名
+    QHash<QString, StopId> stopIds;  // 站名 -> 站点编号
+    QVector<StopId> nameOrder;       // 快照读入时代替 stopIds：按站名排序的站点编号
+    QVector<int> routeOrder;         // 快照读入时代替 routeIds：按编号排序的线路下标
+    QByteArray image;                // 快照文件内容，下面未经修改的数组直接引用其中的数据
+    QVector<Span> routeSpans;        // 第 r 条线路的站点在 routeStops 中的位置
+    QVector<StopId> routeStops;      // 所有线路的站点编号
+    QVector<quint32> cumMinutes;     // 与 routeStops 同下标：首站到本站的累计分钟数（前缀和）
+    QVector<bool> timesValid;        // travelTimes 长度是否与站点数匹配
+    QVector<Span> visitSpans;        // 第 s 个站点的经停记录在 visits 中的位置
+    QVector<StopVisit> visits;       // 每条线路在每个站点只占一条记录（首次与最后一次出现的位置）
+    TransferGraph transferGraph;
+    quint32 liveStops = 0;           // routeStops 中仍属于某条线路的元素数，其余是空洞
+    quint32 liveVisits = 0;          // visits 中仍属于某个站点的元素数
+    int vacantCount = 0;
+    bool edited = false;
+    quint64 buildVersion = 0;
+};
+
+inline const QString& RouteView::id() const { return net->routeInfo[idx].id; }
+inline const QString& RouteView::name() const { return net->routeInfo[idx].name; }
+inline QTime RouteView::firstBus() const { return net->routeInfo[idx].firstBus; }
+inline QTime RouteView::lastBus() const { return net->routeInfo[idx].lastBus; }
+
+inline int RouteView::stopCount() const
+{
+    return int(net->routeSpans[idx].size);
+}
+
+inline StopId RouteView::stopAt(int pos) const
+{
+    return net->routeStops[net->routeSpans[idx].begin + pos];
+}
+
+inline int RouteView::travelTime(int fromPos, int toPos) const
+{
+    if (!net->timesValid[idx]) return -1;
+    const quint32* cum = net->cumMinutes.constData() + net->routeSpans[idx].begin;
+    return qAbs(int(cum[toPos]) - int(cum[fromPos]));
+}
+
+inline bool RouteView::hasTravelTimes() const
+{
+    return net->timesValid[idx];
+}
+
+inline int RouteView::minutesAt(int pos) const
+{
+    return int(net->cumMinutes[net->routeSpans[idx].begin + pos]);
+}
+
+inline int RouteView::indexOf(StopId stop) const
+{
+    return net->positionOf(stop, idx);
+}
+
+inline StopVisitRange BusNetwork::visitsAt(StopId stop) const
+{
+    if (stop >= StopId(stopNames.size())) return {};
+    const StopVisit* first = visits.constData() + visitSpans[stop].begin;
+    return { first, first + visitSpans[stop].size };
+}
+
+inline StopId BusNetwork::stopId(const QString& name) const
+{
+    const StopId id = findStop(name);
+    return id != INVALID_STOP && visitSpans[id].size > 0 ? id : INVALID_STOP;
+}
+
+#endif // NETWORK_H
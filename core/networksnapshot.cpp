@@ -0,0 +1,326 @@
+#include "networksnapshot.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'B', 'U', 'S', 'S', 'N', 'A', 'P', '\0' };
+constexpr quint32 BYTE_ORDER_MARK = 0x01020304;
+constexpr int HASH_BYTES = 32;
+constexpr quint16 NO_TIME = 0xFFFF;
+
+struct Header {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 byteOrder;
+    char sourceHash[HASH_BYTES];
+    quint32 routeCount;
+    quint32 stopCount;
+    quint32 totalStops;         // 所有线路站点数之和
+    quint32 travelTimeCount;    // 所有线路原始 travelTimes 的条数之和
+    quint32 visitCount;
+    quint32 stringCount;        // 前 stopCount 个为站名（按 StopId），其后每条线路依次为编号、名称
+    quint32 stringChars;        // 字符串表的 UTF-16 码元总数
+    quint32 linkCount;          // 换乘图的记录总数
+};
+
+struct RouteRecord {
+    quint16 firstBus;           // 当日分钟数，NO_TIME 表示无效
+    quint16 lastBus;
+    quint32 travelOffset;       // 原始 travelTimes 位于 [travelOffset, 下一条的 travelOffset)
+};
+
+static_assert(sizeof(Header) == 80, "snapshot header layout");
+static_assert(sizeof(RouteRecord) == 8, "snapshot route layout");
+static_assert(sizeof(StopVisit) == 12, "snapshot visit layout");
+static_assert(sizeof(Span) == 12, "snapshot span layout");
+static_assert(sizeof(TransferLink) == 16, "snapshot link layout");
+static_assert(sizeof(bool) == 1, "timesValid is stored as one byte per route");
+
+// 各段按 8 字节对齐，读入后可直接按类型访问
+qsizetype aligned(qsizetype n) { return (n + 7) & ~qsizetype(7); }
+
+template<typename T>
+void appendSection(QByteArray& out, const T* data, qsizetype count)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char*>(data), count * qsizetype(sizeof(T)));
+    out.append(QByteArray(aligned(out.size()) - out.size(), '\0'));
+}
+
+// 不拥有数据的 QVector，直接引用 p 处的 n 个元素；与 QByteArray::fromRawData 一样，第一次写入时才复制出自己的一份。
+// p 所在的内存须比返回的数组及其所有副本活得长，这里由 BusNetwork::image 保证
+template<typename T>
+QVector<T> borrow(const T* p, qsizetype n)
+{
+    return QVector<T>(QArrayDataPointer<T>::fromRawData(p, n));
+}
+
+// 顺序读取快照内容中的各段，越界即失败
+class SectionReader
+{
+public:
+    SectionReader(const uchar* data, qint64 size) : base(data), total(size) {}
+
+    template<typename T>
+    const T* take(qsizetype count)
+    {
+        const qint64 bytes = qint64(count) * qint64(sizeof(T));
+        if (count < 0 || offset + bytes > total) return nullptr;
+        const T* p = reinterpret_cast<const T*>(base + offset);
+        offset = aligned(offset + bytes);
+        return p;
+    }
+
+    template<typename T>
+    bool borrowInto(QVector<T>& out, qsizetype count)
+    {
+        const T* p = take<T>(count);
+        if (!p) return false;
+        out = borrow(p, count);
+        return true;
+    }
+
+private:
+    const uchar* base;
+    qint64 total;
+    qint64 offset = 0;
+};
+
+quint16 packTime(const QTime& t) { return t.isValid() ? quint16(t.hour() * 60 + t.minute()) : NO_TIME; }
+QTime unpackTime(quint16 m) { return m == NO_TIME ? QTime() : QTime(m / 60, m % 60); }
+
+} // namespace
+
+QByteArray NetworkSnapshot::sourceHash(const QByteArray& jsonData)
+{
+    return QCryptographicHash::hash(jsonData, QCryptographicHash::Sha256);
+}
+
+bool NetworkSnapshot::save(const QString& fileName, const BusNetwork& network, const QByteArray& sourceData)
+{
+    // 增量修改过的网络带有空槽和空洞，先重新编译成首尾相接的布局再写
+    if (!network.isCompact()) return save(fileName, network.compacted(), sourceData);
+
+    // 字符串表：站名在前（下标即 StopId），随后是各线路的编号与名称
+    QVector<quint32> stringOffsets{ 0 };
+    QString stringData;
+    auto addString = [&](const QString& s) {
+        stringData += s;
+        stringOffsets.append(quint32(stringData.size()));
+    };
+    for (const QString& s : network.stopNames) addString(s);
+    for (const BusNetwork::RouteInfo& info : network.routeInfo) {
+        addString(info.id);
+        addString(info.name);
+    }
+
+    QVector<RouteRecord> records;
+    QVector<qint32> travelTimes;
+    records.reserve(network.routeCount());
+    for (int r = 0; r < network.routeCount(); ++r) {
+        const RouteView rv = network.route(r);
+        records.append({ packTime(rv.firstBus()), packTime(rv.lastBus()), quint32(travelTimes.size()) });
+        for (int t : rv.toRoute().travelTimes) travelTimes.append(t);
+    }
+    QVector<quint8> timesValid;
+    timesValid.reserve(network.timesValid.size());
+    for (bool v : network.timesValid) timesValid.append(v ? 1 : 0);
+
+    // 读入时不再建哈希表，站名和线路编号改为按这两张排好序的下标表二分查找
+    QVector<StopId> nameOrder(network.stopNames.size());
+    std::iota(nameOrder.begin(), nameOrder.end(), StopId(0));
+    std::sort(nameOrder.begin(), nameOrder.end(),
+              [&](StopId a, StopId b) { return network.stopNames[a] < network.stopNames[b]; });
+    QVector<qint32> routeOrder(network.routeCount());
+    std::iota(routeOrder.begin(), routeOrder.end(), 0);
+    std::stable_sort(routeOrder.begin(), routeOrder.end(),
+                     [&](qint32 a, qint32 b) { return network.routeInfo[a].id < network.routeInfo[b].id; });
+
+    // 换乘图按线路首尾相接写成一段，读入后各线路的记录直接引用其中一截
+    QVector<quint32> linkOffsets{ 0 };
+    QVector<TransferLink> links;
+    for (int r = 0; r < network.routeCount(); ++r) {
+        for (const TransferLink& e : network.transfers().links(r)) links.append(e);
+        linkOffsets.append(quint32(links.size()));
+    }
+
+    Header h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.formatVersion = FORMAT_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    const QByteArray hash = sourceHash(sourceData);
+    std::memcpy(h.sourceHash, hash.constData(), size_t(qMin(int(hash.size()), HASH_BYTES)));
+    h.routeCount = quint32(network.routeCount());
+    h.stopCount = quint32(network.stopNames.size());
+    h.totalStops = quint32(network.routeStops.size());
+    h.travelTimeCount = quint32(travelTimes.size());
+    h.visitCount = quint32(network.visits.size());
+    h.stringCount = quint32(stringOffsets.size() - 1);
+    h.stringChars = quint32(stringData.size());
+    h.linkCount = quint32(links.size());
+
+    QByteArray out;
+    appendSection(out, &h, 1);
+    appendSection(out, stringOffsets.constData(), stringOffsets.size());
+    appendSection(out, reinterpret_cast<const char16_t*>(stringData.constData()), stringData.size());
+    appendSection(out, records.constData(), records.size());
+    appendSection(out, travelTimes.constData(), travelTimes.size());
+    appendSection(out, network.routeSpans.constData(), network.routeSpans.size());
+    appendSection(out, network.routeStops.constData(), network.routeStops.size());
+    appendSection(out, network.cumMinutes.constData(), network.cumMinutes.size());
+    appendSection(out, timesValid.constData(), timesValid.size());
+    appendSection(out, network.visitSpans.constData(), network.visitSpans.size());
+    appendSection(out, network.visits.constData(), network.visits.size());
+    appendSection(out, nameOrder.constData(), nameOrder.size());
+    appendSection(out, routeOrder.constData(), routeOrder.size());
+    appendSection(out, linkOffsets.constData(), linkOffsets.size());
+    appendSection(out, links.constData(), links.size());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(out);
+    return file.commit();
+}
+
+bool NetworkSnapshot::load(const QString& fileName, const QString& jsonFile, BusNetwork& network, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    // 整个文件一次读进内存，网络的扁平数组直接引用其中的数据。不保留文件映射：
+    // 映射着的文件在 Windows 上无法被 QSaveFile 替换，保存新快照时会失败
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail(file.errorString());
+    const QByteArray image = file.readAll();
+    file.close();
+    if (image.isEmpty() || quintptr(image.constData()) % alignof(quint32) != 0) return fail("无法读取快照文件");
+
+    SectionReader in(reinterpret_cast<const uchar*>(image.constData()), image.size());
+    const Header* h = in.take<Header>(1);
+    if (!h || std::memcmp(h->magic, MAGIC, sizeof MAGIC) != 0) return fail("不是线网快照");
+    if (h->formatVersion != FORMAT_VERSION || h->byteOrder != BYTE_ORDER_MARK) return fail("快照格式版本不符");
+
+    // 与当前 JSON 内容比对；JSON 映射读取，不做解析
+    QFile json(jsonFile);
+    if (!json.open(QIODevice::ReadOnly)) return fail(json.errorString());
+    const qint64 jsonSize = json.size();
+    const uchar* jsonData = jsonSize > 0 ? json.map(0, jsonSize) : nullptr;
+    const QByteArray current = jsonData ? sourceHash(QByteArray::fromRawData(reinterpret_cast<const char*>(jsonData), jsonSize))
+                                        : sourceHash(json.readAll());
+    if (std::memcmp(h->sourceHash, current.constData(), size_t(qMin(int(current.size()), HASH_BYTES))) != 0)
+        return fail("快照已过期");
+
+    const quint32* stringOffsets = in.take<quint32>(qsizetype(h->stringCount) + 1);
+    const char16_t* chars = in.take<char16_t>(h->stringChars);
+    const RouteRecord* records = in.take<RouteRecord>(h->routeCount);
+    const qint32* travel = in.take<qint32>(h->travelTimeCount);
+    if (!stringOffsets || !chars || !records || !travel) return fail("快照已损坏");
+    if (h->stringCount != h->stopCount + 2 * h->routeCount || stringOffsets[h->stringCount] != h->stringChars)
+        return fail("快照已损坏");
+
+    BusNetwork net;
+    net.clear();
+    net.image = image;
+    if (!in.borrowInto(net.routeSpans, h->routeCount) || !in.borrowInto(net.routeStops, h->totalStops)
+        || !in.borrowInto(net.cumMinutes, h->totalStops) || !in.borrowInto(net.timesValid, h->routeCount)
+        || !in.borrowInto(net.visitSpans, h->stopCount) || !in.borrowInto(net.visits, h->visitCount)
+        || !in.borrowInto(net.nameOrder, h->stopCount) || !in.borrowInto(net.routeOrder, h->routeCount))
+        return fail("快照已损坏");
+    const quint32* linkOffsets = in.take<quint32>(qsizetype(h->routeCount) + 1);
+    const TransferLink* links = in.take<TransferLink>(h->linkCount);
+    if (!linkOffsets || !links) return fail("快照已损坏");
+
+    // 只做线性的只读检查，保证后续按下标访问不会越界、二分查找的前提成立
+    auto contiguous = [](const QVector<Span>& spans, quint32 total) {
+        quint32 next = 0;
+        for (const Span& span : spans) {
+            if (span.begin != next || span.capacity != span.size || span.size > total - next) return false;
+            next += span.size;
+        }
+        return next == total;
+    };
+    if (!contiguous(net.routeSpans, h->totalStops) || !contiguous(net.visitSpans, h->visitCount))
+        return fail("快照已损坏");
+    for (StopId s : std::as_const(net.routeStops))
+        if (s >= h->stopCount) return fail("快照已损坏");
+    const quint8* validBytes = reinterpret_cast<const quint8*>(net.timesValid.constData());
+    for (quint32 r = 0; r < h->routeCount; ++r)
+        if (validBytes[r] > 1) return fail("快照已损坏");
+    // 经停记录的位置要落在所属线路之内，查询按它们取 stopAt()
+    for (const StopVisit& v : std::as_const(net.visits)) {
+        if (v.route >= h->routeCount || v.pos > v.lastPos || v.lastPos >= net.routeSpans.at(v.route).size)
+            return fail("快照已损坏");
+    }
+    // 换乘记录同样要落在两条线路之内，且每条线路的记录按对方线路排好序（between() 二分查找）
+    if (linkOffsets[0] != 0 || linkOffsets[h->routeCount] != h->linkCount) return fail("快照已损坏");
+    for (quint32 r = 0; r < h->routeCount; ++r) {
+        if (linkOffsets[r] > linkOffsets[r + 1]) return fail("快照已损坏");
+        for (quint32 i = linkOffsets[r]; i < linkOffsets[r + 1]; ++i) {
+            const TransferLink& e = links[i];
+            if (e.route >= h->routeCount || e.stop >= h->stopCount || e.fromPos >= net.routeSpans.at(r).size
+                || e.toPos >= net.routeSpans.at(e.route).size || (i > linkOffsets[r] && links[i - 1].route > e.route))
+                return fail("快照已损坏");
+        }
+    }
+    // 末项已确认等于 stringChars，各项不减即都在字符区之内
+    for (quint32 i = 0; i < h->stringCount; ++i)
+        if (stringOffsets[i] > stringOffsets[i + 1]) return fail("快照已损坏");
+
+    // 站名会流到界面和各处结果里，比网络本身活得长，仍复制成独立的字符串
+    auto stringAt = [&](quint32 i) {
+        return QString(reinterpret_cast<const QChar*>(chars + stringOffsets[i]),
+                       qsizetype(stringOffsets[i + 1] - stringOffsets[i]));
+    };
+    net.stopNames.reserve(h->stopCount);
+    for (quint32 s = 0; s < h->stopCount; ++s) net.stopNames.append(stringAt(s));
+    // 按站名严格递增，同时说明各项互不相同、恰好是全部站点
+    for (quint32 i = 0; i < h->stopCount; ++i) {
+        const StopId s = net.nameOrder.at(i);
+        if (s >= h->stopCount || (i > 0 && !(net.stopNames.at(net.nameOrder.at(i - 1)) < net.stopNames.at(s))))
+            return fail("快照已损坏");
+    }
+
+    // 线路的展示信息；站点与累计耗时已在扁平数组里，原始 travelTimes 只在无法还原时留一份
+    net.routeInfo.reserve(h->routeCount);
+    for (quint32 r = 0; r < h->routeCount; ++r) {
+        BusNetwork::RouteInfo info;
+        info.id = stringAt(h->stopCount + 2 * r);
+        info.name = stringAt(h->stopCount + 2 * r + 1);
+        info.firstBus = unpackTime(records[r].firstBus);
+        info.lastBus = unpackTime(records[r].lastBus);
+        const quint32 travelEnd = r + 1 < h->routeCount ? records[r + 1].travelOffset : h->travelTimeCount;
+        if (records[r].travelOffset > travelEnd || travelEnd > h->travelTimeCount) return fail("快照已损坏");
+        bool regular = net.timesValid.at(r);
+        for (quint32 i = records[r].travelOffset; i < travelEnd; ++i) regular = regular && travel[i] >= 0;
+        if (!regular)
+            for (quint32 i = records[r].travelOffset; i < travelEnd; ++i) info.rawTimes.append(travel[i]);
+        net.routeInfo.append(info);
+    }
+    // 按编号排序的线路下标：各项在范围内、互不重复，编号不减（重复的编号相邻）
+    QVector<bool> seen(h->routeCount, false);
+    for (quint32 i = 0; i < h->routeCount; ++i) {
+        const int r = net.routeOrder.at(i);
+        if (r < 0 || quint32(r) >= h->routeCount || seen[r]) return fail("快照已损坏");
+        if (i > 0 && net.routeInfo[r].id < net.routeInfo[net.routeOrder.at(i - 1)].id) return fail("快照已损坏");
+        seen[r] = true;
+    }
+
+    net.vacant.fill(false, h->routeCount);
+    net.liveStops = h->totalStops;
+    net.liveVisits = h->visitCount;
+
+    net.transferGraph.routeLinks.reserve(h->routeCount);
+    for (quint32 r = 0; r < h->routeCount; ++r)
+        net.transferGraph.routeLinks.append(borrow(links + linkOffsets[r], qsizetype(linkOffsets[r + 1] - linkOffsets[r])));
+    network = net;
+    return true;
+}
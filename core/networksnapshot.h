@@ -0,0 +1,30 @@
+#ifndef NETWORKSNAPSHOT_H
+#define NETWORKSNAPSHOT_H
+
+#include "network.h"
+#include <QString>
+#include <QByteArray>
+
+// 线网的二进制快照，与线路 JSON 并排存放（bus_routes.json -> bus_routes.json.snap），用于快速启动。
+// 内容是 BusNetwork 编译后的原样：驻留站名表、各线路的扁平数组、站点倒排索引、换乘图，
+// 以及代替哈希表的站名、线路编号排序下标。读取时整个文件读进一块内存，扁平数组、索引和换乘图
+// 直接引用其中的数据，只做线性的越界检查，不拷贝也不重建；只有站名和线路名复制成独立的字符串。
+// 文件头记录生成它的 JSON 的内容哈希，JSON 被改动（包括在程序外改动）后快照即视为过期，
+// 调用方应退回 JSON 并重新写快照。字节序与本机不同、格式版本不符时同样视为过期。
+class NetworkSnapshot
+{
+public:
+    static constexpr quint32 FORMAT_VERSION = 2;
+
+    static QString pathFor(const QString& jsonFile) { return jsonFile + ".snap"; }
+    // 快照里记录的源数据哈希
+    static QByteArray sourceHash(const QByteArray& jsonData);
+
+    // 写入 network 的快照；sourceData 为与之对应的 JSON 原文。先写临时文件再替换，不会留下半个快照
+    static bool save(const QString& fileName, const BusNetwork& network, const QByteArray& sourceData);
+    // 快照存在、格式有效且与 jsonFile 当前内容一致时读入 network 并返回 true；否则 network 不变
+    static bool load(const QString& fileName, const QString& jsonFile, BusNetwork& network,
+                     QString* error = nullptr);
+};
+
+#endif // NETWORKSNAPSHOT_H
@@ -0,0 +1,248 @@
+#include "pinyin.h"
+
+namespace {
+
+constexpr char16_t FIRST_HANZI = 0x4E00;
+constexpr char16_t LAST_HANZI = 0x9FA5;
+
+// U+4E00..U+9FA5 每个字一个字节，'_' 表示不在 GB2312 一级字库中。
+// 由 GB2312 一级汉字按拼音排序的区位分界生成
+const char INITIALS[] =
+    "yd_q___wzssx_by__c_zq_s_qbycds____d_ly_s__gy_z__f_c_l___wdwz_lj____n_j__my_zwzhfl_ppq_g_cy___jqyxx__"
+    "__s_________ml_r__________q_______l_yz_se_yk_yh_wj____yx_____wk_jhychm_xjtl___q_______r____ysr___jpc"
+    "__jj_rc__l_czstzfx_____q___dly____y_m___y_z___jj___r_f_f_q________y__wjffx_____zyhh___swc___s_l___w_"
+    "___bg___b_l_s_s_s______d__d______wdzzy_t_h___y_fz___n__y_____p__l__yb__j___________s____z___c__l_s__"
+    "_______d___g_y__x__l_jzcqk____wh_____q_________b___ce_____j____ql______sf____by__x_______l___jxf_j__"
+    "______a__________________b____d_j___thy____j_c____j___n_______________z_z_q________j_______p________"
+    "__z_t________j________________ot_______ck____f__l____b_____________________d____c___c_____a________s"
+    "___________________x__________l____________s___________s_j_____p______________________r_____________"
+    "_l_____________________________e_y_yxcz_xg_k_m___d__t_____d_d_____j__r__q__bgl__lg_gxbqjdz_yjs__j___"
+    "_n__gr__cz____m__m_r_x_jn___g___y_______d__fb_cj_kyl___d____j___q_z__l_dl__j_c_________l_n__jf__f___"
+    "_____p_kh__d__x_tacj_h_zdd_r__fq__k______xh____llzgc_c__s___p___pl_b__g_d_____zsqsck_g___djt______x_"
+    "_q__gj__t_p______________b_j_sj____f__g____________j________p__________________l_qbgjw_l____dznj____"
+    "_ljl___________s___b___y_m_x______l_____k______m____q_____________________s___gwy____bc_x___________"
+    "__hb_c___z__jk_x______f______________pqy___n_s_q___swhb___hx_bzz_dmn__b_b_b_zkl_l__w___w___myw_jql_j"
+    "x______q__c_etl__l_yy________c__l_h____y__x___x_cj_________________q___x_sc_____ycjysf___f__s_qsbx_p"
+    "____d__kgjl___zjzbdkt_sy__yhst__d____y_cg___hjd_tmhltx_x_l_m___j_ltyf_____fbdf_htksq_z__wc__xc_wh_w_"
+    "y_____d_c_g_____n____o__y__qw_____n_____z__________w_h__p__shm__j_____p____zh_jyf_z__gk__l__________"
+    "____z___y__k_z_k____x____y__ap__h_dwhz___xa__y_____h_______y_____go_sln__kx___z_______b_h____y____sc"
+    "_a______t___________________h_______h_sw_c____________t____kz_s___a______________________f__psl___p_"
+    "__n_________x___t___k_w_s__l_hh_____________c___xh_________x___________z___p___y_________x__________"
+    "___s________s____w_s_________________________s___________j____g_________x__m_____________________zc_"
+    "z_s____x___h______________y_________________________q_z_s_________g_______________________ht________"
+    "___________x___________________r____j_____________n_______________qs__h_y_t_d________y__kc__w_____g_"
+    "_gt____p__y_q______________________t___s____z____g__d_________c___j_z______j__f__tkhzk_____k__jt_bwf"
+    "zp__k_t___p____p_______k__________cll______x______l________d______gy__k____d__k___________________ga"
+    "_______m__c_____p__________yb________________________pj_______t___d__________q___d___________b__d___"
+    "__k_____y____d______________________t____s__t___t_____s____________t_______________________j_s______"
+    "______sm_____q____zx________md_______________________b___________________h______________r______sr_z_"
+    "s__k__h__y__________c__b_____f_x_____xw___d_y__g_______d_ttf__yh_s__t__ykjd_________y__qnf_f__kz_q__"
+    "b_jt________d_s__a_____________nn_n_jt___h____r_w_zfm_r_______dj__y__m___________t__f_____n_________"
+    "_m_q__________m____s____jg_xw_____y_j________l__y___j______________y___z_w_wl__j________________n___"
+    "n__js____e___m_______y____q_______________p__w________________h_______________l_________y_s________x"
+    "__________________m_______m________________________x_____________js______j__x____________________d__"
+    "_____n______________________________________________________________________________________________"
+    "________z___ky_zcs__zx_m___jg_x__hl_____s____f____r__n___n_t_z_ysa_sw__h_______zgzdwybs_cskxs_h___xg"
+    "____z__hyxj__r___kbs__j_jymk____f___m_hy_________qmc_g___l__z_______________cdsxd__s_f__s_j__wz____x"
+    "_s__e_j_c_s__c______y__y_________j______syc_njwnjpc__j__qtjw__sp_x___z________s_tl___l_________t_s__"
+    "_____y_____y_sq_________________c__g___d_____________y___l_____y____a______k________________________"
+    "_z_______x____l_e_y__q__f__________j___________c______q_____c_y__________________b___z______________"
+    "________________q___________________________________________________________________________________"
+    "_____________________________________________w_______________cz__xc__gzqjg_w__c__jysb__x______j__bsb"
+    "_sf_s___x___z____pt_l_zbzd________dz_____xb_________c____m____m__f______h________m____________c_____"
+    "__________gpn_b_x__hyy_g____z_qb__c____xl__kyd_d_mg_f_pf______dz_____t________sky________________ll_"
+    "_______k__l_______________________________yt__j_____k_yqn_____b____s___g_y_fh__c___dz____mxh_______w"
+    "_r_______dq_______________________gd_l_______y____x_t_y__cb_bp__zy_______y_cb___wz__jd__h_hl____x_t_"
+    "___dp________y________x___w________d_____h_____x_by_____jr_________zwm______z______y___k_____c___n__"
+    "___x_h_fhts___________z___n_zpb_____ls__d____j_xy_g____q___________z_______s_______l_h__k_h__s______"
+    "______h_x___he_dtg_xq__k__e_____n__y____q____x___h______h__________wy__h__y_n___x__m__b_____j___d___"
+    "_____q____jw_____h___t______x__wh_____djcc_b_cdgd__x__h__rx______c______yy_____y__________y____g____"
+    "f__k_______________________y________c___h_s__s___m____________m____hk_______w______k________________"
+    "___b__z_________________________h_____________________h___d_____x_a_______l___________________n_____"
+    "____________________________g_w_xsrxcwj___h_z_q_______________j___l____cd__h_______fsb_____s___s_cz_"
+    "_pbdr___t__k_______k__qz_k_synbcr__b__f__p__e_zcj___c____jb______ysz_tdkz_fp____klq_hb__p__pt____b__"
+    "_d___m__yc_m__f_zdcmnl__bpl_g_jtb_t_jz_zb__n__lj_ylnbz__ks_z_g_qs__k____pzsn_cg____z_a____k__t____w_"
+    "__zl_wtxnd_zjh__a_nc___z__________t__w____w__tk__z__bhsnj____b________ls_jhd___p______j_______cj___n"
+    "____x_d____dsd__z__tq_p___y_j_______l_tc_j_ktyc________l___zd_c______________r___z_mt_c___y_________"
+    "_w_c_____kj__j______y________l__cgl__j_________bc__cs_______s_g___________t_bd____________x__c______"
+    "s_byb_t_________s___z______________c_m______________mm________l__j_p_________cs__s________z_____c___"
+    "_l__qbc_z____n______h_____l__s_______cq___q___________s_______c_________________________p___________"
+    "______z_____r__________________j___z______s__g_g__fz_____g__x___d__m_j____a__j_l_bc___gs__d_____j___"
+    "s_q_z__f_______________w___zb____b_____d_l__x__z_w__jc_f_z___d_sx________f___s___p___l_____x___z____"
+    "___q________w_j__rdjzz__xx___h____sk__w_______a___k_____c_mh___yx__________xy____c_mz____z_s________"
+    "____z_x____h_______js_____sx_y____w_________w_h_c_____pjx___q_j___z___l___z____x_________s____na____"
+    "__________________m_____b____________________________________s___p__________________y_qyg____c__m_zt"
+    "z_______yy_p_f______s__l___w_c_q________m_wmbz_s_z__pd____j__x__s_zq__g__s____lxcc____z_____d__sgt__"
+    "_l__y____h_bj_____________sb_j__g____w______x____z_l__m_gz____sz______qf___k______jj____________b___"
+    "_______bmgqrr_______g_z_n____c______j__k_z_lc__________s_____z_bz__d___l_s_s__ql_________x________z_"
+    "___________yhg__gz____gt_wk_a___z___ts_hj______________d_q__jz____________t__________l___mb_________"
+    "_______g__________s___mwl____s_tx__s____________j________m_q_g____b__z__j_p_____t_____________s__l__"
+    "_k____g__________y_______zz___j__________________________t__y____________c_c____________________x___"
+    "__c___l________________________k____l_____g___y_____________l_______b___________z___________l__q____"
+    "____________________h__________j_________________________________c____________f____________________z"
+    "_m________h______y_____________________q_________________c_______x_______________c______________t___"
+    "x_______________________________________m___________________________________________________________"
+    "________________________________________________________qchx___o__________y_______q___k________x_q__"
+    "g_____________________zzcbwq__w______________d_sj______y__d__xsc__________z_________________________"
+    "____od_y_______d_h___y_____w_m_m__d_bbbp_b_m_____z_________h___t_______________________________s_m_m"
+    "q_n____f___f__q___hya_____dlq___s___y_______tzq____h_h______x____s_h___x_rgjcw__t_____w_____t_j_____"
+    "_x___qf__qyw____sc_____q_________s_p___g_m__ollc__hm__j____h____fy_zzgzy____xq___qb_m________f_____f"
+    "__n__pbq_n__z_l_____t__y_b_____xpz___j_________y______s____x___l__d______j____h______ez________hwqp_"
+    "_l___qjj__zc__j__h_n_____zj___________p__hl___f_____y__hj_________t__n__xs__y_x______t_____t_l_l_w_h"
+    "d_rjzsf____y__y__h__h_______d___z_x____lt____s____n_t________d__y______yc_h__s_c___h_y_t_________q__"
+    "__y__z__j___y__s_____y__qd_zb____w___w_g____k___y_m________p_________t________h_x__z________________"
+    "__________________ws___k_j___g______y___________l_____y_______x____s______r___n______c_____d___z____"
+    "_h_zt_____g___z__m__lll_bt__________d_____________p___q________l___ly___________m__________m_____s_z"
+    "__________y______________w__________p___q_l_______l______tc_____________________c___c_____p_________"
+    "____l____z_________________a____________j_________________b_________________________________________"
+    "_____________________p__________________________________________________________g___________________"
+    "___________h_m_dh____lz_j___z_zc_________lc___y___c_qk___z__________________jtpj___b____zd__lc___slt"
+    "____l_______________hl_z___y____k_fs_h_tjr_x_______w_p___f___________yh__________h___bf___________j_"
+    "________y_____r_____________________h_j_______________s_____m__z______z______________s______x_____x_"
+    "___x____r____x_____s____________a______________________r__________l______y_______________z__________"
+    "______________________b___________________________________z_p____a___jfybd___s_________pb___p_______"
+    "_____y_n___m_ml____m_w________s__q___tx_____xl________d_________________________________q__f______z_"
+    "_y________k_d___b_______h______g_j____n_hj__________dxs_zy______l___l_________________l_______c____m"
+    "c____________xzm__x_____h_________hy_____________________________________________t__________________"
+    "____x__l_y_w__________j____m_____________w_m___hx_l________b______________s__z__f_______________z___"
+    "_________b_____________________q_ll__l______s_________________z________________lqpp_____q___________"
+    "__________________h___rs________________g_____y____________l________________________________________"
+    "________________________________________________g_____pbr_w_______w_______pc____________z___________"
+    "________g_s_t__s_____s__ys_f_b__tyjs_d_nd__h_________c______j__w____p____l__x________lq___f_________"
+    "c___j_____________j________s_y_____l_gj____n_y__bj_____y__cf__p__c___z__tjj______b_zyjq_______y_zh__"
+    "d__t__p___l_______h_____t___c____b_______c_____________________________w____l_s__dbt________z___q___"
+    "________________a______________________x____________________g__d_bb___z_d_jh___g_____a____w_________"
+    "______________p__z_____________m__y__zp_y_y___azyjh_k_gdp__s___m______________md__m_z___x___p_d__s__"
+    "_____m_k___________________zm_______zx_____m______kj__t_y___zz_________________________j_____s_d__m_"
+    "___jc____________d__________mc________x___m__________________p_q_zd_s______t_______z________________"
+    "___________c___m______sy_z___j_j_da____s_________xfk_ms_________qk____p_y_z___y____________z________"
+    "p___p__sz_____l_c____g____________x__s_______x_____________ly_q________j____p____________d__las__b__"
+    "___wd______d_______b________pj_tc_________n__c___b____lc____p____k__________________m______________l"
+    "__h______j________________________________________________________s_l_s__q______q_____________z_____"
+    "_zss_____x__p____j_________dh________j__l__________f_________________________________________y_l_qh_"
+    "xs_t__g__b_q_z___km_____m______z____c_qy_z_____jc_______j__y_h__x__________c_ss________b__z_____c___"
+    "_______________w_______djj_g______m________________s____________________________x_jq__k____c_t_qz___"
+    "_____q___yz___jcj___cw_k_____k_________________________l___________l__________s__z____jjz__j_t______"
+    "_j_d_________z_____g______b____s_____x__b______d__________f_b___d_____________j_l____________d_j___f"
+    "kzt_d_c____s___________________________k_c____q_j____________g______bj_s_________g_______l___j___x__"
+    "__________________zp___________l_____g_______c____________l__l_____p_______________c________________"
+    "_______________h_______________________b_____________j_____________________________________m_______l"
+    "_z___________f________l__p_cz______s____yz____f___l__l_j_____c____j___________h__________gt__c__m__z"
+    "k______________n___________x______________w_____________________s_s____j___z___l____________________"
+    "__________________________________________x_________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "_____________________________________________________f______________________________________________"
+    "__________________z_____________________________j_h_x_yj__jrw__c_sgn_zlfzwf__n_x___lzsxzz_b__syj_brj"
+    "_r__hgx_ljjt__jx_stj_jx__x__c__swm_bc___zz_lz___jml__j____d____hdlb_y_f__f__c_______ys____s_____j___"
+    "g_q_____________________gw___h_l__f_______b______zz___z___s_______________________y_q_m_____g_____l_"
+    "__x__x__q____________________g___y___w___c______y_______x___q______dc_______________ha_________fy___"
+    "yl_k_z______es__n____g_hyb________________p________e__y_s__c_d_g__n_______llz_______l___p_j_________"
+    "______c________________________sy_sz_r_lj_________x_z_dg_g__cgz_ff___jf___ak__y_______f___szzx_w__d_"
+    "____b_t_______p___p_s_b__h_____________ky__g__j_x_a__n____z___c__mj____zqn_n__b___j_________________"
+    "___f_t______l_____p_______t___ly____ff__qw_______________x________s_y________fxn__ttb_________b____g"
+    "________b__tmx__________p__________s____________t_by__y____________________________c______z__c_____z"
+    "z______zj___y____jy_____ss____s_t_______s_wz__________h_b___jc___dbx_c_____________t________________"
+    "s______________________lj_sy______y___a___j________y_s____m_________wz_______jl_____fb_x_h_f_____q__"
+    "_y_________w_____c_s_y__t__m___k__bg_____rk____s___b_y_______p_______zmfqm________j_________________"
+    "_______jc__mc________yc_rr____________j__c______j_h_l_____j______d_rh__y___y___y_______h____________"
+    "__p__l____s____________________________m_____ll____h_y___m_________g__j_j__h____________c___b_______"
+    "_p_______lf_________________t_______mpw______________l______yy_xs____________________l______________"
+    "___________z___g_____p_d_______hz____c___k____________d________j_____________m__s___________________"
+    "__p_____z___________x____r_______s____b______l_j____________p____________________________________m_m"
+    "___z__w______c_________ns__________q____ab___________jr_________________________________________y___"
+    "______l_____b______________________x______________x____s_________________________j_____cm____o______"
+    "________t____f_________________z_____________________m______________________________________z_______"
+    "______________hlnl________x___y____________c_____s_______h___sx_sym_______w_b________c______y_______"
+    "z___________________________z_____qs__gd________h____w_z________g_________m_z________y____e_s_f_____"
+    "__________y__t_wz___m____l_____________________________________y_c____x________h____________________"
+    "________h_d______________________r_________________m__________________________l_____________________"
+    "_________________________________________x___________________________r____________c_________________"
+    "____________x____x______xy______x__j_y_______h_y_b__b__sc___s______z_________y__a______d_p____t___x_"
+    "____w______________b_x___f_______________cl__z______________yy___q__________k______________sp___lg__"
+    "______g_____________h_b__________________r____t_________________________x__________________________j"
+    "_______________________________x_y____f__________________________________________________________jg_"
+    "gms_lj________j________________j__c_________________________y_______________________________________"
+    "_________________________________________________________________________________z_______________yt_"
+    "_______s____________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "__________________j_____p____________________________________________________jdfrj__tr_q_xyxj_jh__y_"
+    "xel_sfsfjz__pzs_zsz_zc___y___s_s__cz_hd__gxy_gxc___jwy_w_yh_ss_qz_nd_fk__s_d_lz_t_ym_dh_x__w___c__y_"
+    "m_____xyb_q_jm__mt__lp__q__g_________h____d_____w____________________xh_______hy_____________bc_____"
+    "_________h__m_______________________________________________________________________________________"
+    "_________________________________________________________bzf_gczxbzhzftpbgzgej__tg_dmfh_z_jh_llzz___"
+    "__sfd_ssc___p_l_z_zs__z_zsygc_s____h____z___fzgq_________c___c____yq___________________t___q________"
+    "_______zp_________z____y_______bd____p___________j_g________k_g____l___t_j____d_______________y_c__t"
+    "______________j___t______cz_________________________t___d__t__________________________b_____dc____d_"
+    "___________c_z_____c___________________________________sg__q__d_______t_____________________________"
+    "____________________________________________________________________________________________________"
+    "__________________________________________czgx__z_lrh___z______q_z_j___j_fl_bhg_____fj_s_yxz_z_xg_cb"
+    "___l____bb_b____cr_______b___ld__qy_qx_gm_____y_yj__f___hz_jywlc__t_______dp_d__s______mbj___z__tsst"
+    "__n__xx____tz_d_t__d__tg_scsz_f___________d_________y__lb_y__ds____y_____b_e___d___y___________q_y__"
+    "_____zz______z_________by________________y_d______________xn__b___x___yh_q___s___z_l_____y________j_"
+    "__l__z___________h___j_____yb____g______c___d____d____e______________________b______________________"
+    "_________________________y_qzp____j____x__f__yt____h_s____l_c_t__j___jmks______n_______c_z_c______x_"
+    "______mq___________________________________________c_ys_lzyl_j__________f___________________________"
+    "____________________________________________________________________________________________________"
+    "________________________j___________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "________________________________________________________zd____q___fd_____g___dcznbg__yqjwg____n__q_q"
+    "_b_____z__j_ytbl_qm_____________________tl___z_x________gm__jyc___y_z_p___l_xs__cg__x__fx___rt_____z"
+    "_cm______x_lczj_x____djjm________q_d____dm_____z__n__n__gb__________j______l_________l__l_____x_____"
+    "___c________________________________________________________________________________________________"
+    "________m_s__bwcr_x_j__mzngw_m__fgh__y___y____y_cl__k_______f__d______________r___fyyzj____z___at___"
+    "fjllc__lmj__x____s_____b_____dy_c___yxp__________ltx_____________yl____s___sy___g___ax__z__________s"
+    "______________l_______n_qy__xyjg____cy_c_____d__________________y_x___________ll_b____w_x___x__z_m__"
+    "_h_____n__l_____s_x___________________l_____bp________________________q___j__j_d__f_kmm______g______"
+    "___jx_b____________________x_a__________q_______j____________b______________________________________"
+    "__________________wr_h___j_____y_ys_________________________________________________________________"
+    "_____________________________________________________________ydq_xsx_wgd_bs_yllpj_j_____yp_t__ykt___"
+    "ye__d___c__q______________________________________f_________p_____fs________________________________"
+    "________________c___________________________________________________________________________________"
+    "_j_______fyjsbs__er___j_b__e_n___xg_k__c___l__m___s__x______________________________________________"
+    "____________________________________________________________________________________________________"
+    "________________________________________________________________mytxcq_bl_s__j_zt_j___m_j_lh___cy__j"
+    "_q_____p__s______l__z___g_______________h__________________________s____g___________________________"
+    "_______________z________________________________________________________g____kh_p__________w____m___"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________y____l__"
+    "_________b______________x_______l___________________j__________s__________________b_______l_________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "____________________________________________________________________________________________________"
+    "___________n_j_m_oy______y_y___y_t_______g_h___j_e____q____p____________________h___________y_______"
+    "_______l___________________l__________________m____________________m________h________sl__h__q___m___"
+    "__________________________________________________d____g____________s__________________________b____"
+    "________________q______________________________________________c____l______q_____________lg____g____"
+    "__";
+
+static_assert(sizeof(INITIALS) - 1 == LAST_HANZI - FIRST_HANZI + 1, "pinyin table size");
+
+} // namespace
+
+QChar pinyinInitial(QChar c)
+{
+    const char16_t u = c.unicode();
+    if (u < FIRST_HANZI || u > LAST_HANZI) return QChar();
+    const char letter = INITIALS[u - FIRST_HANZI];
+    return letter == '_' ? QChar() : QChar(letter);
+}
+
+QString pinyinInitials(const QString& s)
+{
+    QString out;
+    out.reserve(s.size());
+    for (QChar c : s) {
+        if (c.unicode() < 0x80) {
+            if (c.isLetterOrNumber()) out += c.toLower();
+        } else if (const QChar initial = pinyinInitial(c); !initial.isNull()) {
+            out += initial;
+        } else if (c.isLetterOrNumber()) {
+            out += c;
+        }
+    }
+    return out;
+}
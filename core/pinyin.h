@@ -0,0 +1,15 @@
+#ifndef PINYIN_H
+#define PINYIN_H
+
+#include <QString>
+#include <QChar>
+
+// 汉字 -> 拼音首字母（小写）。覆盖 GB2312 一级汉字（3755 个常用字），
+// 多音字取 GB2312 排序所依据的读音；其他字符返回空 QChar
+QChar pinyinInitial(QChar c);
+
+// 站名的拼音首字母串：汉字取首字母，字母与数字转成小写保留，
+// 查不到首字母的汉字原样保留，其余字符（空格、括号等）略去。例如 “中央广场” -> “zygc”
+QString pinyinInitials(const QString& s);
+
+#endif // PINYIN_H
@@ -0,0 +1,387 @@
+#include "planrenderer.h"
+#include <QMutexLocker>
+#include <QTime>
+
+namespace {
+constexpr int MAX_CACHED_FRAGMENTS = 16384;     // 超过后整体清空，防止大网络上无限增长
+
+const QString DIRECT_CARD = QStringLiteral(
+    "<div style=\"margin: 16px 0; padding: 16px; border-radius: 8px; background: #1E1E1E; border-bottom: 1px solid #333333; box-shadow: 0 2px 4px rgba(0,0,0,0.3);\">"
+    "<div style=\"display: inline-block; width: 4px; height: 100%; background: #10B981; margin-left: -12px; margin-right: 12px; vertical-align: top;\"></div>"
+    "<div style=\"display: inline-block; width: calc(100% - 16px);\">"
+    "<h3 style=\"margin: 0 0 8px 0; color: #00A65B;\">🚌 直达 <span style=\"color: #00A65B; font-weight: bold;\">%1</span></h3>"
+    "<p>从 <b>%2</b> 到 <b>%3</b>（共 <b>%4</b> 站）（约 %5 分钟）</p>"
+    "<div style=\"margin: 6px 0 0 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">%6</div>"
+    "<div style=\"margin-top: 6px; color: #A0A0A0; font-size: 13px;\">🕒 %7</div>"
+    "</div></div>");
+
+// 换乘卡片拆成头部 / 每段 / 段间分隔 / 尾部，依次直接写入输出缓冲
+const QString TRANSFER_HEAD = QStringLiteral(
+    "<div style=\"margin: 16px 0; padding: 16px; border-radius: 8px; background: #1E1E1E; border-bottom: 1px solid #333333; box-shadow: 0 2px 4px rgba(0,0,0,0.3);\">"
+    "<div style=\"display: inline-block; width: 4px; height: 100%; background: %1; margin-left: -12px; margin-right: 12px; vertical-align: top;\"></div>"
+    "<div style=\"display: inline-block; width: calc(100% - 16px);\">"
+    "<h3 style=\"margin: 0 0 8px 0; color: %2;\">🔄 %3 ------------------------------------------------------------------------------------------</h3>"
+    "<p>从 <b>%4</b> 到 <b>%5</b>（约 %6 分钟，含换乘）</p>");
+const QString TRANSFER_SEGMENT = QStringLiteral(
+    "<div style=\"margin: 8px 0; padding: 6px 10px; background: #252526; border-radius: 4px;\">"
+    "<b>第%1段</b>：乘坐 <span style=\"color: %2; font-weight: bold;\">%3</span>（%4 站）<br>%5"
+    "</div>");
+const QString TRANSFER_SEPARATOR = QStringLiteral(
+    "<div style=\"text-align: center; margin: 4px 0; color: #3B82F6;\">↓ 在 <b>%1</b> 换乘（步行约3分钟）↓</div>");
+const QString TRANSFER_SERVICE_OPEN = QStringLiteral(
+    "<div style=\"font-size: 13px; color: #A0A0A0; margin-top: 6px;\">");
+const QString CARD_CLOSE = QStringLiteral("</div></div></div>");
+
+quint64 legKey(const JourneyLeg& leg)
+{
+    return (quint64(leg.route) << 40) | (quint64(leg.fromPos) << 20) | quint64(leg.toPos);
+}
+}
+
+PlanRenderer::Template::Template(const QString& pattern)
+{
+    QString literal;
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '%' && i + 1 < pattern.size() && pattern[i + 1] >= '1' && pattern[i + 1] <= '9') {
+            literals.append(literal);
+            literal.clear();
+            argIndex.append(pattern[i + 1].unicode() - '1');
+            ++i;
+        } else {
+            literal += c;
+        }
+    }
+    literals.append(literal);
+}
+
+void PlanRenderer::Template::render(QString& out, std::initializer_list<QStringView> args) const
+{
+    const QStringView* a = args.begin();
+    for (int i = 0; i < argIndex.size(); ++i) {
+        out += literals[i];
+        out += a[argIndex[i]];
+    }
+    out += literals.last();
+}
+
+PlanRenderer::PlanRenderer(Format format)
+    : fmt(format)
+{
+    if (fmt == Html) {
+        directCard = Template(DIRECT_CARD);
+        transferCard = Template(TRANSFER_HEAD);
+        transferSegment = Template(TRANSFER_SEGMENT);
+        transferSeparator = Template(TRANSFER_SEPARATOR);
+    }
+}
+
+QString PlanRenderer::clockText(int minutes)
+{
+    const QString hm = QTime(0, 0).addSecs((minutes % 1440) * 60).toString("HH:mm");
+    return minutes >= 1440 ? "次日 " + hm : hm;
+}
+
+void PlanRenderer::appendJsonString(QString& out, QStringView s)
+{
+    out += '"';
+    for (QChar c : s) {
+        switch (c.unicode()) {
+        case '"':  out += QLatin1String("\\\""); break;
+        case '\\': out += QLatin1String("\\\\"); break;
+        case '\n': out += QLatin1String("\\n"); break;
+        case '\r': out += QLatin1String("\\r"); break;
+        case '\t': out += QLatin1String("\\t"); break;
+        default:
+            if (c.unicode() < 0x20)
+                out += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+            else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+int PlanRenderer::cachedFragments() const
+{
+    QMutexLocker locker(&cacheLock);
+    return legCache.size();
+}
+
+PlanRenderer::LegFragment PlanRenderer::buildFragment(const BusNetwork& network, const JourneyLeg& leg) const
+{
+    const RouteView rv = network.route(leg.route);
+    const int step = leg.fromPos < leg.toPos ? 1 : -1;
+
+    LegFragment f;
+    f.stops = qAbs(leg.toPos - leg.fromPos) + 1;
+    f.firstBus = rv.firstBus().toString("HH:mm");
+    f.lastBus = rv.lastBus().toString("HH:mm");
+
+    switch (fmt) {
+    case Html:
+        // 按位置顺序拼接经过的站点，并在相邻站之间标注耗时
+        for (int p = leg.fromPos; ; p += step) {
+            f.path += network.stopName(rv.stopAt(p));
+            if (p == leg.toPos) break;
+            f.path += QString(" <span style=\"color:#666;\">↓ %1分钟</span> → ").arg(rv.travelTime(p, p + step));
+        }
+        break;
+    case Text:
+        for (int p = leg.fromPos; ; p += step) {
+            f.path += network.stopName(rv.stopAt(p));
+            if (p == leg.toPos) break;
+            f.path += QStringLiteral(" → ");
+        }
+        break;
+    case Json:
+        f.path += QLatin1String("{\"route\":");
+        appendJsonString(f.path, rv.id());
+        f.path += QLatin1String(",\"name\":");
+        appendJsonString(f.path, rv.name());
+        f.path += QLatin1String(",\"from\":");
+        appendJsonString(f.path, network.stopName(rv.stopAt(leg.fromPos)));
+        f.path += QLatin1String(",\"to\":");
+        appendJsonString(f.path, network.stopName(rv.stopAt(leg.toPos)));
+        f.path += QString(",\"stops\":%1,\"minutes\":%2").arg(f.stops).arg(rv.travelTime(leg.fromPos, leg.toPos));
+        break;
+    }
+    return f;
+}
+
+PlanRenderer::LegFragment PlanRenderer::legFragment(const BusNetwork& network, const JourneyLeg& leg)
+{
+    const quint64 key = legKey(leg);
+    {
+        QMutexLocker locker(&cacheLock);
+        if (cacheVersion != network.version()) {
+            legCache.clear();
+            cacheVersion = network.version();
+        }
+        auto it = legCache.constFind(key);
+        if (it != legCache.constEnd()) return *it;
+    }
+
+    // 拼接在锁外进行；期间网络版本若已变化就不再写入
+    LegFragment f = buildFragment(network, leg);
+    QMutexLocker locker(&cacheLock);
+    if (cacheVersion == network.version()) {
+        if (legCache.size() >= MAX_CACHED_FRAGMENTS) legCache.clear();
+        legCache.insert(key, f);
+    }
+    return f;
+}
+
+void PlanRenderer::renderHtml(QString& out, const BusNetwork& network, const Journey& j,
+                              const QString& start, const QString& end)
+{
+    const QString total = QString::number(j.totalMinutes);
+
+    if (j.legs.size() == 1) {
+        const JourneyLeg& leg = j.legs.first();
+        const LegFragment f = legFragment(network, leg);
+        const QString service = leg.depart >= 0
+                                    ? QString("%1 上车 &nbsp; %2 到达").arg(clockText(leg.depart), clockText(leg.arrive))
+                                    : QString("首班 %1 &nbsp; 末班 %2").arg(f.firstBus, f.lastBus);
+        directCard.render(out, { network.route(leg.route).name(), start, end,
+                                 QString::number(f.stops), total, f.path, service });
+        return;
+    }
+
+    // 一次换乘沿用蓝色配色，两次及以上沿用“两次换乘”的紫色配色
+    const int transfers = j.transfers();
+    const QStringView bar = transfers == 1 ? u"#3B82F6" : u"#8B5CF6";
+    const QStringView accent = transfers == 1 ? u"#4F46E5" : u"#E56C4F";
+    const QString title = transfers == 1 ? QString("一次换乘") : transfers == 2 ? QString("两次换乘")
+                                                                              : QString("%1次换乘").arg(transfers);
+    transferCard.render(out, { bar, accent, title, start, end, total });
+
+    QString service;
+    for (int i = 0; i < j.legs.size(); ++i) {
+        const JourneyLeg& leg = j.legs[i];
+        const RouteView r = network.route(leg.route);
+        const LegFragment f = legFragment(network, leg);
+        const QString index = QString::number(i + 1);
+        if (i > 0) {
+            transferSeparator.render(out, { network.stopName(r.stopAt(leg.fromPos)) });
+            service += QLatin1String("<br>");
+        }
+        transferSegment.render(out, { index, accent, r.name(), QString::number(f.stops), f.path });
+
+        service += QString("第%1段（%2）：").arg(index, r.name());
+        service += leg.depart >= 0 ? QString("%1 上车 %2 下车").arg(clockText(leg.depart), clockText(leg.arrive))
+                                   : QString("首班 %1 末班 %2").arg(f.firstBus, f.lastBus);
+    }
+    out += TRANSFER_SERVICE_OPEN;
+    out += service;
+    out += CARD_CLOSE;
+}
+
+void PlanRenderer::renderText(QString& out, const BusNetwork& network, const Journey& j, int index)
+{
+    out += QString("方案%1：约 %2 分钟，换乘 %3 次\n").arg(index).arg(j.totalMinutes).arg(j.transfers());
+    for (const JourneyLeg& leg : j.legs) {
+        const LegFragment f = legFragment(network, leg);
+        out += QLatin1String("  ");
+        if (leg.depart >= 0) out += clockText(leg.depart) + "-" + clockText(leg.arrive) + " ";
+        out += network.route(leg.route).name();
+        out += QString("：%1（%2 站）\n").arg(f.path).arg(f.stops);
+    }
+}
+
+void PlanRenderer::renderJson(QString& out, const BusNetwork& network, const Journey& j)
+{
+    out += QString("{\"minutes\":%1,\"transfers\":%2,\"legs\":[").arg(j.totalMinutes).arg(j.transfers());
+    for (int i = 0; i < j.legs.size(); ++i) {
+        const JourneyLeg& leg = j.legs[i];
+        if (i > 0) out += ',';
+        out += legFragment(network, leg).path;
+        if (leg.depart >= 0) {
+            out += QLatin1String(",\"depart\":");
+            appendJsonString(out, clockText(leg.depart));
+            out += QLatin1String(",\"arrive\":");
+            appendJsonString(out, clockText(leg.arrive));
+        }
+        out += '}';
+    }
+    out += QLatin1String("]}");
+}
+
+void PlanRenderer::renderJourney(QString& out, const BusNetwork& network, const Journey& j,
+                                 const QString& start, const QString& end, int index)
+{
+    switch (fmt) {
+    case Html: renderHtml(out, network, j, start, end); break;
+    case Text: renderText(out, network, j, index); break;
+    case Json: renderJson(out, network, j); break;
+    }
+}
+
+void PlanRenderer::renderPlans(QString& out, const BusNetwork& network, const QVector<Journey>& journeys,
+                               const QString& start, const QString& end)
+{
+    // 一张卡片的字面量部分约 1KB，再加上站点路径；一次预留，避免逐段扩容
+    out.reserve(out.size() + journeys.size() * (fmt == Html ? 2048 : 256));
+    if (fmt == Json) out += '[';
+    for (int i = 0; i < journeys.size(); ++i) {
+        if (fmt == Json && i > 0) out += ',';
+        renderJourney(out, network, journeys[i], start, end, i + 1);
+    }
+    if (fmt == Json) out += ']';
+}
+
+void PlanRenderer::renderRoute(QString& out, const Route& r) const
+{
+    int totalTime = 0;
+    for (int t : r.travelTimes) totalTime += t;
+
+    switch (fmt) {
+    case Html:
+        out += QString("<h3>🚍 %1 (%2)</h3>"
+                       "<p style=\"color: #A0A0A0;\">全程共 %3 站 （全程约 <b>%4 分钟</b>）</p>"
+                       "<p style=\"color: #A0A0A0; margin-top: 4px;\">🕒 首班 <b>%5</b> &nbsp; 末班 <b>%6</b></p>")
+                   .arg(r.name, r.id, QString::number(r.stops.size()), QString::number(totalTime),
+                        r.firstBus.toString("HH:mm"), r.lastBus.toString("HH:mm"));
+        out += QLatin1String("<ul style=\"padding-left: 20px; margin: 8px 0;\">");
+        for (int i = 0; i < r.stops.size(); ++i) {
+            out += QLatin1String("<li>");
+            out += r.stops[i];
+            if (i < r.travelTimes.size())
+                out += QString(" <span style=\"color:#666;\">↓ %1分钟</span>").arg(r.travelTimes[i]);
+            out += QLatin1String("</li>");
+        }
+        out += QLatin1String("</ul>");
+        break;
+    case Text:
+        out += QString("%1 (%2)\n全程共 %3 站，约 %4 分钟，首班 %5 末班 %6\n")
+                   .arg(r.name, r.id, QString::number(r.stops.size()), QString::number(totalTime),
+                        r.firstBus.toString("HH:mm"), r.lastBus.toString("HH:mm"));
+        for (int i = 0; i < r.stops.size(); ++i) {
+            out += QLatin1String("  ") + r.stops[i];
+            if (i < r.travelTimes.size()) out += QString("  ↓ %1分钟").arg(r.travelTimes[i]);
+            out += '\n';
+        }
+        break;
+    case Json:
+        out += QLatin1String("{\"id\":");
+        appendJsonString(out, r.id);
+        out += QLatin1String(",\"name\":");
+        appendJsonString(out, r.name);
+        out += QLatin1String(",\"stops\":[");
+        for (int i = 0; i < r.stops.size(); ++i) {
+            if (i > 0) out += ',';
+            appendJsonString(out, r.stops[i]);
+        }
+        out += QLatin1String("],\"travelTimes\":[");
+        for (int i = 0; i < r.travelTimes.size(); ++i) {
+            if (i > 0) out += ',';
+            out += QString::number(r.travelTimes[i]);
+        }
+        out += QString("],\"totalMinutes\":%1,\"firstBus\":\"%2\",\"lastBus\":\"%3\"}")
+                   .arg(QString::number(totalTime), r.firstBus.toString("HH:mm"), r.lastBus.toString("HH:mm"));
+        break;
+    }
+}
+
+void PlanRenderer::renderConnections(QString& out, const BusNetwork& network, int route) const
+{
+    // 换乘记录按对方线路连成一段段，每段对应一条可换乘线路
+    const TransferRange<TransferLink> links = network.transfers().links(route);
+    QVector<TransferRange<TransferLink>> peers;
+    for (const TransferLink* it = links.begin(); it != links.end(); ++it) {
+        if (peers.isEmpty() || peers.last().first->route != it->route) peers.append(TransferRange<TransferLink>{ it, it });
+        peers.last().last = it + 1;
+    }
+    auto stopsOf = [&](const TransferRange<TransferLink>& run, const QString& separator) {
+        QString stops;
+        for (const TransferLink& p : run) {
+            if (!stops.isEmpty()) stops += separator;
+            stops += network.stopName(p.stop);
+        }
+        return stops;
+    };
+
+    switch (fmt) {
+    case Html:
+        if (peers.isEmpty()) {
+            out += QStringLiteral("<p style=\"color: #A0A0A0;\">🔁 本线路没有可换乘的线路</p>");
+            break;
+        }
+        out += QString("<p style=\"color: #A0A0A0; margin-top: 12px;\">🔁 可换乘线路 %1 条</p>").arg(peers.size());
+        out += QLatin1String("<ul style=\"padding-left: 20px; margin: 8px 0;\">");
+        for (const auto& run : std::as_const(peers)) {
+            const RouteView other = network.route(int(run.first->route));
+            out += QString("<li><b>%1</b> <span style=\"color:#666;\">(%2)</span>：%3</li>")
+                       .arg(other.name(), other.id(), stopsOf(run, QStringLiteral("、")));
+        }
+        out += QLatin1String("</ul>");
+        break;
+    case Text:
+        out += QString("可换乘线路 %1 条\n").arg(peers.size());
+        for (const auto& run : std::as_const(peers)) {
+            const RouteView other = network.route(int(run.first->route));
+            out += QString("  %1 (%2)：%3\n").arg(other.name(), other.id(), stopsOf(run, QStringLiteral("、")));
+        }
+        break;
+    case Json:
+        out += '[';
+        for (qsizetype i = 0; i < peers.size(); ++i) {
+            if (i > 0) out += ',';
+            const RouteView other = network.route(int(peers[i].first->route));
+            out += QLatin1String("{\"id\":");
+            appendJsonString(out, other.id());
+            out += QLatin1String(",\"name\":");
+            appendJsonString(out, other.name());
+            out += QLatin1String(",\"stops\":[");
+            bool first = true;
+            for (const TransferLink& p : peers[i]) {
+                if (!first) out += ',';
+                first = false;
+                appendJsonString(out, network.stopName(p.stop));
+            }
+            out += QLatin1String("]}");
+        }
+        out += ']';
+        break;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef PLANRENDERER_H
+#define PLANRENDERER_H
+
+#include "network.h"
+#include "journey.h"
+#include <QVector>
+#include <QString>
+#include <QStringView>
+#include <QHash>
+#include <QMutex>
+#include <initializer_list>
+
+// 方案 / 线路详情的输出：Html 给图形界面的卡片，Text 给命令行，Json 给程序调用方。
+// 卡片外框使用预先编译好的模板（字面量片段 + 参数槽），直接追加到调用方的缓冲区里，
+// 不再对整段带样式的 HTML 反复做 QString::arg 拷贝。
+// 每一段乘车的片段（经过站点、耗时、首末班）按 (线路, 上车位置, 下车位置) 缓存，
+// 网络版本变化时整体失效。缓存加锁，同一个渲染器可以在多个线程间共用。
+class PlanRenderer
+{
+public:
+    enum Format { Html, Text, Json };
+
+    explicit PlanRenderer(Format format = Html);
+
+    Format format() const { return fmt; }
+
+    // 追加方案列表：Html 为依次排列的卡片，Text 为编号的方案，Json 为方案对象组成的数组
+    void renderPlans(QString& out, const BusNetwork& network, const QVector<Journey>& journeys,
+                     const QString& start, const QString& end);
+    void renderJourney(QString& out, const BusNetwork& network, const Journey& j,
+                       const QString& start, const QString& end, int index = 1);
+    // 线路详情（站点列表、全程时间、首末班）
+    void renderRoute(QString& out, const Route& r) const;
+    // 可从线路 route 换乘的其他线路及各自的换乘站（取自线网的换乘图）
+    void renderConnections(QString& out, const BusNetwork& network, int route) const;
+
+    int cachedFragments() const;
+
+    // 当日零点起的分钟数 -> "HH:mm"，跨过零点的标注“次日”
+    static QString clockText(int minutes);
+    // 追加带引号、已转义的 JSON 字符串
+    static void appendJsonString(QString& out, QStringView s);
+
+private:
+    // 预编译模板：pattern 中的 %1..%9 为参数槽，其余为字面量
+    class Template
+    {
+    public:
+        Template() = default;
+        explicit Template(const QString& pattern);
+        void render(QString& out, std::initializer_list<QStringView> args) const;
+
+    private:
+        QVector<QString> literals;   // literals.size() == argIndex.size() + 1
+        QVector<int> argIndex;       // 第 i 个参数槽对应的参数下标
+    };
+
+    // 一段乘车与时刻无关的部分，按格式预先拼好
+    struct LegFragment {
+        QString path;       // Html：站点和区间耗时；Text：站名以箭头相连；Json：leg 对象去掉右花括号
+        QString firstBus;   // "HH:mm"
+        QString lastBus;
+        int stops = 0;
+    };
+
+    LegFragment legFragment(const BusNetwork& network, const JourneyLeg& leg);
+    LegFragment buildFragment(const BusNetwork& network, const JourneyLeg& leg) const;
+    void renderHtml(QString& out, const BusNetwork& network, const Journey& j,
+                    const QString& start, const QString& end);
+    void renderText(QString& out, const BusNetwork& network, const Journey& j, int index);
+    void renderJson(QString& out, const BusNetwork& network, const Journey& j);
+
+    Format fmt;
+    Template directCard;
+    Template transferCard;
+    Template transferSegment;
+    Template transferSeparator;
+
+    mutable QMutex cacheLock;
+    quint64 cacheVersion = 0;
+    QHash<quint64, LegFragment> legCache;
+};
+
+#endif // PLANRENDERER_H
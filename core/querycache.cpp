@@ -0,0 +1,208 @@
+#include "querycache.h"
+#include <QMutexLocker>
+#include <QPair>
+
+namespace {
+
+bool sameRoute(const Route& a, const Route& b)
+{
+    return a.name == b.name && a.stops == b.stops && a.travelTimes == b.travelTimes
+           && a.firstBus == b.firstBus && a.lastBus == b.lastBus;
+}
+
+void addStops(QSet<QString>& out, const Route& r)
+{
+    for (const QString& s : r.stops) out.insert(s);
+}
+
+// 首站起的累计分钟数；耗时数据无效（线路不可乘）时为空
+QVector<int> cumulative(const Route& r)
+{
+    QVector<int> minutes;
+    if (r.stops.isEmpty() || r.travelTimes.size() != r.stops.size() - 1) return minutes;
+    minutes.reserve(r.stops.size());
+    minutes.append(0);
+    for (int t : r.travelTimes) minutes.append(minutes.last() + t);
+    return minutes;
+}
+
+} // namespace
+
+QueryCache::QueryCache(int capacity)
+    : shardCapacity(qMax(1, (capacity + SHARDS - 1) / SHARDS))
+{
+}
+
+QString QueryCache::key(const QString& start, const QString& end, const QString& options)
+{
+    // 站名里不会出现的分隔符
+    return start + QChar(0x1F) + end + QChar(0x1F) + options;
+}
+
+quint64 QueryCache::generation() const
+{
+    return gen.loadAcquire();
+}
+
+bool QueryCache::lookup(const QString& key, QString& value)
+{
+    Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.lock);
+    const auto it = shard.index.constFind(key);
+    if (it == shard.index.cend()) {
+        ++shard.counters.misses;
+        return false;
+    }
+    shard.order.splice(shard.order.begin(), shard.order, it.value());
+    value = it.value()->value;
+    ++shard.counters.hits;
+    return true;
+}
+
+void QueryCache::insert(const QString& key, quint64 generation, const QString& value, const BusNetwork& network,
+                        const QString& start, const QString& end, const QVector<Journey>& journeys)
+{
+    Entry e;
+    e.key = key;
+    e.value = value;
+    e.start = start;
+    e.end = end;
+    e.empty = journeys.isEmpty();
+    for (const Journey& j : journeys)
+        for (const JourneyLeg& leg : j.legs)
+            e.routes.insert(network.route(leg.route).id());
+
+    Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.lock);
+    // 淘汰先换代数再逐个分片清理，这里在分片锁内比对，过期的结果不会漏过清理留下来
+    if (generation != gen.loadAcquire()) return;     // 查询期间线路已变，结果基于旧线网
+    const auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.order.erase(it.value());
+        shard.index.erase(it);
+        ++shard.counters.displaced;
+    } else if (shard.index.size() >= shardCapacity) {
+        shard.index.remove(shard.order.back().key);
+        shard.order.pop_back();
+        ++shard.counters.displaced;
+    }
+    shard.order.push_front(e);
+    shard.index.insert(key, shard.order.begin());
+}
+
+template <typename F>
+int QueryCache::sweep(Shard& shard, F doomed)
+{
+    int removed = 0;
+    for (auto it = shard.order.begin(); it != shard.order.end();) {
+        if (doomed(*it)) {
+            shard.index.remove(it->key);
+            it = shard.order.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    shard.counters.invalidated += removed;
+    return removed;
+}
+
+bool QueryCache::mayImprove(const Route* before, const Route* after)
+{
+    if (!after) return false;
+    const QVector<int> now = cumulative(*after);
+    if (now.isEmpty()) return false;
+    if (!before) return true;
+    const QVector<int> was = cumulative(*before);
+    if (was.isEmpty() || before->firstBus != after->firstBus || before->lastBus != after->lastBus) return true;
+
+    // 旧线路上任意两站之间的乘车时间（环线取最短的一对位置），新线路的每一对都不能更快
+    QHash<QPair<QString, QString>, int> oldLegs;
+    for (int p = 0; p < was.size(); ++p) {
+        for (int q = p + 1; q < was.size(); ++q) {
+            const auto key = qMakePair(qMin(before->stops[p], before->stops[q]), qMax(before->stops[p], before->stops[q]));
+            const auto it = oldLegs.find(key);
+            if (it == oldLegs.end() || was[q] - was[p] < *it) oldLegs.insert(key, was[q] - was[p]);
+        }
+    }
+    for (int p = 0; p < now.size(); ++p) {
+        for (int q = p + 1; q < now.size(); ++q) {
+            if (after->stops[p] == after->stops[q]) continue;
+            const auto key = qMakePair(qMin(after->stops[p], after->stops[q]), qMax(after->stops[p], after->stops[q]));
+            const auto it = oldLegs.constFind(key);
+            if (it == oldLegs.cend() || now[q] - now[p] < *it) return true;
+        }
+    }
+    return false;
+}
+
+int QueryCache::invalidate(const BusNetwork& before, const QVector<Route>& after)
+{
+    // 找出新增、删除或内容改动的线路，以及它们新旧版本经过的所有站点
+    QHash<QString, Route> old;
+    for (int i = 0; i < before.routeCount(); ++i) {
+        if (before.isVacant(i)) continue;
+        const RouteView rv = before.route(i);
+        old.insert(rv.id(), rv.toRoute());
+    }
+    QSet<QString> changed;
+    QSet<QString> touchedStops;
+    bool improved = false;
+    for (const Route& r : after) {
+        const bool existed = old.contains(r.id);
+        const Route prev = old.take(r.id);
+        if (existed && sameRoute(prev, r)) continue;
+        improved = improved || mayImprove(existed ? &prev : nullptr, &r);
+        changed.insert(r.id);
+        addStops(touchedStops, r);
+        if (existed) addStops(touchedStops, prev);
+    }
+    for (auto it = old.cbegin(); it != old.cend(); ++it) {     // 已删除
+        changed.insert(it.key());
+        addStops(touchedStops, it.value());
+    }
+    return invalidate(changed, touchedStops, improved);
+}
+
+int QueryCache::invalidate(const QSet<QString>& changed, const QSet<QString>& touchedStops, bool improved)
+{
+    gen.fetchAndAddOrdered(1);
+    if (improved) {
+        int removed = 0;
+        for (Shard& shard : shards) {
+            QMutexLocker locker(&shard.lock);
+            removed += sweep(shard, [](const Entry&) { return true; });
+        }
+        return removed;
+    }
+    if (changed.isEmpty()) return 0;
+
+    int removed = 0;
+    for (Shard& shard : shards) {
+        QMutexLocker locker(&shard.lock);
+        removed += sweep(shard, [&](const Entry& e) {
+            return e.empty || e.routes.intersects(changed) || touchedStops.contains(e.start)
+                   || touchedStops.contains(e.end);
+        });
+    }
+    return removed;
+}
+
+void QueryCache::clear()
+{
+    invalidate({}, {}, true);
+}
+
+QueryCacheStats QueryCache::stats() const
+{
+    QueryCacheStats s;
+    for (const Shard& shard : shards) {
+        QMutexLocker locker(&shard.lock);
+        s.hits += shard.counters.hits;
+        s.misses += shard.counters.misses;
+        s.invalidated += shard.counters.invalidated;
+        s.displaced += shard.counters.displaced;
+        s.size += int(shard.index.size());
+    }
+    return s;
+}
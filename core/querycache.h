@@ -0,0 +1,89 @@
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+#include "network.h"
+#include "journey.h"
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <QAtomicInteger>
+#include <array>
+#include <list>
+
+struct QueryCacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 invalidated = 0;    // 因线路变化被淘汰的条目
+    quint64 displaced = 0;      // 因容量不足被挤出（LRU）或被同键结果覆盖的条目
+    int size = 0;
+    double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+};
+
+// 查询结果的 LRU 缓存：键为 (起点, 终点, 查询选项)，值为已经渲染好的结果。
+// 每条结果记下它依赖的线路编号，即方案中乘坐的线路。
+// 线路变化可能带来更快的乘车（新增线路、区间变快、多出可直达的站对、运营时段变化）时整体清空，
+// 任何缓存的方案都可能因此不再最优；只会变慢的变化（删除、减速、减站）淘汰依赖了变化线路、
+// 或起终点被它经过的条目，以及没有找到方案的条目，其余条目的方案不用它，照样可乘且仍然最优。
+// 条目按键的哈希分到 SHARDS 个分片，各自加锁、各自按 LRU 挤出，多个查询线程很少争同一把锁；
+// 查找、写入与挤出都是 O(1)，与容量无关。淘汰与清空依次锁住各分片。
+class QueryCache
+{
+public:
+    static constexpr int SHARDS = 16;
+
+    // 容量按分片均分（向上取整）
+    explicit QueryCache(int capacity = 256);
+
+    static QString key(const QString& start, const QString& end, const QString& options);
+
+    // 每次 invalidate() 之后代数加一；查询开始时记下代数，写入时代数已变说明结果基于旧线网，丢弃
+    quint64 generation() const;
+
+    bool lookup(const QString& key, QString& value);
+    void insert(const QString& key, quint64 generation, const QString& value, const BusNetwork& network,
+                const QString& start, const QString& end, const QVector<Journey>& journeys);
+
+    // 比较重建前的线网与新的线路数据，淘汰受影响的条目；返回淘汰的条数
+    int invalidate(const BusNetwork& before, const QVector<Route>& after);
+    // 已知变化的线路编号及其新旧版本经过的站点时直接按它们淘汰（单条线路的增删改）；
+    // improved 为 mayImprove() 的结果，为 true 时整体清空
+    int invalidate(const QSet<QString>& routeIds, const QSet<QString>& stops, bool improved);
+    void clear();
+
+    // after 能否提供 before 没有的更快乘车。before 为空表示新增，after 为空表示删除
+    static bool mayImprove(const Route* before, const Route* after);
+
+    QueryCacheStats stats() const;
+
+private:
+    struct Entry {
+        QString key;
+        QString value;
+        QSet<QString> routes;       // 依赖的线路编号
+        QString start;
+        QString end;
+        bool empty = false;         // 没有找到任何方案
+    };
+    using EntryList = std::list<Entry>;
+
+    // 链表按最近使用排序（表头最新），哈希表从键找到链表节点；命中时把节点移到表头，满了挤出表尾
+    struct Shard {
+        mutable QMutex lock;
+        EntryList order;
+        QHash<QString, EntryList::iterator> index;
+        QueryCacheStats counters;
+    };
+
+    Shard& shardFor(const QString& key) { return shards[qHash(key) % SHARDS]; }
+    // 在 shard 已加锁时调用：淘汰满足 doomed 的条目，返回条数
+    template <typename F>
+    static int sweep(Shard& shard, F doomed);
+
+    std::array<Shard, SHARDS> shards;
+    int shardCapacity;
+    QAtomicInteger<quint64> gen;
+};
+
+#endif // QUERYCACHE_H
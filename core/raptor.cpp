@@ -0,0 +1,185 @@
+#include "raptor.h"
+#include <climits>
+
+namespace {
+constexpr int INF = INT_MAX / 2;
+}
+
+RaptorPlanner::RaptorPlanner(const BusNetwork& network)
+    : net(network)
+{
+}
+
+// 网络重建后站点或线路数量会变化，按需重新分配临时数组
+void RaptorPlanner::prepare()
+{
+    if (stopCount != net.stopCount() || best.size() != net.stopCount()) {
+        stopCount = net.stopCount();
+        roundCount = 0;
+        labels.clear();
+        best.fill(INF, stopCount);
+        isMarked.fill(false, stopCount);
+    }
+    if (routeFirst.size() != net.routeCount()) {
+        routeFirst.fill(INT_MAX, net.routeCount());
+        routeLast.fill(-1, net.routeCount());
+    }
+}
+
+void RaptorPlanner::ensureRound(int round)
+{
+    if (round < roundCount) return;
+    roundCount = round + 1;
+    labels.resize(qsizetype(roundCount) * stopCount, Label{INF, -1, -1, -1});
+}
+
+void RaptorPlanner::setLabel(int round, StopId stop, const Label& l)
+{
+    const int index = round * stopCount + int(stop);
+    if (labels[index].arrival == INF) touchedLabels.append(index);
+    if (best[stop] == INF) touchedStops.append(stop);
+    labels[index] = l;
+    best[stop] = l.arrival;
+}
+
+// 沿 dir 方向扫描线路：先用当前所乘车次尝试改进本站，再看能否在本站更早上车
+void RaptorPlanner::scanRoute(int round, int route, int startPos, int dir, StopId target)
+{
+    const RouteView rv = net.route(route);
+    const int boardPenalty = round > 1 ? TRANSFER_MINUTES : 0;
+    int boardPos = -1;
+    int boardBase = INF;    // 上车时刻减去上车点的累计里程（方向相关），到达时刻 = boardBase + offset
+
+    for (int i = startPos; i >= 0 && i < rv.stopCount(); i += dir) {
+        const StopId s = rv.stopAt(i);
+        const int offset = dir > 0 ? rv.minutesAt(i) : -rv.minutesAt(i);
+
+        if (boardPos != -1) {
+            const int arrival = boardBase + offset;
+            if (arrival < best[s] && (target == INVALID_STOP || arrival < best[target])) {
+                setLabel(round, s, Label{arrival, route, boardPos, i});
+                if (!isMarked[s]) {
+                    isMarked[s] = true;
+                    nextMarked.append(s);
+                }
+            }
+        }
+
+        const int prev = label(round - 1, s).arrival;
+        if (prev != INF && prev + boardPenalty - offset < boardBase) {
+            boardBase = prev + boardPenalty - offset;
+            boardPos = i;
+        }
+    }
+}
+
+Journey RaptorPlanner::extract(int round, StopId target)
+{
+    Journey j;
+    j.totalMinutes = label(round, target).arrival;
+    StopId s = target;
+    for (int k = round; k > 0; --k) {
+        const Label& l = label(k, s);
+        j.legs.prepend(JourneyLeg{l.route, l.boardPos, l.alightPos});
+        s = net.route(l.route).stopAt(l.boardPos);
+    }
+    return j;
+}
+
+void RaptorPlanner::reset()
+{
+    for (int index : std::as_const(touchedLabels)) labels[index] = Label{INF, -1, -1, -1};
+    for (StopId s : std::as_const(touchedStops)) best[s] = INF;
+    for (StopId s : std::as_const(nextMarked)) isMarked[s] = false;
+    touchedLabels.clear();
+    touchedStops.clear();
+    marked.clear();
+    nextMarked.clear();
+}
+
+QVector<Journey> RaptorPlanner::plan(StopId from, StopId to, int maxTransfers, const CancelToken* cancel,
+                                     SearchTrace* trace)
+{
+    prepare();
+    if (to >= StopId(stopCount)) return {};
+    return run(from, to, maxTransfers, cancel, trace, nullptr);
+}
+
+void RaptorPlanner::planAll(StopId from, const Visitor& visit, int maxTransfers, const CancelToken* cancel)
+{
+    prepare();
+    run(from, INVALID_STOP, maxTransfers, cancel, nullptr, &visit);
+}
+
+QVector<Journey> RaptorPlanner::run(StopId from, StopId to, int maxTransfers, const CancelToken* cancel,
+                                    SearchTrace* trace, const Visitor* visit)
+{
+    SearchTrace::Scope phase(trace, SearchTrace::Pareto);
+    quint64 scanned = 0;
+    QVector<Journey> result;
+    if (from == to || from >= StopId(stopCount)) return result;
+
+    const int maxRounds = maxTransfers < 0 ? -1 : maxTransfers + 1;
+    const bool pruneRoutes = maxRounds >= 0 && to != INVALID_STOP;
+    if (pruneRoutes) net.transfers().hopsTo(net, to, routeHops);
+
+    ensureRound(0);
+    setLabel(0, from, Label{0, -1, -1, -1});
+    marked.append(from);
+
+    for (int k = 1; !marked.isEmpty() && (maxRounds < 0 || k <= maxRounds); ++k) {
+        ensureRound(k);
+
+        // 只排队经过上一轮改进站点的线路，并记下两个方向各自的起扫位置；
+        // 本轮上车后到终点所需的段数超出剩余轮次的线路直接跳过
+        for (StopId p : std::as_const(marked)) {
+            for (const StopVisit& v : net.visitsAt(p)) {
+                const int r = int(v.route);
+                if (pruneRoutes && k - 1 + routeHops[r] > maxRounds) continue;
+                if (routeLast[r] == -1) queuedRoutes.append(r);
+                routeFirst[r] = qMin(routeFirst[r], int(v.pos));
+                routeLast[r] = qMax(routeLast[r], int(v.lastPos));
+            }
+        }
+
+        const int targetBefore = to != INVALID_STOP ? best[to] : INF;
+        scanned += quint64(queuedRoutes.size());
+        bool cancelled = false;
+        for (int r : std::as_const(queuedRoutes)) {
+            // 取消后不再扫描，但仍要把剩余线路的起扫位置复位
+            if (!cancelled && cancel && cancel->isCancelled()) cancelled = true;
+            if (!cancelled && net.route(r).hasTravelTimes()) {
+                scanRoute(k, r, routeFirst[r], +1, to);
+                scanRoute(k, r, routeLast[r], -1, to);
+            }
+            routeFirst[r] = INT_MAX;
+            routeLast[r] = -1;
+        }
+        queuedRoutes.clear();
+        if (cancelled) {
+            result.clear();
+            break;
+        }
+
+        if (visit) {
+            // nextMarked 恰好是本轮写过标签的站点
+            for (StopId s : std::as_const(nextMarked)) (*visit)(s, extract(k, s));
+        } else if (best[to] < targetBefore) {
+            result.append(extract(k, to));
+        }
+
+        // 终点无需继续向外扩展；只有一条线路经过一次的站，重新登上同一线路不会更早到达任何站
+        // （环线在首末站重复经过同一站，仍可在那里“换乘”自己接着绕行）
+        marked.clear();
+        for (StopId s : std::as_const(nextMarked)) {
+            isMarked[s] = false;
+            const StopVisitRange range = net.visitsAt(s);
+            if (s != to && (range.size() > 1 || range.first->pos != range.first->lastPos)) marked.append(s);
+        }
+        nextMarked.clear();
+    }
+
+    reset();
+    phase.count(scanned);
+    return result;
+}
@@ -0,0 +1,72 @@
+#ifndef RAPTOR_H
+#define RAPTOR_H
+
+#include "network.h"
+#include "journey.h"
+#include "canceltoken.h"
+#include "searchtrace.h"
+#include <QVector>
+#include <functional>
+
+// 基于轮次的 RAPTOR 查询：第 k 轮求出恰好乘坐 k 段车能到达各站的最早时间，
+// 每轮只扫描上一轮有改进的站点所经过的线路段。
+// 线路可双向乘坐；换乘固定加 TRANSFER_MINUTES 分钟。
+// 限定换乘次数时，按换乘图求出的各线路到终点的最少段数，剩余轮次不够的线路不再扫描；
+// 只有一条线路经过一次的站无处换乘，不进入下一轮。
+// 规划器持有可复用的临时数组，不是线程安全的，每个线程各用一个实例。
+class RaptorPlanner
+{
+public:
+    static constexpr int TRANSFER_MINUTES = 3;
+
+    explicit RaptorPlanner(const BusNetwork& network);
+
+    // 返回 (总时间, 换乘次数) 意义下的 Pareto 最优方案，按换乘次数升序（总时间随之递减）；
+    // maxTransfers < 0 表示不限换乘次数；cancel 被取消时尽快返回空结果；
+    // trace 非空时把耗时和扫描的线路段数记到 SearchTrace::Pareto
+    QVector<Journey> plan(StopId from, StopId to, int maxTransfers = -1, const CancelToken* cancel = nullptr,
+                          SearchTrace* trace = nullptr);
+
+    // 一对多：不设终点，每一轮对本轮有改进的每个站点调用一次 visit(站点, 方案)。
+    // 同一站点的各次回调按段数递增，合起来与 plan(from, 该站) 的结果相同；取消时提前结束
+    using Visitor = std::function<void(StopId stop, const Journey& journey)>;
+    void planAll(StopId from, const Visitor& visit, int maxTransfers = -1, const CancelToken* cancel = nullptr);
+
+private:
+    struct Label {
+        int arrival;
+        int route;       // 本轮到达该站所乘线路，-1 表示起点
+        int boardPos;
+        int alightPos;
+    };
+
+    Label& label(int round, StopId stop) { return labels[round * stopCount + int(stop)]; }
+    void prepare();
+    void ensureRound(int round);
+    void setLabel(int round, StopId stop, const Label& l);
+    void scanRoute(int round, int route, int startPos, int dir, StopId target);
+    Journey extract(int round, StopId target);
+    void reset();
+    // to 为 INVALID_STOP 时不设终点、每轮回调 visit；否则返回到 to 的 Pareto 方案
+    QVector<Journey> run(StopId from, StopId to, int maxTransfers, const CancelToken* cancel, SearchTrace* trace,
+                         const Visitor* visit);
+
+    const BusNetwork& net;
+    int stopCount = 0;
+    int roundCount = 0;
+
+    QVector<Label> labels;          // roundCount * stopCount，按轮次分块
+    QVector<int> best;              // 各站目前已知的最早到达时间（跨轮次）
+    QVector<int> touchedLabels;     // 本次查询写过的 labels 下标，查询结束后只重置这些
+    QVector<StopId> touchedStops;
+    QVector<StopId> marked;         // 上一轮有改进的站点
+    QVector<StopId> nextMarked;
+    QVector<bool> isMarked;
+
+    QVector<int> routeFirst;        // 本轮线路上最靠前 / 最靠后的改进站位置
+    QVector<int> routeLast;
+    QVector<int> queuedRoutes;
+    QVector<int> routeHops;         // 各线路到终点至少还要乘几段车（仅限定换乘次数时计算）
+};
+
+#endif // RAPTOR_H
@@ -0,0 +1,14 @@
+#include "route.h"
+#include <utility>
+
+int Route::travelTime(const QString& from, const QString& to) const
+{
+    int i1 = indexOf(from);
+    int i2 = indexOf(to);
+    if (i1 == -1 || i2 == -1) return -1;
+    if (travelTimes.size() != stops.size() - 1) return -1;
+    if (i1 > i2) std::swap(i1, i2);
+    int sum = 0;
+    for (int i = i1; i < i2; ++i) sum += travelTimes[i];
+    return qAbs(sum);
+}
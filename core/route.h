@@ -0,0 +1,35 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QTime>
+
+struct Route {
+    QString id;
+    QString name;
+    QVector<QString> stops;
+    QList<int> travelTimes;   // 相邻站点间时间（分钟），长度 = stops.size() - 1
+    QTime firstBus;           // 首班车
+    QTime lastBus;            // 末班车
+
+    // 构造函数
+    Route(QString i = "", QString n = "", QVector<QString> s = {})
+        : id(i), name(n), stops(s)
+    {
+        // 默认：每段 3 分钟（仅当 stops 有效时）
+        for (int i = 0; i < stops.size() - 1; ++i) {
+            travelTimes.append(3);
+        }
+        // 默认首末班
+        firstBus = QTime(6, 0);   // 06:00
+        lastBus = QTime(22, 30);  // 22:30
+    }
+
+    // 线路只是编辑与导入导出用的数据；查询走 BusNetwork 的扁平数组，这里不维护派生索引
+    int indexOf(const QString& stop) const { return stops.indexOf(stop); }
+    int travelTime(const QString& from, const QString& to) const;   // 任一站不在线路上或耗时无效时返回 -1
+};
+
+#endif // ROUTE_H
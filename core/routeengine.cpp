@@ -0,0 +1,164 @@
+#include "routeengine.h"
+#include <algorithm>
+
+RouteEngine& RouteEngine::operator=(const RouteEngine& other)
+{
+    net = other.net;
+    timetable = other.timetable;
+    alt = other.alt;
+    patterns = other.patterns;
+    return *this;
+}
+
+void RouteEngine::setRoutes(QVector<Route>& routes)
+{
+    net.build(routes);
+    timetable.build(net);
+    alt.clear();
+    patterns.clear();
+}
+
+void RouteEngine::setNetwork(const BusNetwork& network)
+{
+    net = network;
+    timetable.build(net);
+    alt.clear();
+    patterns.clear();
+}
+
+bool RouteEngine::updateRoute(Route& route, NetworkDelta* delta)
+{
+    NetworkDelta local;
+    if (!delta) delta = &local;
+    QVector<StopId> oldStops;
+    QVector<int> oldMinutes;
+    routeShape(route.id, oldStops, oldMinutes);
+    if (!net.upsertRoute(route, delta)) return false;
+    timetable.updateRoute(net, delta->route);
+    alt.clear();
+    patterns.routeChanged(net, delta->route, oldStops, oldMinutes);
+    return true;
+}
+
+bool RouteEngine::removeRoute(const QString& id, NetworkDelta* delta)
+{
+    NetworkDelta local;
+    if (!delta) delta = &local;
+    QVector<StopId> oldStops;
+    QVector<int> oldMinutes;
+    routeShape(id, oldStops, oldMinutes);
+    if (!net.removeRoute(id, delta)) return false;
+    // 空槽过多时线网已整体重新编译，线路下标与站点编号全变了，时刻表与换乘模式也整体重来
+    alt.clear();
+    if (delta->rebuilt) {
+        timetable.build(net);
+        patterns.clear();
+    } else {
+        timetable.updateRoute(net, delta->route);
+        patterns.routeChanged(net, delta->route, oldStops, oldMinutes);
+    }
+    return true;
+}
+
+bool RouteEngine::prepareLandmarks(const QString& dataFile, int count)
+{
+    const QString fileName = LandmarkTable::pathFor(dataFile);
+    LandmarkTable table;
+    if (table.load(fileName, net)) {
+        alt = table;
+        return true;
+    }
+    table.build(net, count);
+    table.save(fileName);      // 写不进去（如只读目录）也不影响本次查询
+    alt = table;
+    return false;
+}
+
+bool RouteEngine::setLandmarks(const LandmarkTable& table, quint64 version)
+{
+    if (version != net.version()) return false;
+    alt = table;
+    return true;
+}
+
+void RouteEngine::routeShape(const QString& id, QVector<StopId>& stops, QVector<int>& minutes) const
+{
+    const int index = net.routeIndex(id);
+    if (index < 0) return;
+    const RouteView rv = net.route(index);
+    for (int p = 0; p < rv.stopCount(); ++p) {
+        stops.append(rv.stopAt(p));
+        if (rv.hasTravelTimes()) minutes.append(rv.minutesAt(p));
+    }
+}
+
+bool RouteEngine::mergeTransferPatterns(const TransferPatterns& computed, quint64 version)
+{
+    if (version != net.version()) return false;
+    patterns.merge(computed);
+    return true;
+}
+
+// 起点有有效的换乘模式时直接求值，否则 RAPTOR
+QVector<Journey> RouteEngine::pareto(StopId from, StopId to, int maxTransfers, const CancelToken* cancel,
+                                     SearchTrace* trace)
+{
+    QVector<Journey> journeys;
+    if (patterns.covers(from)) {
+        SearchTrace::Scope phase(trace, SearchTrace::Patterns);
+        quint64 evaluated = 0;
+        const bool found = patterns.query(net, from, to, maxTransfers, journeys, &evaluated);
+        phase.count(evaluated);
+        if (found) return journeys;
+    }
+    return planner.plan(from, to, maxTransfers, cancel, trace);
+}
+
+QVector<Journey> RouteEngine::search(const QString& start, const QString& end, int maxTransfers,
+                                     const CancelToken* cancel, SearchTrace* trace)
+{
+    // 站名只在入口处转换一次，之后在整数化网络上按模式求值或交给 RAPTOR 按轮次搜索
+    QVector<Journey> journeys = pareto(net.stopId(start), net.stopId(end), maxTransfers, cancel, trace);
+    std::sort(journeys.begin(), journeys.end(), [](const Journey& a, const Journey& b) {
+        return a.totalMinutes < b.totalMinutes;
+    });
+    return journeys;
+}
+
+QVector<Journey> RouteEngine::searchTopK(const QString& start, const QString& end, int k, int maxTransfers,
+                                         const CancelToken* cancel, SearchTrace* trace)
+{
+    const StopId from = net.stopId(start);
+    const StopId to = net.stopId(end);
+    const QVector<Journey> seeds = pareto(from, to, maxTransfers, cancel, trace);
+    if (seeds.isEmpty()) return {};
+
+    // Pareto 方案按换乘次数升序，最后一个换乘最多
+    int maxLegs = int(seeds.last().legs.size()) + 1;
+    if (maxTransfers >= 0) maxLegs = qMin(maxLegs, maxTransfers + 1);
+    return topK.plan(from, to, k, maxLegs, alt, seeds, cancel, trace);
+}
+
+Journey RouteEngine::searchAt(const QString& start, const QString& end, int departMinutes,
+                              const CancelToken* cancel, SearchTrace* trace)
+{
+    return timetable.earliestArrival(net, net.stopId(start), net.stopId(end), departMinutes, cancel, trace);
+}
+
+Journey RouteEngine::searchFastest(const QString& start, const QString& end,
+                                   const CancelToken* cancel, SearchTrace* trace)
+{
+    return fastest.plan(net.stopId(start), net.stopId(end), alt, cancel, trace);
+}
+
+QStringList RouteEngine::legStops(const JourneyLeg& leg) const
+{
+    QStringList names;
+    const RouteView rv = net.route(leg.route);
+    const int step = leg.fromPos < leg.toPos ? 1 : -1;
+    for (int p = leg.fromPos; ; p += step) {
+        names.append(net.stopName(rv.stopAt(p)));
+        if (p == leg.toPos) break;
+    }
+    return names;
+}
@@ -0,0 +1,92 @@
+#ifndef ROUTEENGINE_H
+#define ROUTEENGINE_H
+
+#include "network.h"
+#include "raptor.h"
+#include "topkplanner.h"
+#include "connectionscan.h"
+#include "altplanner.h"
+#include "landmarks.h"
+#include "transferpatterns.h"
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+// 不依赖界面的查询引擎：持有编译后的线网和各查询算法，
+// 图形界面和命令行工具都通过它查询。查询会复用内部临时数组，不是线程安全的；
+// 但复制很廉价——线网与时刻表数据隐式共享，副本有自己的临时数组，可交给其他线程查询，
+// 原对象随后调用 setRoutes() 也不影响副本。
+class RouteEngine
+{
+public:
+    RouteEngine() = default;
+    RouteEngine(const RouteEngine& other)
+        : net(other.net), timetable(other.timetable), alt(other.alt), patterns(other.patterns) {}
+    // 换上 other 已经编译好的线网、时刻表、地标表与换乘模式（都隐式共享，不重新计算），临时数组留用。
+    // 可以在其他线程上准备好整个引擎，再到查询所在的线程一次换入
+    RouteEngine& operator=(const RouteEngine& other);
+
+    // 用新的线路数据重建线网与时刻表；会把 routes 中的站名替换为驻留的共享副本
+    void setRoutes(QVector<Route>& routes);
+    // 直接采用已经编译好的线网（如从快照读入），只重算各线路的发车规律（每条线路一行，不展开车次）
+    void setNetwork(const BusNetwork& network);
+    const BusNetwork& network() const { return net; }
+
+    // 增量修改单条线路（编号不存在时新增），线网与时刻表只改动与它相关的部分。
+    // 返回 false 表示无法增量修改（编号为空或重复），调用方应改用 setRoutes() 整体重建
+    bool updateRoute(Route& route, NetworkDelta* delta = nullptr);
+    bool removeRoute(const QString& id, NetworkDelta* delta = nullptr);
+
+    // searchFastest() 与 searchTopK() 下界用的地标表。setRoutes()/setNetwork() 与增量修改都会清空它（旧的下界不再可采纳），
+    // 需要时再调用 prepareLandmarks()：读入数据文件旁边保存的那份，没有或已过期就重新选 count 个地标计算并写回。
+    // 返回 true 表示直接读入了已保存的结果
+    bool prepareLandmarks(const QString& dataFile, int count = LandmarkTable::DEFAULT_COUNT);
+    void setLandmarks(const LandmarkTable& table) { alt = table; }
+    // version 为计算时线网的 version()；线网此后又被修改过时不采用，返回 false
+    bool setLandmarks(const LandmarkTable& table, quint64 version);
+    const LandmarkTable& landmarks() const { return alt; }
+
+    // 换乘模式（见 TransferPatterns）：查询时 noteQuery() 记下起点；调用方在后台取一份副本，
+    // 模式为空时先 load() 数据文件旁边保存的那份，settle() 核查积压的修改，再对 wantedOrigins()
+    // 调用 TransferPatterns::compute() 并 merge() 进副本、save() 写回，最后交给 mergeTransferPatterns()。
+    // 有有效模式的起点，search()/searchTopK() 直接按模式求值，其余照常用 RAPTOR。
+    // setRoutes()/setNetwork() 清空全部模式；增量修改只记下修改，核查之前全部改用 RAPTOR
+    const TransferPatterns& transferPatterns() const { return patterns; }
+    void noteQuery(const QString& start) { patterns.request(net.stopId(start)); }
+    // version 为取副本时线网的 version()；线网此后又被修改过时不采用，返回 false
+    bool mergeTransferPatterns(const TransferPatterns& computed, quint64 version);
+
+    // 以下查询的 cancel 被取消时尽快返回空结果；trace 非空时记录各阶段耗时与候选数（见 SearchTrace）
+
+    // 不限换乘次数的 Pareto 方案（总时间, 换乘次数），按总时间升序；任一站未知时返回空
+    QVector<Journey> search(const QString& start, const QString& end, int maxTransfers = -1,
+                            const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+    // 总时间最短的前 k 个方案（每种线路组合取最优），按总时间升序；有地标表时分支限界的下界直接取自它。
+    // 先求出 Pareto 集（按换乘模式或 RAPTOR）作为初始解，换乘次数上限取其中最多的再加一次（且不超过 maxTransfers）
+    QVector<Journey> searchTopK(const QString& start, const QString& end, int k, int maxTransfers = -1,
+                                const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+    // departMinutes（当日零点起的分钟数）出发、最早到达的方案；当天已无车可达时 legs 为空
+    Journey searchAt(const QString& start, const QString& end, int departMinutes,
+                     const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+    // 总时间最短的单个方案（A*，见 AltPlanner）；没有地标表时同样正确，只是搜索范围更大。不可达时 legs 为空
+    Journey searchFastest(const QString& start, const QString& end,
+                          const CancelToken* cancel = nullptr, SearchTrace* trace = nullptr);
+
+    // 行程某一段经过的站名（含上下车站）
+    QStringList legStops(const JourneyLeg& leg) const;
+
+private:
+    BusNetwork net;
+    RaptorPlanner planner{net};
+    TopKPlanner topK{net};
+    AltPlanner fastest{net};
+    ConnectionScan timetable;
+    LandmarkTable alt;
+    TransferPatterns patterns;
+
+    QVector<Journey> pareto(StopId from, StopId to, int maxTransfers, const CancelToken* cancel, SearchTrace* trace);
+    // 线路 id 当前的站点与累计分钟数（耗时无效时 minutes 为空），供换乘模式判断修改的影响
+    void routeShape(const QString& id, QVector<StopId>& stops, QVector<int>& minutes) const;
+};
+
+#endif // ROUTEENGINE_H
@@ -0,0 +1,144 @@
+#include "routeimporter.h"
+#include "routeio.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+}
+
+void RouteImporter::parseElement(const QByteArray& element, qint64 offset, QVector<Route>& routes)
+{
+    const int index = elementIndex++;
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(element, &parseError);
+    QString message;
+    if (parseError.error != QJsonParseError::NoError) {
+        message = parseError.errorString();
+    } else if (!doc.isObject()) {
+        message = "不是线路对象";
+    } else {
+        Route r = routeFromJson(doc.object());
+        if (r.id.isEmpty()) message = "缺少线路编号";
+        else if (r.stops.size() < 2) message = QString("线路 %1 的站点少于两个").arg(r.id);
+        else routes.append(r);
+    }
+    if (!message.isEmpty()) routeErrors.append({ index, offset, message });
+}
+
+bool RouteImporter::run(QVector<Route>& routes, const CancelToken* cancel, const Progress& progress)
+{
+    fatal.clear();
+    cancelled = false;
+    routeErrors.clear();
+    elementIndex = 0;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fatal = file.errorString();
+        return false;
+    }
+    const qint64 total = file.size();
+
+    // 只识别切分元素所需的结构：字符串（含转义）与括号深度
+    enum State { BeforeArray, BeforeElement, InElement, AfterElement, Done };
+    State state = BeforeArray;
+    QByteArray element;
+    qint64 elementOffset = 0;
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    qint64 consumed = 0;
+
+    auto fail = [this](const QString& message) {
+        fatal = message;
+        return false;
+    };
+
+    while (state != Done) {
+        if (cancel && cancel->isCancelled()) {
+            cancelled = true;
+            return fail("导入已取消");
+        }
+        const QByteArray chunk = file.read(CHUNK_BYTES);
+        if (chunk.isEmpty()) break;
+        const char* p = chunk.constData();
+        const qsizetype n = chunk.size();
+        qsizetype segment = state == InElement ? 0 : -1;     // 本块中属于当前元素的起点
+
+        // 元素在 [segment, end) 处结束
+        auto finish = [&](qsizetype end) {
+            element.append(p + segment, end - segment);
+            parseElement(element, elementOffset, routes);
+            element.clear();
+            segment = -1;
+        };
+
+        for (qsizetype i = 0; i < n && state != Done; ++i) {
+            const char c = p[i];
+            switch (state) {
+            case BeforeArray:
+                if (isSpace(c) || (consumed + i < 3 && uchar(c) >= 0xBB)) continue;    // 空白与 UTF-8 BOM
+                if (c != '[') return fail("JSON 格式不正确（顶层应为数组）");
+                state = BeforeElement;
+                continue;
+            case AfterElement:
+                if (isSpace(c)) continue;
+                if (c == ',') state = BeforeElement;
+                else if (c == ']') state = Done;
+                else return fail(QString("第 %1 字节处缺少逗号").arg(consumed + i));
+                continue;
+            case BeforeElement:
+                if (isSpace(c)) continue;
+                if (c == ']') {
+                    state = Done;
+                    continue;
+                }
+                state = InElement;
+                segment = i;
+                elementOffset = consumed + i;
+                depth = 0;
+                inString = false;
+                escape = false;
+                break;      // 当前字符作为元素的第一个字符继续处理
+            case InElement:
+            case Done:
+                break;
+            }
+
+            if (inString) {
+                if (escape) escape = false;
+                else if (c == '\\') escape = true;
+                else if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) {       // 标量元素后直接是数组结尾
+                    finish(i);
+                    state = Done;
+                } else if (--depth == 0) {
+                    finish(i + 1);
+                    state = AfterElement;
+                }
+            } else if (c == ',' && depth == 0) {
+                finish(i);
+                state = BeforeElement;
+            }
+        }
+
+        if (segment >= 0) {
+            element.append(p + segment, n - segment);
+            if (element.size() > MAX_ELEMENT_BYTES)
+                return fail(QString("第 %1 条线路超过 %2 MB").arg(elementIndex + 1).arg(MAX_ELEMENT_BYTES >> 20));
+        }
+        consumed += n;
+        if (progress) progress(consumed, total, int(routes.size()));
+    }
+
+    if (state != Done) return fail(state == BeforeArray ? "文件为空" : "文件不完整（数组没有结束）");
+    if (progress) progress(total, total, int(routes.size()));
+    return true;
+}
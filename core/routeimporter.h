@@ -0,0 +1,50 @@
+#ifndef ROUTEIMPORTER_H
+#define ROUTEIMPORTER_H
+
+#include "route.h"
+#include "canceltoken.h"
+#include <QVector>
+#include <QString>
+#include <functional>
+
+// 单条线路的导入错误：第几个数组元素、在文件中的字节偏移、原因
+struct ImportError {
+    int index;
+    qint64 offset;
+    QString message;
+};
+
+// 流式导入线路 JSON（顶层为线路对象数组）。
+// 按块读取文件，只在扫描中切分出顶层数组的一个个元素，每个元素单独解析成 Route，
+// 内存占用为已解析的线路加上一个元素的原文，不会把整个文件或整棵 JSON 树留在内存里。
+// 单条线路解析失败（不是合法 JSON、不是对象、缺少编号或不足两个站点）时记录错误并跳过；
+// 文件打不开、顶层不是数组或文件被截断时整体失败。
+class RouteImporter
+{
+public:
+    // 已读字节数、文件总字节数、已导入的线路数
+    using Progress = std::function<void(qint64 bytesRead, qint64 totalBytes, int routes)>;
+
+    static constexpr qint64 CHUNK_BYTES = 256 * 1024;
+    static constexpr qint64 MAX_ELEMENT_BYTES = 64 * 1024 * 1024;  // 单条线路原文的上限
+
+    explicit RouteImporter(const QString& fileName) : fileName(fileName) {}
+
+    // 导入的线路追加到 routes；失败或被取消时返回 false，routes 中保留已导入的部分
+    bool run(QVector<Route>& routes, const CancelToken* cancel = nullptr, const Progress& progress = {});
+
+    bool wasCancelled() const { return cancelled; }
+    QString errorString() const { return fatal; }
+    const QVector<ImportError>& errors() const { return routeErrors; }
+
+private:
+    void parseElement(const QByteArray& element, qint64 offset, QVector<Route>& routes);
+
+    QString fileName;
+    QString fatal;
+    bool cancelled = false;
+    QVector<ImportError> routeErrors;
+    int elementIndex = 0;
+};
+
+#endif // ROUTEIMPORTER_H
@@ -0,0 +1,107 @@
+#include "routeio.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QFile>
+
+Route routeFromJson(const QJsonObject& obj)
+{
+    Route r;
+    r.id   = obj["id"].toString();
+    r.name = obj["name"].toString();
+
+    // 加载 stops
+    for (const auto& s : obj["stops"].toArray()) {
+        r.stops.append(s.toString());
+    }
+
+    // travelTimes：旧数据没有这个字段，缺的部分按每段 3 分钟补齐
+    if (obj.contains("travelTimes") && obj["travelTimes"].isArray()) {
+        for (const auto& t : obj["travelTimes"].toArray()) {
+            r.travelTimes.append(t.toInt());
+        }
+    }
+    while (r.travelTimes.size() < r.stops.size() - 1) {
+        r.travelTimes.append(3);
+    }
+
+    // 首末班车
+    if (obj.contains("firstBus")) {
+        r.firstBus = QTime::fromString(obj["firstBus"].toString(), "HH:mm");
+    }
+    if (obj.contains("lastBus")) {
+        r.lastBus = QTime::fromString(obj["lastBus"].toString(), "HH:mm");
+    }
+
+    // 设置默认首末班（防止无效时间）
+    if (!r.firstBus.isValid()) r.firstBus = QTime(6, 0);   // 06:00
+    if (!r.lastBus.isValid())  r.lastBus = QTime(22, 30);  // 22:30
+    return r;
+}
+
+QJsonObject routeToJson(const Route& r)
+{
+    QJsonObject obj;
+    obj["id"] = r.id;
+    obj["name"] = r.name;
+
+    QJsonArray stops;
+    for (const auto& s : r.stops) stops.append(s);
+    obj["stops"] = stops;
+
+    QJsonArray times;
+    for (int t : r.travelTimes) times.append(t);
+    obj["travelTimes"] = times;
+
+    obj["firstBus"] = r.firstBus.toString("HH:mm");
+    obj["lastBus"] = r.lastBus.toString("HH:mm");
+    return obj;
+}
+
+bool routesFromJson(const QByteArray& data, QVector<Route>& routes, QString* error)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        if (error) *error = parseError.errorString();
+        return false;
+    }
+    if (!doc.isArray()) {
+        if (error) *error = "JSON 格式不正确（顶层应为数组）";
+        return false;
+    }
+
+    QVector<Route> parsed;
+    const QJsonArray root = doc.array();
+    parsed.reserve(root.size());
+    for (const auto v : root) {
+        parsed.append(routeFromJson(v.toObject()));
+    }
+    routes = parsed;
+    return true;
+}
+
+QByteArray routesToJson(const QVector<Route>& routes)
+{
+    QJsonArray root;
+    for (const auto& r : routes) root.append(routeToJson(r));
+    return QJsonDocument(root).toJson();
+}
+
+bool loadRoutes(const QString& fileName, QVector<Route>& routes, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return routesFromJson(file.readAll(), routes, error);
+}
+
+bool saveRoutes(const QString& fileName, const QVector<Route>& routes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(routesToJson(routes));
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef ROUTEIO_H
+#define ROUTEIO_H
+
+#include "route.h"
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+class QJsonObject;
+
+// 线路数据的 JSON 读写（顶层为线路对象数组），界面与命令行共用
+// 缺少 travelTimes 的旧数据按每段 3 分钟补齐，无效的首末班回退为 06:00 / 22:30
+
+// 解析失败（不是 JSON 数组）时返回 false 并写入 error，routes 保持不变
+bool routesFromJson(const QByteArray& data, QVector<Route>& routes, QString* error = nullptr);
+QByteArray routesToJson(const QVector<Route>& routes);
+// 单个线路对象与 Route 互转（读入时同样补齐缺省值），流式导入和修改日志逐条调用
+Route routeFromJson(const QJsonObject& obj);
+QJsonObject routeToJson(const Route& r);
+
+bool loadRoutes(const QString& fileName, QVector<Route>& routes, QString* error = nullptr);
+bool saveRoutes(const QString& fileName, const QVector<Route>& routes);
+
+#endif // ROUTEIO_H
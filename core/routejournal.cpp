@@ -0,0 +1,155 @@
+#include "routejournal.h"
+#include "routeio.h"
+#include "networksnapshot.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace {
+
+// 按编号应用一条记录；put 替换同编号线路或追加，del 删除同编号线路
+bool applyRecord(const QJsonObject& record, QVector<Route>& routes)
+{
+    QString id;
+    Route route;
+    const bool put = record.contains("put");
+    if (put) {
+        route = routeFromJson(record["put"].toObject());
+        id = route.id;
+    } else {
+        id = record["del"].toString();
+    }
+    if (id.isEmpty()) return false;
+
+    auto it = std::find_if(routes.begin(), routes.end(), [&](const Route& r) { return r.id == id; });
+    if (put) {
+        if (it != routes.end()) *it = route;
+        else routes.append(route);
+    } else if (it != routes.end()) {
+        routes.erase(it);
+    }
+    return true;
+}
+
+int replayFile(const QString& fileName, QVector<Route>& routes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    int applied = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) continue;
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) break;     // 崩溃时没写完的末行
+        if (applyRecord(doc.object(), routes)) ++applied;
+    }
+    return applied;
+}
+
+} // namespace
+
+bool RouteJournal::load(const QString& dataFile, BusNetwork& network, LoadInfo* info, QString* error)
+{
+    LoadInfo result;
+    BusNetwork snapshot;
+    QVector<Route> routes;
+    result.fromSnapshot = NetworkSnapshot::load(NetworkSnapshot::pathFor(dataFile), dataFile, snapshot);
+    if (result.fromSnapshot) routes = snapshot.routes();
+    else if (!loadRoutes(dataFile, routes, error)) return false;
+
+    result.replayed = RouteJournal(dataFile).replay(routes);
+    if (result.fromSnapshot && result.replayed == 0) network = snapshot;
+    else network.build(routes);
+    if (info) *info = result;
+    return true;
+}
+
+RouteJournal::RouteJournal(const QString& dataFile)
+    : dataFile(dataFile), journalFile(dataFile + ".journal")
+{
+    // 代次接着磁盘上残留的旧日志往后编，重放顺序才与写入顺序一致
+    const auto rotated = rotatedFiles();
+    if (!rotated.isEmpty()) nextGeneration = rotated.last().first + 1;
+}
+
+QVector<QPair<quint64, QString>> RouteJournal::rotatedFiles() const
+{
+    const QFileInfo info(journalFile);
+    const QDir dir = info.dir();
+    const QString prefix = info.fileName() + '.';
+    QVector<QPair<quint64, QString>> files;
+    for (const QString& name : dir.entryList({ prefix + '*' })) {
+        bool ok = false;
+        const quint64 generation = name.mid(prefix.size()).toULongLong(&ok);
+        if (ok) files.append({ generation, dir.filePath(name) });
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+int RouteJournal::replay(QVector<Route>& routes) const
+{
+    int applied = 0;
+    for (const auto& file : rotatedFiles()) applied += replayFile(file.second, routes);
+    return applied + replayFile(journalFile, routes);
+}
+
+bool RouteJournal::append(const QByteArray& line)
+{
+    if (!journal.isOpen()) {
+        journal.setFileName(journalFile);
+        if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+    }
+    // 一次写出整行，末尾换行标志着这条记录完整
+    if (journal.write(line + '\n') != line.size() + 1 || !journal.flush()) return false;
+    ++pending;
+    return true;
+}
+
+bool RouteJournal::appendPut(const Route& route)
+{
+    QJsonObject record;
+    record["put"] = routeToJson(route);
+    return append(QJsonDocument(record).toJson(QJsonDocument::Compact));
+}
+
+bool RouteJournal::appendRemove(const QString& id)
+{
+    QJsonObject record;
+    record["del"] = id;
+    return append(QJsonDocument(record).toJson(QJsonDocument::Compact));
+}
+
+quint64 RouteJournal::beginCompaction()
+{
+    const quint64 generation = nextGeneration++;
+    journal.close();
+    if (QFile::exists(journalFile))
+        QFile::rename(journalFile, journalFile + '.' + QString::number(generation));
+    pending = 0;
+    return generation;
+}
+
+bool RouteJournal::compact(quint64 generation, const QVector<Route>& routes, const BusNetwork& network)
+{
+    QMutexLocker locker(&compactLock);
+    if (generation <= written) return true;
+
+    const QByteArray json = routesToJson(routes);
+    QSaveFile file(dataFile);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(json);
+    if (!file.commit()) return false;     // 失败时旧数据文件和日志都原样保留
+    written = generation;
+    NetworkSnapshot::save(NetworkSnapshot::pathFor(dataFile), network, json);
+
+    // 数据文件已包含这些日志的全部内容
+    for (const auto& file : rotatedFiles())
+        if (file.first <= generation) QFile::remove(file.second);
+    return true;
+}
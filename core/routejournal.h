@@ -0,0 +1,66 @@
+#ifndef ROUTEJOURNAL_H
+#define ROUTEJOURNAL_H
+
+#include "route.h"
+#include "network.h"
+#include <QVector>
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QPair>
+
+// 线路修改日志：每次增改删只向 <数据文件>.journal 追加一行紧凑 JSON，
+//   {"put":{线路对象}}  或  {"del":"线路编号"}
+// 写入耗时与线网规模无关。日志积累到一定条数后压缩：先把当前日志改名为 .journal.<代次>，
+// 之后的修改写进新日志；再在后台把全部线路原子地写回数据文件（连同线网快照），成功后删除
+// 不晚于该代次的旧日志。两种记录都是幂等的，任何时刻崩溃后按“数据文件 → 各代旧日志 → 当前日志”
+// 重放都能得到崩溃前最后一次写入的状态；追加到一半的末行会被忽略。
+class RouteJournal
+{
+public:
+    static constexpr int COMPACT_RECORDS = 200;     // 当前日志达到这么多条时应当压缩
+
+    struct LoadInfo {
+        bool fromSnapshot = false;  // 数据文件部分取自有效的快照
+        int replayed = 0;           // 重放的日志记录数；非零时数据文件落后于日志，应当压缩
+    };
+    // 读出 dataFile 的最新状态：快照与 JSON 一致时取快照，否则解析 JSON；再重放尚未写回的各代日志。
+    // 界面、命令行、查询服务与基准都经这里读数据，不会漏掉界面还没压缩进数据文件的修改。
+    // 没有日志要重放时 network 就是快照本身，否则按重放后的线路整体编译；线路取 network.routes()。
+    // 数据文件读不出时返回 false 并写入 error，network 不变
+    static bool load(const QString& dataFile, BusNetwork& network, LoadInfo* info = nullptr,
+                     QString* error = nullptr);
+
+    explicit RouteJournal(const QString& dataFile);
+
+    // 把数据文件之后的所有日志按顺序应用到 routes（routes 应是刚从数据文件读出的内容），返回应用的记录数
+    int replay(QVector<Route>& routes) const;
+
+    // 界面线程调用：追加一条记录并刷到操作系统
+    bool appendPut(const Route& route);
+    bool appendRemove(const QString& id);
+    // 当前日志里的记录数
+    int records() const { return pending; }
+
+    // 界面线程调用：轮换日志并返回本次压缩的代次，交给 compact()
+    quint64 beginCompaction();
+    // 任意线程：routes / network 须是调用 beginCompaction() 那一刻的状态。
+    // 比已写出的代次旧时直接返回（更新的压缩已经覆盖了它）
+    bool compact(quint64 generation, const QVector<Route>& routes, const BusNetwork& network);
+
+private:
+    bool append(const QByteArray& line);
+    // 已轮换的旧日志，按代次升序
+    QVector<QPair<quint64, QString>> rotatedFiles() const;
+
+    QString dataFile;
+    QString journalFile;
+    QFile journal;
+    int pending = 0;
+    quint64 nextGeneration = 1;
+
+    QMutex compactLock;
+    quint64 written = 0;    // 已写回数据文件的最新代次，受 compactLock 保护
+};
+
+#endif // ROUTEJOURNAL_H
@@ -0,0 +1,117 @@
+#include "searchtrace.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+// 候选数的量词，与 SearchTrace::Phase 一一对应；渲染与显示没有候选
+const char* const exploredUnits[] = { "段线路", "个模式", "个站点", "个分支", "条 connection", "个节点", "", "" };
+
+// 不到 1 毫秒的按微秒显示，小数据集上各阶段才分得出先后
+QString duration(qint64 nanos)
+{
+    if (nanos < 1000000) return QString::number(nanos / 1000) + " µs";
+    return QString::number(nanos / 1e6, 'f', 2) + " ms";
+}
+
+} // namespace
+
+QString SearchTrace::phaseName(Phase phase)
+{
+    switch (phase) {
+    case Pareto: return "Pareto";
+    case Patterns: return "换乘模式";
+    case Bound: return "下界";
+    case Enumerate: return "枚举";
+    case Scan: return "时刻表";
+    case AStar: return "A*";
+    case Render: return "渲染";
+    case Display: return "显示";
+    case PhaseCount: break;
+    }
+    return QString();
+}
+
+qint64 SearchTrace::totalNanos() const
+{
+    qint64 total = 0;
+    for (qint64 ns : nanos) total += ns;
+    return total;
+}
+
+QString SearchTrace::summary() const
+{
+    QStringList parts;
+    for (int p = 0; p < PhaseCount; ++p) {
+        if (nanos[p] == 0 && explored[p] == 0) continue;
+        QString part = phaseName(Phase(p)) + " " + duration(nanos[p]);
+        if (*exploredUnits[p]) part += QString("（%1 %2）").arg(explored[p]).arg(exploredUnits[p]);
+        parts.append(part);
+    }
+    return QString("共 %1：").arg(duration(totalNanos())) + parts.join(" · ");
+}
+
+SearchHistory::SearchHistory(int capacity)
+    : capacity(qMax(1, capacity))
+{
+}
+
+void SearchHistory::record(const SearchTrace& trace)
+{
+    if (recent.size() < capacity) {
+        recent.append(trace);
+    } else {
+        recent[next] = trace;
+        next = (next + 1) % capacity;
+    }
+    for (int p = 0; p < SearchTrace::PhaseCount; ++p) {
+        totals.nanos[p] += trace.nanos[p];
+        totals.explored[p] += trace.explored[p];
+    }
+    ++count;
+}
+
+void SearchHistory::clear()
+{
+    recent.clear();
+    next = 0;
+    count = 0;
+    totals = SearchTrace();
+}
+
+const SearchTrace& SearchHistory::at(int i) const
+{
+    // 缓冲未满时 next 为 0，最近一次在末尾；满了之后最近一次在 next 前面
+    const int n = int(recent.size());
+    return recent[((next - 1 - i) % n + n) % n];
+}
+
+QString SearchHistory::report(int lines) const
+{
+    if (count == 0) return "尚无查询记录";
+
+    QStringList out;
+    out.append(QString("本次会话共 %1 次查询，各阶段平均：").arg(count));
+    for (int p = 0; p < SearchTrace::PhaseCount; ++p) {
+        if (totals.nanos[p] == 0 && totals.explored[p] == 0) continue;
+        QString line = "  " + SearchTrace::phaseName(SearchTrace::Phase(p)) + " "
+                       + duration(totals.nanos[p] / qint64(count));
+        if (*exploredUnits[p])
+            line += QString("（%1 %2）").arg(totals.explored[p] / count).arg(exploredUnits[p]);
+        out.append(line);
+    }
+
+    QVector<qint64> totalsRecent;
+    totalsRecent.reserve(recent.size());
+    for (const SearchTrace& t : recent) totalsRecent.append(t.totalNanos());
+    std::sort(totalsRecent.begin(), totalsRecent.end());
+    auto percentile = [&](int pct) { return totalsRecent[(totalsRecent.size() - 1) * pct / 100]; };
+    out.append(QString("最近 %1 次总耗时：中位数 %2，p90 %3，最长 %4")
+                   .arg(totalsRecent.size()).arg(duration(percentile(50)), duration(percentile(90)),
+                                                duration(totalsRecent.last())));
+
+    const int shown = qMin(lines, size());
+    if (shown > 0) out.append(QString("最近 %1 次：").arg(shown));
+    for (int i = 0; i < shown; ++i) out.append("  " + at(i).query + "  " + at(i).summary());
+    return out.join('\n');
+}
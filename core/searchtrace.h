@@ -0,0 +1,85 @@
+#ifndef SEARCHTRACE_H
+#define SEARCHTRACE_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+// 一次查询各阶段的耗时与考察过的候选数，用来判断慢查询的时间花在哪里。
+// 引擎和各规划器只接收一个可为空的指针：为空时不读时钟也不写计数，
+// 候选数在局部变量里累加、阶段结束时才写入，关闭记录时几乎没有额外开销
+struct SearchTrace
+{
+    enum Phase {
+        Pareto,         // RAPTOR 按轮次求 Pareto 方案；候选为扫描的线路段
+        Patterns,       // 按预先算好的换乘模式求 Pareto 方案（代替 RAPTOR）；候选为求值的模式
+        Bound,          // 前 k 方案的下界：换乘段数，没有地标表时还有反向 Dijkstra；候选为扩展到的线路与出队的站点
+        Enumerate,      // 前 k 方案的分支限界；候选为展开的部分方案
+        Scan,           // 按时刻查询；候选为出队的站点
+        AStar,          // 以地标下界引导的 A* 最快方案；候选为出队的节点
+        Render,         // 生成结果 HTML
+        Display,        // 结果显示（界面线程）
+        PhaseCount
+    };
+
+    QString query;                          // "起点 → 终点"，未开启记录时为空
+    qint64 nanos[PhaseCount] = {};
+    quint64 explored[PhaseCount] = {};
+
+    static QString phaseName(Phase phase);
+    qint64 totalNanos() const;
+    // 一行摘要，只列出有耗时的阶段，如 "共 1.35 ms：Pareto 1.20 ms（312 段线路） · 渲染 150 µs"
+    QString summary() const;
+
+    // 作用域计时：构造时开始、析构时把耗时记到对应阶段；trace 为空时什么也不做
+    class Scope
+    {
+    public:
+        Scope(SearchTrace* trace, Phase phase) : trace(trace), phase(phase)
+        {
+            if (trace) timer.start();
+        }
+        ~Scope()
+        {
+            if (trace) trace->nanos[phase] += timer.nsecsElapsed();
+        }
+        void count(quint64 n)
+        {
+            if (trace) trace->explored[phase] += n;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        SearchTrace* trace;
+        Phase phase;
+        QElapsedTimer timer;
+    };
+};
+
+// 本次会话的查询记录：保留最近 capacity 次（环形缓冲），各阶段另有全部查询的累计
+class SearchHistory
+{
+public:
+    explicit SearchHistory(int capacity = 100);
+
+    void record(const SearchTrace& trace);
+    void clear();
+
+    int size() const { return int(recent.size()); }
+    // 0 为最近一次
+    const SearchTrace& at(int i) const;
+    quint64 recorded() const { return count; }
+
+    // 多行文本：全部查询各阶段的平均耗时与候选数、最近几次的总耗时分位数，以及最近 lines 次的摘要
+    QString report(int lines = 10) const;
+
+private:
+    QVector<SearchTrace> recent;
+    int capacity;
+    int next = 0;                   // 缓冲满后下一次覆盖的位置
+    quint64 count = 0;
+    SearchTrace totals;             // 全部查询的累计
+};
+
+#endif // SEARCHTRACE_H
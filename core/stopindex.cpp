@@ -0,0 +1,330 @@
+#include "stopindex.h"
+#include "pinyin.h"
+#include <QAtomicInteger>
+#include <QSet>
+#include <algorithm>
+#include <iterator>
+
+static QAtomicInteger<quint64> versionCounter;
+
+void StopIndex::GramIndex::build(const QVector<QString>& source)
+{
+    keys.clear();
+    keys.reserve(source.size());
+    grams.clear();
+    for (const QString& key : source) add(key);
+}
+
+void StopIndex::GramIndex::add(const QString& key)
+{
+    const int id = int(keys.size());
+    keys.append(key);
+    for (qsizetype i = 0; i < key.size(); ++i) {
+        for (qsizetype len = 1; len <= 2 && i + len <= key.size(); ++len) {
+            QVector<int>& list = grams[key.mid(i, len)];
+            // 同一个键内重复的字只记一次；按 id 递增插入，列表天然有序
+            if (list.isEmpty() || list.last() != id) list.append(id);
+        }
+    }
+}
+
+QVector<int> StopIndex::GramIndex::find(const QString& folded) const
+{
+    if (folded.isEmpty()) return {};
+    if (folded.size() == 1) return grams.value(folded);
+
+    // 收集输入中所有二字组的倒排表，从最短的开始求交集
+    QVector<const QVector<int>*> lists;
+    for (qsizetype i = 0; i + 2 <= folded.size(); ++i) {
+        auto it = grams.constFind(folded.mid(i, 2));
+        if (it == grams.constEnd()) return {};
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) {
+        return a->size() < b->size();
+    });
+
+    QVector<int> result = *lists.first();
+    QVector<int> next;
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        next.clear();
+        std::set_intersection(result.cbegin(), result.cend(), lists[i]->cbegin(), lists[i]->cend(),
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+    // 二字组都出现不代表连续出现，逐个确认
+    if (folded.size() > 2) filter(result, folded);
+    return result;
+}
+
+void StopIndex::GramIndex::filter(QVector<int>& ids, const QString& folded) const
+{
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&](int id) { return !keys[id].contains(folded); }),
+              ids.end());
+}
+
+bool StopIndex::GramIndex::fuzzy(const QString& folded, int tolerance, QVector<QPair<int, int>>& out) const
+{
+    QVector<const QVector<int>*> lists;
+    QSet<QString> seen;
+    for (qsizetype i = 0; i + 2 <= folded.size(); ++i) {
+        const QString gram = folded.mid(i, 2);
+        if (seen.contains(gram)) continue;
+        seen.insert(gram);
+        auto it = grams.constFind(gram);
+        if (it != grams.constEnd()) lists.append(&it.value());
+    }
+    // 编辑 tolerance 次至多让 2 * tolerance 种二字组整体消失
+    const int minShared = int(seen.size()) - 2 * tolerance;
+    if (minShared <= 0) return false;
+
+    QVector<quint8> shared(keys.size(), 0);
+    for (const QVector<int>* list : std::as_const(lists)) {
+        for (int id : *list) {
+            if (++shared[id] != minShared) continue;
+            const QString& key = keys[id];
+            if (qAbs(key.size() - folded.size()) > tolerance) continue;
+            const int d = editDistance(folded, key, tolerance);
+            if (d <= tolerance) out.append({ id, d });
+        }
+    }
+    return true;
+}
+
+void StopIndex::BkTree::build(const QVector<QString>& keys)
+{
+    nodes.clear();
+    for (int id = 0; id < keys.size(); ++id) insert(keys, id);
+}
+
+void StopIndex::BkTree::insert(const QVector<QString>& keys, int id)
+{
+    if (keys[id].isEmpty()) return;
+    if (nodes.isEmpty()) {
+        nodes.append(BkNode{ id, { id }, {}, 0 });
+        return;
+    }
+    int n = 0;
+    for (;;) {
+        const int d = editDistance(keys[id], keys[nodes[n].key]);
+        if (d == 0) {
+            nodes[n].ids.append(id);
+            return;
+        }
+        int child = -1;
+        for (const auto& c : std::as_const(nodes[n].children))
+            if (c.first == d) { child = c.second; break; }
+        if (child < 0) {
+            nodes[n].children.append({ d, int(nodes.size()) });
+            nodes[n].maxEdge = qMax(nodes[n].maxEdge, d);
+            nodes.append(BkNode{ id, { id }, {}, 0 });
+            return;
+        }
+        n = child;
+    }
+}
+
+void StopIndex::BkTree::query(const QVector<QString>& keys, const QString& text, int tolerance,
+                              QVector<QPair<int, int>>& out) const
+{
+    if (nodes.isEmpty()) return;
+    QVector<int> stack{ 0 };
+    while (!stack.isEmpty()) {
+        const BkNode& node = nodes[stack.takeLast()];
+        // 距离超过 maxEdge + tolerance 时既不匹配也不会有子树入选，算到这里就够了
+        const int d = editDistance(text, keys[node.key], node.maxEdge + tolerance);
+        if (d <= tolerance)
+            for (int id : node.ids) out.append({ id, d });
+        // 三角不等式：只有与本节点距离在 [d - tol, d + tol] 内的子树可能含有结果
+        for (const auto& c : node.children)
+            if (c.first >= d - tolerance && c.first <= d + tolerance) stack.append(c.second);
+    }
+}
+
+int StopIndex::editDistance(const QString& a, const QString& b, int limit)
+{
+    if (a.size() < b.size()) return editDistance(b, a, limit);
+    if (a.size() - b.size() > limit) return limit + 1;
+
+    // 站名很短，单行滚动数组放在栈上即可
+    constexpr int STACK_COLUMNS = 64;
+    int stackRow[STACK_COLUMNS + 1];
+    QVector<int> heapRow;
+    int* row = stackRow;
+    if (b.size() > STACK_COLUMNS) {
+        heapRow.resize(b.size() + 1);
+        row = heapRow.data();
+    }
+
+    for (int j = 0; j <= b.size(); ++j) row[j] = j;
+    for (int i = 1; i <= a.size(); ++i) {
+        int diag = row[0];
+        row[0] = i;
+        int rowMin = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            const int up = row[j];
+            row[j] = qMin(qMin(up, row[j - 1]) + 1, diag + (a[i - 1] == b[j - 1] ? 0 : 1));
+            diag = up;
+            rowMin = qMin(rowMin, row[j]);
+        }
+        if (rowMin > limit) return limit + 1;     // 这一行的最小值只会继续增大
+    }
+    return qMin(row[b.size()], limit + 1);
+}
+
+bool StopIndex::isAsciiKey(const QString& folded)
+{
+    for (QChar c : folded)
+        if (c.unicode() >= 0x80 || !c.isLetterOrNumber()) return false;
+    return !folded.isEmpty();
+}
+
+// 输入越长允许的错字越多；太短的输入容错只会带来噪声
+int StopIndex::tolerance(const QString& folded)
+{
+    return folded.size() <= 2 ? 0 : folded.size() <= 5 ? 1 : 2;
+}
+
+void StopIndex::build(const QVector<QString>& names)
+{
+    buildVersion = versionCounter.fetchAndAddRelaxed(1) + 1;
+    stopNames = names;
+    stopIds.clear();
+    stopIds.reserve(names.size());
+    for (int id = 0; id < names.size(); ++id) stopIds.insert(names[id], id);
+    removed.fill(false, names.size());
+    removedCount = 0;
+    ordered = true;
+
+    QVector<QString> folded;
+    QVector<QString> initials;
+    folded.reserve(names.size());
+    initials.reserve(names.size());
+    for (const QString& n : names) {
+        folded.append(fold(n));
+        initials.append(pinyinInitials(n));
+    }
+    nameKeys.build(folded);
+    initialKeys.build(initials);
+    nameTree.build(folded);
+    initialTree.build(initials);
+}
+
+void StopIndex::insert(const QString& name)
+{
+    const int existing = stopIds.value(name, -1);
+    if (existing >= 0) {
+        if (!removed[existing]) return;
+        removed[existing] = false;
+        --removedCount;
+    } else {
+        const int id = int(stopNames.size());
+        if (!stopNames.isEmpty() && !(stopNames.last() < name)) ordered = false;
+        stopNames.append(name);
+        stopIds.insert(name, id);
+        removed.append(false);
+        nameKeys.add(fold(name));
+        initialKeys.add(pinyinInitials(name));
+        nameTree.insert(nameKeys.keys, id);
+        initialTree.insert(initialKeys.keys, id);
+    }
+    buildVersion = versionCounter.fetchAndAddRelaxed(1) + 1;
+}
+
+void StopIndex::remove(const QString& name)
+{
+    const int id = stopIds.value(name, -1);
+    if (id < 0 || removed[id]) return;
+    removed[id] = true;
+    ++removedCount;
+    buildVersion = versionCounter.fetchAndAddRelaxed(1) + 1;
+}
+
+void StopIndex::dropRemoved(QVector<int>& ids) const
+{
+    if (removedCount == 0) return;
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [this](int id) { return removed[id]; }), ids.end());
+}
+
+QVector<int> StopIndex::find(const QString& text) const
+{
+    QVector<int> ids = nameKeys.find(fold(text));
+    dropRemoved(ids);
+    return ids;
+}
+
+void StopIndex::update(StopMatches& m, const QString& text) const
+{
+    const QString folded = fold(text);
+    const bool ascii = isAsciiKey(folded);
+    if (m.version == buildVersion && !m.query.isEmpty() && folded.contains(m.query)) {
+        // 新输入包含旧输入，匹配集合只会缩小
+        if (folded != m.query) {
+            nameKeys.filter(m.ids, folded);
+            initialKeys.filter(m.initialIds, folded);
+        }
+    } else {
+        m.ids = nameKeys.find(folded);
+        m.initialIds = ascii ? initialKeys.find(folded) : QVector<int>();
+        dropRemoved(m.ids);
+        dropRemoved(m.initialIds);
+    }
+    m.query = folded;
+    m.version = buildVersion;
+}
+
+QVector<int> StopIndex::suggest(const StopMatches& m, int limit) const
+{
+    if (m.query.isEmpty() || m.version != buildVersion) return {};
+
+    // 按匹配质量分档，档号越小越靠前；前五档由有序的 ids 生成，档内天然按下标有序。
+    // 0 站名完全相同  1 站名前缀  2 站名子串  3 首字母前缀  4 首字母子串
+    // 5、6 站名错 1、2 字  7、8 首字母错 1、2 字
+    constexpr int TIERS = 9;
+    QVector<int> tiers[TIERS];
+    for (int id : m.ids) {
+        const QString& key = nameKeys.keys[id];
+        tiers[key == m.query ? 0 : key.startsWith(m.query) ? 1 : 2].append(id);
+    }
+    for (int id : m.initialIds) {
+        if (std::binary_search(m.ids.cbegin(), m.ids.cend(), id)) continue;
+        tiers[initialKeys.keys[id].startsWith(m.query) ? 3 : 4].append(id);
+    }
+
+    const int exact = int(m.ids.size() + tiers[3].size() + tiers[4].size());
+    const int tol = tolerance(m.query);
+    if (exact < limit && tol > 0) {
+        QHash<int, int> fuzzyBest;      // 容错结果通常只有几个，用哈希去重即可
+        auto offer = [&](int id, int tier) {
+            if (removed[id] || std::binary_search(m.ids.cbegin(), m.ids.cend(), id)
+                || std::binary_search(m.initialIds.cbegin(), m.initialIds.cend(), id))
+                return;
+            auto it = fuzzyBest.find(id);
+            if (it == fuzzyBest.end()) fuzzyBest.insert(id, tier);
+            else if (tier < it.value()) it.value() = tier;
+        };
+        QVector<QPair<int, int>> fuzzy;
+        if (!nameKeys.fuzzy(m.query, tol, fuzzy)) nameTree.query(nameKeys.keys, m.query, tol, fuzzy);
+        for (const auto& f : std::as_const(fuzzy)) offer(f.first, 4 + f.second);
+        if (isAsciiKey(m.query)) {
+            fuzzy.clear();
+            if (!initialKeys.fuzzy(m.query, tol, fuzzy)) initialTree.query(initialKeys.keys, m.query, tol, fuzzy);
+            for (const auto& f : std::as_const(fuzzy)) offer(f.first, 6 + f.second);
+        }
+        for (auto it = fuzzyBest.cbegin(); it != fuzzyBest.cend(); ++it) tiers[it.value()].append(it.key());
+        for (int t = 5; t < TIERS; ++t) std::sort(tiers[t].begin(), tiers[t].end());
+    }
+    // 增量加入的站点编号在最后，档内按下标已不是给定的顺序，改按站名排（只排要用到的前 limit 个）
+    if (!ordered) {
+        for (QVector<int>& tier : tiers) {
+            const qsizetype head = qMin(qsizetype(limit), tier.size());
+            std::partial_sort(tier.begin(), tier.begin() + head, tier.end(),
+                              [this](int a, int b) { return stopNames[a] < stopNames[b]; });
+        }
+    }
+
+    QVector<int> ids;
+    for (int t = 0; t < TIERS && ids.size() < limit; ++t)
+        for (int i = 0; i < tiers[t].size() && ids.size() < limit; ++i) ids.append(tiers[t][i]);
+    return ids;
+}
@@ -0,0 +1,97 @@
+#ifndef STOPINDEX_H
+#define STOPINDEX_H
+
+#include <QVector>
+#include <QString>
+#include <QHash>
+#include <QPair>
+#include <climits>
+
+// 一次联想的匹配结果。用户继续输入、新输入包含上一次的输入时，
+// 只需在上一次的结果里继续过滤，不必回到全部站点
+struct StopMatches {
+    QString query;              // 已转成不区分大小写形式的输入
+    QVector<int> ids;           // 站名包含输入的站点下标，升序
+    QVector<int> initialIds;    // 拼音首字母包含输入的站点下标，升序；输入不是字母数字时为空
+    quint64 version = 0;        // 计算时所用索引的版本，索引重建后作废
+};
+
+// 站名索引：
+//  * 子串：对不区分大小写的站名与拼音首字母（“中央广场” -> “zygc”）分别建立单字与相邻二字的倒排表，
+//    查询时取各二字组倒排表的交集作为候选，再逐个确认包含关系，代价只与候选数相关；
+//  * 容错：精确匹配不足一屏时按输入长度允许 1~2 处错字。每处编辑至多破坏输入的两个二字组，
+//    所以输入较长时先按共有二字组的个数筛掉绝大多数站点再精确计算；
+//    输入太短、这个下界没有意义时，改查站名和拼音首字母各自的 BK 树（按编辑距离组织的度量树）
+//  * 增量：单个站点可以增删。新站点编号接在最后，各倒排表照样有序；删除只做标记，
+//    查询时跳过，同名站点再加回来时沿用原编号
+class StopIndex
+{
+public:
+    // names 的顺序即同等匹配质量下联想结果的顺序（调用方通常先排好序）
+    void build(const QVector<QString>& names);
+    // 加入或删除一个站点，代价与站名长度及 BK 树深度相关；已存在 / 不存在时什么都不做。
+    // 新站名排在已有站名之前时，同等匹配质量的联想结果改为按站名排序
+    void insert(const QString& name);
+    void remove(const QString& name);
+
+    int size() const { return stopNames.size(); }      // 含已删除的站点
+    const QString& name(int id) const { return stopNames[id]; }
+    const QString& initials(int id) const { return initialKeys.keys[id]; }
+
+    // 名字中包含 text 的全部站点（不区分大小写），按下标升序
+    QVector<int> find(const QString& text) const;
+    // 更新 m 为 text 的子串匹配结果，能在上一次结果上缩小时就不重新查索引
+    void update(StopMatches& m, const QString& text) const;
+    // 按匹配质量排序的至多 limit 个联想：站名完全相同、站名前缀、站名子串、首字母前缀、首字母子串，
+    // 不足 limit 个时再补上编辑距离在容许范围内的站名与首字母
+    QVector<int> suggest(const StopMatches& m, int limit) const;
+
+    // 两个串的编辑距离（插入、删除、替换各计 1）；超过 limit 时只保证返回值大于 limit
+    static int editDistance(const QString& a, const QString& b, int limit = INT_MAX / 2);
+
+private:
+    // 某一种键（站名或首字母）上的二字组倒排表
+    struct GramIndex {
+        QVector<QString> keys;
+        QHash<QString, QVector<int>> grams;     // 单字与二字组 -> 含有它的站点下标（升序、不重复）
+        void build(const QVector<QString>& source);
+        void add(const QString& key);           // 追加一个编号为 keys.size() 的键
+        QVector<int> find(const QString& folded) const;
+        void filter(QVector<int>& ids, const QString& folded) const;
+        // 编辑距离不超过 tolerance 的键；输入足够长时用二字组计数过滤，否则返回 false 交给 BK 树
+        bool fuzzy(const QString& folded, int tolerance, QVector<QPair<int, int>>& out) const;
+    };
+
+    // BK 树：子节点按与父节点的编辑距离分组；键相同的站点合并在同一节点
+    struct BkNode {
+        int key;                            // 代表站点下标（取键用）
+        QVector<int> ids;                   // 键与之相同的所有站点
+        QVector<QPair<int, int>> children;  // (与本节点的距离, 子节点下标)
+        int maxEdge;                        // children 中的最大距离
+    };
+    struct BkTree {
+        QVector<BkNode> nodes;
+        void build(const QVector<QString>& keys);
+        void insert(const QVector<QString>& keys, int id);
+        void query(const QVector<QString>& keys, const QString& text, int tolerance,
+                   QVector<QPair<int, int>>& out) const;     // 追加 (站点下标, 距离)
+    };
+
+    static QString fold(const QString& s) { return s.toCaseFolded(); }
+    static bool isAsciiKey(const QString& folded);
+    static int tolerance(const QString& folded);
+    void dropRemoved(QVector<int>& ids) const;
+
+    QVector<QString> stopNames;
+    QHash<QString, int> stopIds;        // 站名 -> 下标
+    QVector<bool> removed;              // 已删除的站点仍留在各索引里，查询时跳过
+    int removedCount = 0;
+    bool ordered = true;                // 下标顺序仍是 build() 时给定的顺序
+    GramIndex nameKeys;
+    GramIndex initialKeys;
+    BkTree nameTree;
+    BkTree initialTree;
+    quint64 buildVersion = 0;          // 每次 build()、insert()、remove() 都更换
+};
+
+#endif // STOPINDEX_H
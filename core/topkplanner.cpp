@@ -0,0 +1,261 @@
+#include "topkplanner.h"
+#include <algorithm>
+#include <climits>
+#include <queue>
+#include <vector>
+#include <functional>
+
+namespace {
+constexpr int INF = INT_MAX / 2;
+
+bool heapLess(const Journey& a, const Journey& b)
+{
+    return a.totalMinutes != b.totalMinutes ? a.totalMinutes < b.totalMinutes
+                                            : a.legs.size() < b.legs.size();
+}
+
+bool sameRoutes(const Journey& a, const Journey& b)
+{
+    if (a.legs.size() != b.legs.size()) return false;
+    for (int i = 0; i < a.legs.size(); ++i)
+        if (a.legs[i].route != b.legs[i].route) return false;
+    return true;
+}
+}
+
+TopKPlanner::TopKPlanner(const BusNetwork& network)
+    : net(network)
+{
+}
+
+// 线网每次修改都换版本号，站点与线路的编号可能随之变化，临时数组一并重新分配
+void TopKPlanner::prepareLayout()
+{
+    if (layoutVersion == net.version() && lowerBound.size() == net.stopCount()
+        && routeHops.size() == net.routeCount()) return;
+    layoutVersion = net.version();
+    lowerBound.fill(-1, net.stopCount());
+    stopHops.fill(-1, net.stopCount());
+    onPath.fill(false, net.stopCount());
+    routeHops.fill(TransferGraph::UNREACHABLE, net.routeCount());
+    touchedStops.clear();
+    touchedRoutes.clear();
+}
+
+// 上一次查询留下的改动；onPath 在回溯时已经清掉
+void TopKPlanner::reset()
+{
+    for (StopId s : std::as_const(touchedStops)) {
+        lowerBound[s] = -1;
+        stopHops[s] = -1;
+    }
+    for (int r : std::as_const(touchedRoutes)) routeHops[r] = TransferGraph::UNREACHABLE;
+    touchedStops.clear();
+    touchedRoutes.clear();
+}
+
+// 没有地标表时的下界：反向 Dijkstra，边为同一线路上相邻两站（双向），不计换乘时间，因此是可采纳的
+quint64 TopKPlanner::computeLowerBounds()
+{
+    quint64 settled = 0;
+    using Item = std::pair<int, StopId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    lowerBound[target] = 0;
+    touchedStops.append(target);
+    queue.push({0, target});
+
+    while (!queue.empty()) {
+        const auto [d, s] = queue.top();
+        queue.pop();
+        if (d > lowerBound[s]) continue;
+        ++settled;
+        for (const StopVisit& v : net.visitsAt(s)) {
+            const RouteView rv = net.route(v.route);
+            if (!rv.hasTravelTimes()) continue;
+            // 环线可能多次经过同一站，[pos, lastPos] 之间逐个确认
+            for (int p = int(v.pos); p <= int(v.lastPos); ++p) {
+                if (rv.stopAt(p) != s) continue;
+                for (int q : { p - 1, p + 1 }) {
+                    if (q < 0 || q >= rv.stopCount()) continue;
+                    const StopId t = rv.stopAt(q);
+                    const int nd = d + rv.travelTime(p, q);
+                    if (lowerBound[t] < 0) touchedStops.append(t);
+                    else if (nd >= lowerBound[t]) continue;
+                    lowerBound[t] = nd;
+                    queue.push({nd, t});
+                }
+            }
+        }
+    }
+    return settled;
+}
+
+// 与 TransferGraph::hopsTo() 相同的广度优先，但只扩展到 maxDepth 段：更远的线路反正不会展开
+quint64 TopKPlanner::computeRouteHops()
+{
+    for (const StopVisit& v : net.visitsAt(target)) {
+        if (routeHops[v.route] != TransferGraph::UNREACHABLE) continue;     // 环线多次经过终点
+        routeHops[v.route] = 1;
+        touchedRoutes.append(int(v.route));
+    }
+    for (qsizetype head = 0; head < touchedRoutes.size(); ++head) {
+        const int r = touchedRoutes[head];
+        if (routeHops[r] >= maxDepth) continue;
+        for (const TransferLink& e : net.transfers().links(r)) {
+            if (routeHops[e.route] != TransferGraph::UNREACHABLE) continue;
+            routeHops[e.route] = routeHops[r] + 1;
+            touchedRoutes.append(int(e.route));
+        }
+    }
+    return quint64(touchedRoutes.size());
+}
+
+int TopKPlanner::boundAt(StopId stop)
+{
+    int& h = lowerBound[stop];
+    if (h < 0) {
+        // 有反向 Dijkstra 时没到过的站就是不可达
+        h = INF;
+        if (guide) {
+            const int b = guide->lowerBound(stop, target);
+            if (b < LandmarkTable::UNREACHABLE) h = b;
+        }
+        touchedStops.append(stop);
+    }
+    return h;
+}
+
+int TopKPlanner::hopsAt(StopId stop)
+{
+    int& h = stopHops[stop];
+    if (h < 0) {
+        h = TransferGraph::UNREACHABLE;
+        const StopVisitRange range = net.visitsAt(stop);
+        if (range.size() >= 2)
+            for (const StopVisit& v : range) h = qMin(h, routeHops[v.route]);
+        touchedStops.append(stop);
+    }
+    return h;
+}
+
+// 同一线路组合只保留更快的一个；否则在堆未满或优于堆顶时放入
+void TopKPlanner::offer(const Journey& j)
+{
+    for (int i = 0; i < heap.size(); ++i) {
+        if (!sameRoutes(heap[i], j)) continue;
+        if (heapLess(j, heap[i])) {
+            heap[i] = j;
+            std::make_heap(heap.begin(), heap.end(), heapLess);
+        }
+        return;
+    }
+    if (!full()) {
+        heap.append(j);
+        std::push_heap(heap.begin(), heap.end(), heapLess);
+    } else if (heapLess(j, heap.first())) {
+        std::pop_heap(heap.begin(), heap.end(), heapLess);
+        heap.last() = j;
+        std::push_heap(heap.begin(), heap.end(), heapLess);
+    }
+}
+
+void TopKPlanner::search(StopId stop, int minutes, int depth, int lastRoute)
+{
+    if (cancelToken && cancelToken->isCancelled()) return;
+    if (full() && minutes + boundAt(stop) >= worst()) return;
+    ++expanded;
+
+    const int penalty = depth > 0 ? TRANSFER_MINUTES : 0;
+    QVector<Candidate>& cands = levels[depth];
+    cands.clear();
+
+    for (const StopVisit& v : net.visitsAt(stop)) {
+        const int r = int(v.route);
+        if (r == lastRoute) continue;   // 刚下的车再上回去不会更好
+        if (depth + routeHops[r] > maxDepth) continue;
+        const RouteView rv = net.route(r);
+        if (!rv.hasTravelTimes()) continue;
+        for (int b = int(v.pos); b <= int(v.lastPos); ++b) {
+            if (rv.stopAt(b) != stop) continue;
+            for (int dir : { 1, -1 }) {
+                for (int i = b + dir; i >= 0 && i < rv.stopCount(); i += dir) {
+                    const StopId t = rv.stopAt(i);
+                    const int g = minutes + penalty + rv.travelTime(b, i);
+                    if (t == target) {
+                        path.append(JourneyLeg{r, b, i});
+                        Journey j;
+                        j.legs = path;
+                        j.totalMinutes = g;
+                        offer(j);
+                        path.removeLast();
+                        break;      // 经过终点再折返不会更好
+                    }
+                    if (onPath[t] || depth + 1 + hopsAt(t) > maxDepth) continue;
+                    const int h = boundAt(t);
+                    if (h >= INF) continue;
+                    const int bound = g + h;
+                    if (full() && bound >= worst()) continue;
+                    cands.append(Candidate{t, g, bound, r, b, i});
+                }
+            }
+        }
+    }
+
+    // 代价优先：下界小的先展开，越早填满堆，后面的剪枝越有效
+    std::sort(cands.begin(), cands.end(), [](const Candidate& a, const Candidate& b) {
+        return a.bound < b.bound;
+    });
+    // 更深的层使用各自的 levels[depth + 1]，本层数组在递归中保持不变
+    for (const Candidate& c : std::as_const(cands)) {
+        if (full() && c.bound >= worst()) break;    // 已排序，其余的都更差
+        path.append(JourneyLeg{c.route, c.fromPos, c.toPos});
+        onPath[c.stop] = true;
+        search(c.stop, c.minutes, depth + 1, c.route);
+        onPath[c.stop] = false;
+        path.removeLast();
+    }
+}
+
+QVector<Journey> TopKPlanner::plan(StopId from, StopId to, int k, int maxLegs, const LandmarkTable& landmarks,
+                                   const QVector<Journey>& seeds, const CancelToken* cancel,
+                                   SearchTrace* trace)
+{
+    heap.clear();
+    if (k <= 0 || maxLegs <= 0 || from == to
+        || from >= StopId(net.stopCount()) || to >= StopId(net.stopCount())) return {};
+
+    prepareLayout();
+    reset();
+    target = to;
+    limit = k;
+    maxDepth = maxLegs;
+    cancelToken = cancel;
+    guide = landmarks.stopCount() == net.stopCount() ? &landmarks : nullptr;
+    {
+        SearchTrace::Scope phase(trace, SearchTrace::Bound);
+        quint64 visited = computeRouteHops();
+        if (!guide) visited += computeLowerBounds();
+        phase.count(visited);
+        if (boundAt(from) >= INF) return {};
+    }
+
+    levels.resize(maxLegs);
+    path.clear();
+    for (const Journey& j : seeds) {
+        if (j.legs.size() <= maxLegs) offer(j);
+    }
+
+    onPath[from] = true;
+    expanded = 0;
+    {
+        SearchTrace::Scope phase(trace, SearchTrace::Enumerate);
+        search(from, 0, 0, -1);
+        phase.count(expanded);
+    }
+    onPath[from] = false;
+    if (cancel && cancel->isCancelled()) return {};
+
+    QVector<Journey> result = heap;
+    std::sort(result.begin(), result.end(), heapLess);
+    return result;
+}
@@ -0,0 +1,76 @@
+#ifndef TOPKPLANNER_H
+#define TOPKPLANNER_H
+
+#include "network.h"
+#include "journey.h"
+#include "landmarks.h"
+#include "canceltoken.h"
+#include "searchtrace.h"
+#include <QVector>
+
+// 总时间最短的前 k 个方案（不同线路组合各取最优的一个换乘点）。
+// 从起点做深度优先的分支限界：每层候选按 g + h 升序展开（h 为该站到终点不计换乘的时间下界），
+// 结果放在容量为 k 的大顶堆里，堆满之后 g + h 不小于堆顶的分支整批剪掉。
+// h 取自 LandmarkTable，只在搜索碰到某站时才算；没有与线网对应的地标表时，退回从终点反向做一次 Dijkstra。
+// 另外按换乘图求出各线路到终点的最少段数（只向外扩展到 maxLegs 段），剩余段数不够的线路和换乘站不展开；
+// 只有一条线路经过的站无处换乘，也不作为候选。
+// 与 AltPlanner 一样，临时数组只在线网变化时整体分配，每次查询只复位上一次改动过的元素。
+// 只产出紧凑的 Journey 描述，不涉及任何文本；和 RaptorPlanner 一样每个线程各用一个实例。
+class TopKPlanner
+{
+public:
+    static constexpr int TRANSFER_MINUTES = 3;
+
+    explicit TopKPlanner(const BusNetwork& network);
+
+    // 按总时间升序返回至多 k 个方案；maxLegs 为单个方案最多乘坐的段数。
+    // landmarks 与线网不对应（如为空或增量修改后还没重算）时改用反向 Dijkstra，结果相同。
+    // seeds 为已知的可行方案（例如 RAPTOR 的 Pareto 集），先放进堆里，使剪枝从一开始就生效。
+    // trace 非空时分别记录求下界（SearchTrace::Bound）与分支限界（SearchTrace::Enumerate）两个阶段
+    QVector<Journey> plan(StopId from, StopId to, int k, int maxLegs, const LandmarkTable& landmarks,
+                          const QVector<Journey>& seeds = {}, const CancelToken* cancel = nullptr,
+                          SearchTrace* trace = nullptr);
+
+private:
+    struct Candidate {
+        StopId stop;
+        int minutes;        // 到达该站时的累计时间 g
+        int bound;          // g + h
+        int route;
+        int fromPos;
+        int toPos;
+    };
+
+    void prepareLayout();
+    void reset();
+    quint64 computeLowerBounds();                   // 反向 Dijkstra，返回出队的站点数
+    quint64 computeRouteHops();                     // 返回扩展到的线路数
+    int boundAt(StopId stop);
+    int hopsAt(StopId stop);
+    void search(StopId stop, int minutes, int depth, int lastRoute);
+    void offer(const Journey& j);
+    bool full() const { return heap.size() >= limit; }
+    int worst() const { return heap.first().totalMinutes; }
+
+    const BusNetwork& net;
+    StopId target = INVALID_STOP;
+    int limit = 0;
+    int maxDepth = 0;
+    const CancelToken* cancelToken = nullptr;
+    const LandmarkTable* guide = nullptr;   // 为空时下界由 computeLowerBounds() 事先填好
+    quint64 expanded = 0;                   // 本次查询展开的部分方案数
+
+    // 以下数组只在线网变化时整体分配；查询结束后留着，下次开始时按 touched 只复位改动过的元素
+    quint64 layoutVersion = 0;
+    QVector<int> lowerBound;                // 各站到终点的时间下界，-1 表示还没算过，不可达为 INF
+    QVector<int> stopHops;                  // 在该站换乘后至少还要乘几段车，-1 表示还没算过；无处换乘为 UNREACHABLE
+    QVector<StopId> touchedStops;
+    QVector<int> routeHops;                 // 各线路到终点至少要乘几段车，超过 maxLegs 的一律为 UNREACHABLE
+    QVector<int> touchedRoutes;
+    QVector<bool> onPath;                   // 当前部分方案经过的换乘站，避免绕圈；回溯时逐个清掉
+    QVector<QVector<Candidate>> levels;     // 每层复用的候选数组
+    QVector<JourneyLeg> path;
+    QVector<Journey> heap;                  // 以 totalMinutes 为键的大顶堆，容量 limit
+};
+
+#endif // TOPKPLANNER_H
@@ -0,0 +1,118 @@
+#include "transfergraph.h"
+#include "network.h"
+#include <algorithm>
+
+static bool linkLess(const TransferLink& a, const TransferLink& b)
+{
+    return a.route != b.route ? a.route < b.route : a.fromPos < b.fromPos;
+}
+
+void TransferGraph::clear()
+{
+    routeLinks.clear();
+}
+
+void TransferGraph::build(const BusNetwork& network)
+{
+    clear();
+    routeLinks.resize(network.routeCount());
+
+    // 每个站点上的经停线路两两组合成一条换乘记录，再在各线路内排序
+    for (int s = 0; s < network.stopCount(); ++s) {
+        const StopVisitRange range = network.visitsAt(StopId(s));
+        if (range.size() < 2) continue;
+        for (const StopVisit& a : range) {
+            QVector<TransferLink>& out = routeLinks[a.route];
+            for (const StopVisit& b : range) {
+                if (a.route != b.route) out.append({ b.route, quint32(s), a.pos, b.pos });
+            }
+        }
+    }
+    for (QVector<TransferLink>& links : routeLinks) std::sort(links.begin(), links.end(), linkLess);
+}
+
+// 由倒排索引收集 route 当前的全部换乘记录（已排序）
+void TransferGraph::collect(const BusNetwork& network, int route, QVector<TransferLink>& out) const
+{
+    out.clear();
+    const RouteView rv = network.route(route);
+    for (int i = 0; i < rv.stopCount(); ++i) {
+        const StopId s = rv.stopAt(i);
+        const StopVisitRange range = network.visitsAt(s);
+        if (range.size() < 2) continue;
+        if (network.positionOf(s, route) != i) continue;    // 环线重复经过的站只取首次
+        for (const StopVisit& v : range) {
+            if (v.route != quint32(route)) out.append({ v.route, s, quint32(i), v.pos });
+        }
+    }
+    std::sort(out.begin(), out.end(), linkLess);
+}
+
+void TransferGraph::updateRoute(const BusNetwork& network, int route)
+{
+    if (routeLinks.size() < network.routeCount()) routeLinks.resize(network.routeCount());
+    const quint32 self = quint32(route);
+    auto peerRun = [self](QVector<TransferLink>& links) {
+        return std::equal_range(links.begin(), links.end(), TransferLink{ self, 0, 0, 0 },
+                                [](const TransferLink& a, const TransferLink& b) { return a.route < b.route; });
+    };
+
+    // 先从旧的相邻线路里摘掉指向 route 的那一段
+    const QVector<TransferLink> old = routeLinks[route];
+    for (qsizetype i = 0; i < old.size(); ++i) {
+        if (i > 0 && old[i].route == old[i - 1].route) continue;
+        QVector<TransferLink>& peer = routeLinks[old[i].route];
+        const auto run = peerRun(peer);
+        peer.erase(run.first, run.second);
+    }
+
+    // 再按新的站点序列重算，并把反向记录插回各相邻线路
+    QVector<TransferLink>& links = routeLinks[route];
+    collect(network, route, links);
+    QVector<TransferLink> reverse;
+    for (qsizetype i = 0; i < links.size();) {
+        const quint32 peerRoute = links[i].route;
+        reverse.clear();
+        for (; i < links.size() && links[i].route == peerRoute; ++i)
+            reverse.append({ self, links[i].stop, links[i].toPos, links[i].fromPos });
+        std::sort(reverse.begin(), reverse.end(), linkLess);
+        QVector<TransferLink>& peer = routeLinks[peerRoute];
+        const auto at = peerRun(peer).first - peer.begin();
+        peer.insert(at, reverse.size(), TransferLink{});
+        std::copy(reverse.cbegin(), reverse.cend(), peer.begin() + at);
+    }
+}
+
+TransferRange<TransferLink> TransferGraph::links(int route) const
+{
+    if (route < 0 || route >= routeLinks.size()) return {};
+    const QVector<TransferLink>& v = routeLinks[route];
+    return { v.constData(), v.constData() + v.size() };
+}
+
+TransferRange<TransferLink> TransferGraph::between(int a, int b) const
+{
+    const TransferRange<TransferLink> range = links(a);
+    const auto run = std::equal_range(range.begin(), range.end(), TransferLink{ quint32(b), 0, 0, 0 },
+                                      [](const TransferLink& x, const TransferLink& y) { return x.route < y.route; });
+    return { run.first, run.second };
+}
+
+void TransferGraph::hopsTo(const BusNetwork& network, quint32 target, QVector<int>& hops) const
+{
+    hops.fill(UNREACHABLE, network.routeCount());
+    QVector<int> queue;
+    for (const StopVisit& v : network.visitsAt(target)) {
+        hops[v.route] = 1;
+        queue.append(int(v.route));
+    }
+    // 记录是对称的，从终点线路向外扩展即得各线路的最少段数
+    for (qsizetype head = 0; head < queue.size(); ++head) {
+        const int r = queue[head];
+        for (const TransferLink& e : links(r)) {
+            if (hops[e.route] != UNREACHABLE) continue;
+            hops[e.route] = hops[r] + 1;
+            queue.append(int(e.route));
+        }
+    }
+}
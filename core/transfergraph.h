@@ -0,0 +1,60 @@
+#ifndef TRANSFERGRAPH_H
+#define TRANSFERGRAPH_H
+
+#include <QVector>
+
+class BusNetwork;
+
+// 从某线路换乘到 route 的一个共同站点，及其在两条线路上的位置（首次出现）
+struct TransferLink {
+    quint32 route;      // 对方线路
+    quint32 stop;
+    quint32 fromPos;    // 在出发线路上的位置
+    quint32 toPos;      // 在对方线路上的位置
+};
+
+// 只读的连续区间，与 StopVisitRange 的用法相同
+template <typename T>
+struct TransferRange {
+    const T* first = nullptr;
+    const T* last = nullptr;
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    qsizetype size() const { return last - first; }
+    bool isEmpty() const { return first == last; }
+};
+
+// 线路级换乘图：节点是线路，两条线路有共同站点就相连，每个共同站点记一条换乘记录。
+// 每条线路的记录单独存放，按 (对方线路, 本线路位置) 升序，同一对方线路的记录连成一段；
+// 改动一条线路时只需重排它自己的记录，并在各相邻线路的记录里替换与它相连的那一段。
+// 查询时用它先算出各线路到终点至少还要乘几段车，提前剪掉换乘次数上限内不可能到达终点的线路组合；
+// 界面也用它列出与某条线路相接的线路。
+class TransferGraph
+{
+public:
+    static constexpr int UNREACHABLE = 0x3FFFFFFF;
+
+    void build(const BusNetwork& network);
+    void clear();
+    // 线路 route 的站点或经停记录变化后（含新增、删除），重算与它相连的换乘记录；
+    // 代价与它的相邻线路的记录数成正比
+    void updateRoute(const BusNetwork& network, int route);
+
+    // 从 route 出发的全部换乘记录
+    TransferRange<TransferLink> links(int route) const;
+    // 线路 a 与 b 之间的全部换乘站（fromPos 为在 a 上的位置）；O(log a 的记录数)
+    TransferRange<TransferLink> between(int a, int b) const;
+
+    // 从每条线路上车算起，到达 target 至少要乘几段车（经过 target 的线路为 1），不可达为 UNREACHABLE。
+    // 按线路图广度优先，O(线路数 + 记录数)
+    void hopsTo(const BusNetwork& network, quint32 target, QVector<int>& hops) const;
+
+private:
+    friend class NetworkSnapshot;
+
+    void collect(const BusNetwork& network, int route, QVector<TransferLink>& out) const;
+
+    QVector<QVector<TransferLink>> routeLinks;
+};
+
+#endif // TRANSFERGRAPH_H
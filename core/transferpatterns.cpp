@@ -0,0 +1,465 @@
+#include "transferpatterns.h"
+#include "raptor.h"
+#include "landmarks.h"
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'B', 'U', 'S', 'T', 'P', 'A', 'T', '\0' };
+constexpr quint32 BYTE_ORDER_MARK = 0x01020304;
+constexpr int HASH_BYTES = 32;
+
+struct Header {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 byteOrder;
+    char networkHash[HASH_BYTES];
+    quint32 stopCount;
+    quint32 originCount;
+};
+
+// 每个起点一条，其后依次是 nodeStops、nodeParents、targets、leaves
+struct OriginRecord {
+    quint32 origin;
+    quint32 nodeCount;
+    quint32 targetCount;
+};
+
+static_assert(sizeof(Header) == 56, "transfer pattern header layout");
+static_assert(sizeof(OriginRecord) == 12, "transfer pattern record layout");
+
+} // namespace
+
+TransferPatterns TransferPatterns::compute(const BusNetwork& network, const QVector<StopId>& origins,
+                                           const CancelToken* cancel)
+{
+    TransferPatterns result;
+    result.origins.resize(network.stopCount());
+    RaptorPlanner planner(network);
+    for (StopId origin : origins) {
+        if (cancel && cancel->isCancelled()) break;
+        OriginPatterns o = patternsFrom(network, planner, origin, cancel);
+        if (cancel && cancel->isCancelled()) break;     // 算到一半的起点不要
+        result.origins[origin] = o;
+    }
+    return result;
+}
+
+// 一次一对多 RAPTOR：每个到达某站的 Pareto 方案取其各段上车站，插入前缀树
+TransferPatterns::OriginPatterns TransferPatterns::patternsFrom(const BusNetwork& network, RaptorPlanner& planner,
+                                                                StopId origin, const CancelToken* cancel)
+{
+    OriginPatterns o;
+    o.nodeStops.append(origin);
+    o.nodeParents.append(NO_PARENT);
+    QHash<quint64, quint32> children;
+    auto child = [&](quint32 parent, StopId stop) {
+        const quint64 key = (quint64(parent) << 32) | stop;
+        const quint32 existing = children.value(key, NO_PARENT);
+        if (existing != NO_PARENT) return existing;
+        const quint32 node = quint32(o.nodeStops.size());
+        o.nodeStops.append(stop);
+        o.nodeParents.append(parent);
+        children.insert(key, node);
+        return node;
+    };
+
+    QVector<std::pair<StopId, quint32>> ends;
+    planner.planAll(origin, [&](StopId stop, const Journey& j) {
+        quint32 node = 0;
+        for (int i = 1; i < j.legs.size(); ++i)
+            node = child(node, network.route(j.legs[i].route).stopAt(j.legs[i].fromPos));
+        ends.append({ stop, child(node, stop) });
+    }, -1, cancel);
+
+    // 回调按轮次先后发生，稳定排序后同一终点的方案仍按段数升序
+    std::stable_sort(ends.begin(), ends.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    o.targets.reserve(ends.size());
+    o.leaves.reserve(ends.size());
+    for (const auto& [stop, leaf] : std::as_const(ends)) {
+        o.targets.append(stop);
+        o.leaves.append(leaf);
+    }
+    o.nodeStops.squeeze();
+    o.nodeParents.squeeze();
+    return o;
+}
+
+void TransferPatterns::clear()
+{
+    origins.clear();
+    pending.clear();
+    requested.clear();
+    lastUsed.clear();
+}
+
+void TransferPatterns::merge(const TransferPatterns& other)
+{
+    if (origins.size() < other.origins.size()) origins.resize(other.origins.size());
+    for (int s = 0; s < other.origins.size(); ++s)
+        if (!other.origins[s].nodeStops.isEmpty()) origins[s] = other.origins[s];
+    pending = other.pending;
+    // 最近使用时间以本表为准：副本取出之后这里可能又记下了查询
+    if (lastUsed.size() < other.lastUsed.size()) lastUsed.resize(other.lastUsed.size());
+    for (int s = 0; s < other.lastUsed.size(); ++s) lastUsed[s] = qMax(lastUsed[s], other.lastUsed[s]);
+    clock = qMax(clock, other.clock);
+    requested.removeIf([this](StopId s) { return s < StopId(origins.size()) && !origins[s].nodeStops.isEmpty(); });
+    trim();
+}
+
+void TransferPatterns::request(StopId origin)
+{
+    if (origin == INVALID_STOP) return;
+    if (lastUsed.size() <= qsizetype(origin)) lastUsed.resize(qsizetype(origin) + 1);
+    lastUsed[origin] = ++clock;
+    const bool computed = origin < StopId(origins.size()) && !origins[origin].nodeStops.isEmpty();
+    if (!computed && !requested.contains(origin)) requested.append(origin);
+}
+
+QVector<StopId> TransferPatterns::wantedOrigins(const BusNetwork& network) const
+{
+    QVector<StopId> wanted;
+    for (StopId s : requested)
+        if (s < StopId(network.stopCount()) && network.stopInUse(s) && !covers(s)) wanted.append(s);
+    for (StopId s = 0; s < StopId(origins.size()); ++s) {
+        const OriginPatterns& o = origins[s];
+        if (!o.nodeStops.isEmpty() && o.stale && s < StopId(network.stopCount()) && network.stopInUse(s))
+            wanted.append(s);
+    }
+    return wanted;
+}
+
+bool TransferPatterns::covers(StopId origin) const
+{
+    return pending.isEmpty() && origin < StopId(origins.size()) && !origins[origin].nodeStops.isEmpty()
+           && !origins[origin].stale;
+}
+
+int TransferPatterns::originCount() const
+{
+    int n = 0;
+    for (StopId s = 0; s < StopId(origins.size()); ++s)
+        if (covers(s)) ++n;
+    return n;
+}
+
+qsizetype TransferPatterns::bytesOf(const OriginPatterns& o)
+{
+    return qsizetype(sizeof(OriginPatterns))
+           + (o.nodeStops.size() + o.nodeParents.size() + o.targets.size() + o.leaves.size()) * qsizetype(sizeof(quint32));
+}
+
+qsizetype TransferPatterns::memoryBytes() const
+{
+    qsizetype n = 0;
+    for (const OriginPatterns& o : origins)
+        if (!o.nodeStops.isEmpty()) n += bytesOf(o);
+    return n;
+}
+
+void TransferPatterns::trim()
+{
+    qsizetype total = memoryBytes();
+    if (total <= memoryLimit) return;
+    QVector<StopId> held;
+    for (StopId s = 0; s < StopId(origins.size()); ++s)
+        if (!origins[s].nodeStops.isEmpty()) held.append(s);
+    auto usedAt = [this](StopId s) { return s < StopId(lastUsed.size()) ? lastUsed[s] : 0; };
+    std::sort(held.begin(), held.end(), [&](StopId a, StopId b) { return usedAt(a) < usedAt(b); });
+    for (int i = 0; i + 1 < held.size() && total > memoryLimit; ++i) {
+        total -= bytesOf(origins[held[i]]);
+        origins[held[i]] = OriginPatterns();
+    }
+}
+
+bool TransferPatterns::save(const QString& fileName, const BusNetwork& network) const
+{
+    if (hasPendingEdits()) return false;
+    // 按最近使用从旧到新写，读回时据此恢复先后
+    QVector<StopId> held;
+    for (StopId s = 0; s < StopId(origins.size()); ++s)
+        if (covers(s)) held.append(s);
+    auto usedAt = [this](StopId s) { return s < StopId(lastUsed.size()) ? lastUsed[s] : 0; };
+    std::stable_sort(held.begin(), held.end(), [&](StopId a, StopId b) { return usedAt(a) < usedAt(b); });
+
+    Header h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.formatVersion = FORMAT_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    const QByteArray hash = LandmarkTable::fingerprint(network);
+    std::memcpy(h.networkHash, hash.constData(), size_t(qMin(int(hash.size()), HASH_BYTES)));
+    h.stopCount = quint32(network.stopCount());
+    h.originCount = quint32(held.size());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    auto write = [&file](const auto& v) {
+        file.write(reinterpret_cast<const char*>(v.constData()), v.size() * qsizetype(sizeof(quint32)));
+    };
+    file.write(reinterpret_cast<const char*>(&h), sizeof h);
+    for (StopId s : std::as_const(held)) {
+        const OriginPatterns& o = origins[s];
+        const OriginRecord record{ s, quint32(o.nodeStops.size()), quint32(o.targets.size()) };
+        file.write(reinterpret_cast<const char*>(&record), sizeof record);
+        write(o.nodeStops);
+        write(o.nodeParents);
+        write(o.targets);
+        write(o.leaves);
+    }
+    return file.commit();
+}
+
+bool TransferPatterns::load(const QString& fileName, const BusNetwork& network, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail(file.errorString());
+    const qint64 size = file.size();
+    const uchar* data = size >= qint64(sizeof(Header)) ? file.map(0, size) : nullptr;
+    if (!data) return fail("无法映射换乘模式文件");
+
+    Header h;
+    std::memcpy(&h, data, sizeof h);
+    if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0) return fail("不是换乘模式文件");
+    if (h.formatVersion != FORMAT_VERSION || h.byteOrder != BYTE_ORDER_MARK) return fail("换乘模式文件格式版本不符");
+
+    const QByteArray current = LandmarkTable::fingerprint(network);
+    if (h.stopCount != quint32(network.stopCount())
+        || std::memcmp(h.networkHash, current.constData(), size_t(qMin(int(current.size()), HASH_BYTES))) != 0)
+        return fail("换乘模式文件已过期");
+
+    // 顺序读出各起点；数组长度、下标都核对一遍，损坏的文件整份不用
+    qint64 offset = sizeof(Header);
+    auto read = [&](QVector<quint32>& out, quint32 count) {
+        const qint64 bytes = qint64(count) * qint64(sizeof(quint32));
+        if (offset + bytes > size) return false;
+        out.resize(count);
+        if (count) std::memcpy(out.data(), data + offset, size_t(bytes));
+        offset += bytes;
+        return true;
+    };
+    QVector<OriginPatterns> loaded(network.stopCount());
+    QVector<quint64> used(network.stopCount(), 0);
+    for (quint32 i = 0; i < h.originCount; ++i) {
+        OriginRecord record;
+        if (offset + qint64(sizeof record) > size) return fail("换乘模式文件已损坏");
+        std::memcpy(&record, data + offset, sizeof record);
+        offset += sizeof record;
+        if (record.origin >= h.stopCount || record.nodeCount == 0) return fail("换乘模式文件已损坏");
+        OriginPatterns o;
+        if (!read(o.nodeStops, record.nodeCount) || !read(o.nodeParents, record.nodeCount)
+            || !read(o.targets, record.targetCount) || !read(o.leaves, record.targetCount))
+            return fail("换乘模式文件已损坏");
+        if (o.nodeStops[0] != record.origin || o.nodeParents[0] != NO_PARENT) return fail("换乘模式文件已损坏");
+        for (quint32 n = 0; n < record.nodeCount; ++n) {
+            if (o.nodeStops[n] >= h.stopCount || (n > 0 && o.nodeParents[n] >= n)) return fail("换乘模式文件已损坏");
+        }
+        for (quint32 t = 0; t < record.targetCount; ++t) {
+            if (o.targets[t] >= h.stopCount || o.leaves[t] >= record.nodeCount
+                || (t > 0 && o.targets[t] < o.targets[t - 1]))
+                return fail("换乘模式文件已损坏");
+        }
+        loaded[record.origin] = o;
+        used[record.origin] = i + 1;
+    }
+    if (offset != size) return fail("换乘模式文件已损坏");
+
+    origins = loaded;
+    pending.clear();
+    requested.removeIf([this](StopId s) { return s < StopId(origins.size()) && !origins[s].nodeStops.isEmpty(); });
+    // 读入的起点按文件中的先后排在本表已有的最近使用时间之前
+    for (int s = 0; s < lastUsed.size() && s < used.size(); ++s)
+        if (lastUsed[s]) used[s] = lastUsed[s] + h.originCount;
+    lastUsed = used;
+    clock += h.originCount;
+    return true;
+}
+
+int TransferPatterns::directLeg(const BusNetwork& network, StopId a, StopId b, int excludeRoute, JourneyLeg* leg)
+{
+    int best = UNREACHABLE;
+    const StopVisitRange arrivals = network.visitsAt(b);
+    for (const StopVisit& v : network.visitsAt(a)) {
+        if (int(v.route) == excludeRoute) continue;
+        const RouteView rv = network.route(int(v.route));
+        if (!rv.hasTravelTimes()) continue;
+        // 两站的经停记录都按线路下标升序
+        const StopVisit* w = std::lower_bound(arrivals.begin(), arrivals.end(), v.route,
+                                              [](const StopVisit& x, quint32 r) { return x.route < r; });
+        if (w == arrivals.end() || w->route != v.route) continue;
+        // 环线可能多次经过同一站，各位置两两比较
+        for (int p = int(v.pos); p <= int(v.lastPos); ++p) {
+            if (rv.stopAt(p) != a) continue;
+            for (int q = int(w->pos); q <= int(w->lastPos); ++q) {
+                if (rv.stopAt(q) != b) continue;
+                const int minutes = rv.travelTime(p, q);
+                if (minutes < best) {
+                    best = minutes;
+                    if (leg) *leg = JourneyLeg{ int(v.route), p, q };
+                }
+            }
+        }
+    }
+    return best;
+}
+
+int TransferPatterns::evaluate(const BusNetwork& network, const OriginPatterns& o, quint32 leaf, int excludeRoute,
+                               Journey* journey)
+{
+    QVector<StopId> stops;      // 终点在前
+    for (quint32 n = leaf; n != NO_PARENT; n = o.nodeParents[n]) stops.append(o.nodeStops[n]);
+
+    int total = TRANSFER_MINUTES * (int(stops.size()) - 2);
+    JourneyLeg leg{ -1, -1, -1 };
+    for (int i = int(stops.size()) - 1; i > 0; --i) {
+        const int minutes = directLeg(network, stops[i], stops[i - 1], excludeRoute, journey ? &leg : nullptr);
+        if (minutes >= UNREACHABLE) return UNREACHABLE;
+        total += minutes;
+        if (journey) journey->legs.append(leg);
+    }
+    if (journey) journey->totalMinutes = total;
+    return total;
+}
+
+void TransferPatterns::frontier(const BusNetwork& network, const OriginPatterns& o, StopId target,
+                                int excludeRoute, QVector<Evaluation>& out)
+{
+    out.clear();
+    const auto range = std::equal_range(o.targets.begin(), o.targets.end(), target);
+    for (auto it = range.first; it != range.second; ++it) {
+        const quint32 leaf = o.leaves[it - o.targets.begin()];
+        const int minutes = evaluate(network, o, leaf, excludeRoute, nullptr);
+        if (minutes >= UNREACHABLE) continue;
+        int legs = 0;
+        for (quint32 n = leaf; o.nodeParents[n] != NO_PARENT; n = o.nodeParents[n]) ++legs;
+        if (out.isEmpty() || minutes < out.last().minutes) out.append(Evaluation{ legs, minutes });
+    }
+}
+
+bool TransferPatterns::query(const BusNetwork& network, StopId from, StopId to, int maxTransfers,
+                             QVector<Journey>& out, quint64* evaluated) const
+{
+    if (!covers(from)) return false;
+    QVector<Journey> result;
+    const OriginPatterns& o = origins[from];
+    const auto range = std::equal_range(o.targets.begin(), o.targets.end(), to);
+    for (auto it = range.first; it != range.second; ++it) {
+        Journey j;
+        if (evaluate(network, o, o.leaves[it - o.targets.begin()], -1, &j) >= UNREACHABLE)
+            return false;   // 模式与线网对不上，交给调用方重新搜索
+        if (evaluated) ++*evaluated;
+        if (maxTransfers >= 0 && j.transfers() > maxTransfers) break;
+        // 段数升序，只保留总时间严格更短的，与 RAPTOR 逐轮改进的取法一致
+        if (result.isEmpty() || j.totalMinutes < result.last().totalMinutes) result.append(j);
+    }
+    out = result;
+    return true;
+}
+
+namespace {
+quint64 legKey(StopId a, StopId b) { return (quint64(a) << 32) | b; }
+}
+
+void TransferPatterns::routeChanged(const BusNetwork& network, int route, const QVector<StopId>& oldStops,
+                                    const QVector<int>& oldMinutes)
+{
+    if (origins.isEmpty()) return;
+    // 每条修改各留一版线网，积压太多时不如重算：丢掉全部模式，已算过的起点重新排队
+    if (pending.size() >= MAX_PENDING_EDITS) {
+        for (StopId s = 0; s < StopId(origins.size()); ++s)
+            if (!origins[s].nodeStops.isEmpty() && !requested.contains(s)) requested.append(s);
+        origins.clear();
+        pending.clear();
+        return;
+    }
+    pending.append(Edit{ network, route, oldStops, oldMinutes });
+}
+
+int TransferPatterns::settle()
+{
+    int marked = 0;
+    for (const Edit& edit : std::as_const(pending)) marked += settle(edit);
+    pending.clear();
+    return marked;
+}
+
+// 前面的修改核查完后，未过期的起点对 edit 之前的线网是完整的，于是可以逐条套用单条修改的判断
+int TransferPatterns::settle(const Edit& edit)
+{
+    const BusNetwork& network = edit.network;
+    const QVector<StopId>& oldStops = edit.oldStops;
+    const QVector<int>& oldMinutes = edit.oldMinutes;
+    const int route = edit.route;
+    QVector<bool> onOld(network.stopCount(), false);
+    QVector<bool> onNew(network.stopCount(), false);
+    for (StopId s : oldStops) onOld[s] = true;
+    if (route >= 0 && route < network.routeCount() && !network.isVacant(route)) {
+        const RouteView rv = network.route(route);
+        for (int p = 0; p < rv.stopCount(); ++p) onNew[rv.stopAt(p)] = true;
+    }
+    // 旧线路上任意两站之间的乘车时间（环线取最短的一对位置）；耗时无效的旧线路本来就不能乘
+    QHash<quint64, int> oldLegs;
+    if (oldMinutes.size() == oldStops.size()) {
+        for (int p = 0; p < oldStops.size(); ++p) {
+            for (int q = 0; q < oldStops.size(); ++q) {
+                if (oldStops[p] == oldStops[q]) continue;
+                const quint64 key = legKey(oldStops[p], oldStops[q]);
+                const int minutes = qAbs(oldMinutes[q] - oldMinutes[p]);
+                if (minutes < oldLegs.value(key, UNREACHABLE)) oldLegs.insert(key, minutes);
+            }
+        }
+    }
+
+    int marked = 0;
+    for (StopId s = 0; s < StopId(origins.size()); ++s) {
+        OriginPatterns& o = origins[s];
+        if (o.nodeStops.isEmpty() || o.stale || !affected(network, s, route, onOld, onNew, oldLegs)) continue;
+        o.stale = true;
+        ++marked;
+    }
+    return marked;
+}
+
+bool TransferPatterns::affected(const BusNetwork& network, StopId origin, int route, const QVector<bool>& onOld,
+                                const QVector<bool>& onNew, const QHash<quint64, int>& oldLegs) const
+{
+    if (onOld[origin] || onNew[origin]) return true;
+    const OriginPatterns& o = origins[origin];
+    for (int n = 1; n < o.nodeStops.size(); ++n) {
+        const StopId a = o.nodeStops[o.nodeParents[n]];
+        const StopId b = o.nodeStops[n];
+        if (!onOld[a] || !onOld[b]) continue;
+        const int old = oldLegs.value(legKey(a, b), UNREACHABLE);
+        if (old < UNREACHABLE && directLeg(network, a, b, route, nullptr) > old) return true;
+    }
+
+    if (route < 0 || route >= network.routeCount() || network.isVacant(route)) return false;
+    const RouteView rv = network.route(route);
+    if (!rv.hasTravelTimes()) return false;
+
+    // 新线路上各站现有的前沿（不乘新线路），再模拟在每一站上车、在其余各站下车
+    QVector<QVector<Evaluation>> at(rv.stopCount());
+    for (int p = 0; p < rv.stopCount(); ++p) frontier(network, o, rv.stopAt(p), route, at[p]);
+    for (int p = 0; p < rv.stopCount(); ++p) {
+        for (const Evaluation& board : std::as_const(at[p])) {
+            for (int q = 0; q < rv.stopCount(); ++q) {
+                if (q == p) continue;
+                const Evaluation ride{ board.legs + 1, board.minutes + TRANSFER_MINUTES + rv.travelTime(p, q) };
+                const bool dominated = std::any_of(at[q].begin(), at[q].end(), [&](const Evaluation& e) {
+                    return e.legs <= ride.legs && e.minutes <= ride.minutes;
+                });
+                if (!dominated) return true;
+            }
+        }
+    }
+    return false;
+}
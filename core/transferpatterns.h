@@ -0,0 +1,138 @@
+#ifndef TRANSFERPATTERNS_H
+#define TRANSFERPATTERNS_H
+
+#include "network.h"
+#include "journey.h"
+#include "canceltoken.h"
+#include <QVector>
+#include <QHash>
+#include <QString>
+
+class RaptorPlanner;
+
+// 换乘模式（transfer patterns）：对每个起点预先求出到各站的全部 Pareto 最优方案，
+// 只记下“起点 → 各换乘站 → 终点”的站点序列，不记线路与时间。
+// 查询时取出起终点对应的几个序列，逐段找两站之间最快的直达线路求值，再取 Pareto 集，
+// 结果与 RaptorPlanner::plan() 相同，代价只与模式数和段数有关。
+// 每个起点的模式存成一棵前缀树：节点为站点，只记父节点，到同一换乘站的前缀共用；
+// 另按终点排序记下每个方案的末节点。
+//
+// 只为用得上的起点计算：request() 记下查询过的起点，后台 compute() 只算这些起点和因修改线路而过期的起点。
+// 全部模式占用的内存超过上限时，按最近一次查询的先后淘汰最久没用过的起点，它再被查询时重新排队计算。
+// 算好的模式与数据文件并排存放（bus_routes.json -> bus_routes.json.tp），文件头记录线网指纹
+// （与 LandmarkTable 相同），下次启动时直接读入，线网变化后即视为过期。
+//
+// 求值总是用当前线网的区间耗时。修改一条线路（包括只改耗时）时 routeChanged() 只记下这次修改，
+// 在 settle() 核查之前所有起点都不可用；settle() 找出可能受影响的起点标为过期，其余起点的模式保持有效。
+// 核查与重算都可能很慢，调用方应在后台对副本依次调用 settle()、compute()，再 merge() 回来。
+// 不可用的起点查询时返回 false，调用方改用 RAPTOR。
+class TransferPatterns
+{
+public:
+    static constexpr int TRANSFER_MINUTES = 3;
+    static constexpr qsizetype DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024;
+    static constexpr quint32 FORMAT_VERSION = 1;
+
+    static QString pathFor(const QString& dataFile) { return dataFile + ".tp"; }
+
+    // 为 origins 中的各起点计算模式，每个起点一次一对多 RAPTOR，在调用线程上依次计算；
+    // 应放到低优先级的后台线程，不要占用查询的线程。取消时返回已经算完的起点
+    static TransferPatterns compute(const BusNetwork& network, const QVector<StopId>& origins,
+                                    const CancelToken* cancel = nullptr);
+
+    static constexpr int MAX_PENDING_EDITS = 16;     // 积压的未核查修改超过这么多时直接清空全部模式
+
+    void clear();
+    // 用 other 中已计算的起点（连同过期标记）替换本表的对应起点，并采用 other 的核查进度；
+    // 随后超出内存上限时淘汰最久没被查询的起点。
+    // 两者须基于同一版线网：other 是本表的副本经 settle()/compute() 得到，或是对同一版线网新算、新读入的
+    void merge(const TransferPatterns& other);
+
+    // 写入当前有效的模式（有待核查的修改时返回 false），先写临时文件再替换
+    bool save(const QString& fileName, const BusNetwork& network) const;
+    // 文件存在、格式有效且与 network 的指纹一致时读入并返回 true；否则本表不变。
+    // 读入的起点视为比本表已有的都更早用过
+    bool load(const QString& fileName, const BusNetwork& network, QString* error = nullptr);
+
+    // 记下一次从 origin 出发的查询：已有模式的刷新最近使用时间，没有的排进 wantedOrigins()
+    void request(StopId origin);
+    // 需要（重新）计算的起点：查询过、还没有模式的，和因修改线路而过期的；只含线网中有线路经过的站点
+    QVector<StopId> wantedOrigins(const BusNetwork& network) const;
+
+    // 没有待核查的修改，且 origin 的模式存在、没有过期
+    bool covers(StopId origin) const;
+    bool hasPendingEdits() const { return !pending.isEmpty(); }
+    int originCount() const;
+    // 全部模式占用的字节数（近似）
+    qsizetype memoryBytes() const;
+    void setMemoryLimit(qsizetype bytes) { memoryLimit = bytes; }
+
+    // from 有效时按模式求值，把 (总时间, 换乘次数) 的 Pareto 方案按换乘次数升序写入 out 并返回 true；
+    // 不可达时 out 为空。from 没有有效模式时返回 false，out 不变；evaluated 非空时累加求值的模式数
+    bool query(const BusNetwork& network, StopId from, StopId to, int maxTransfers, QVector<Journey>& out,
+               quint64* evaluated = nullptr) const;
+
+    // 线网中第 route 条线路刚被增量修改（或删除），oldStops 与 oldMinutes 为修改前的站点及首站起的累计分钟数
+    // （新增时都为空；旧线路耗时无效时 oldMinutes 为空）。只记下这次修改与修改后的线网（隐式共享），
+    // 代价与线路长度相当，可以在界面线程上调用
+    void routeChanged(const BusNetwork& network, int route, const QVector<StopId>& oldStops,
+                      const QVector<int>& oldMinutes);
+    // 按先后顺序核查积压的修改，每次修改都把满足以下任一条件的起点标为过期，返回标记的个数：
+    // 1. 起点本身在新旧线路上；
+    // 2. 有模式的某一段两端都在旧线路上，且其他线路都不如旧线路快（这一段原先只能乘它）；
+    // 3. 不乘这条线路时，从到达其上某站的各模式出发乘一段新线路，到达其上另一站的结果
+    //    不被那一站现有的模式（同样不乘它）支配。
+    // 三条都不满足时，原先的最优方案不乘它也同样快，任何用到新线路的方案也都能换成不更差、
+    // 不乘它的已有模式，起点的模式仍然完整。代价与起点数乘以线路站数的平方相当，应在后台调用
+    int settle();
+
+private:
+    // 一次还没核查的修改；network 为修改刚完成时的线网
+    struct Edit {
+        BusNetwork network;
+        int route;
+        QVector<StopId> oldStops;
+        QVector<int> oldMinutes;
+    };
+    struct OriginPatterns {
+        QVector<StopId> nodeStops;      // 节点 0 为起点本身
+        QVector<quint32> nodeParents;   // 父节点下标，根为 NO_PARENT
+        QVector<StopId> targets;        // 升序；同一终点的各方案按段数升序相邻
+        QVector<quint32> leaves;        // 与 targets 同下标：方案末节点
+        bool stale = false;
+    };
+    // 一个方案的求值结果
+    struct Evaluation {
+        int legs;
+        int minutes;
+    };
+    static constexpr quint32 NO_PARENT = 0xFFFFFFFFu;
+    static constexpr int UNREACHABLE = 0x3FFFFFFF;
+
+    static qsizetype bytesOf(const OriginPatterns& o);
+    // 超出内存上限时按 lastUsed 从旧到新淘汰，至少留下最近用过的一个起点
+    void trim();
+
+    static OriginPatterns patternsFrom(const BusNetwork& network, RaptorPlanner& planner, StopId origin,
+                                       const CancelToken* cancel);
+    // 两站之间最快的直达乘车（不乘 excludeRoute），不存在时返回 UNREACHABLE
+    static int directLeg(const BusNetwork& network, StopId a, StopId b, int excludeRoute, JourneyLeg* leg);
+    // 末节点为 leaf 的方案的总时间；journey 非空时同时写出各段
+    static int evaluate(const BusNetwork& network, const OriginPatterns& o, quint32 leaf, int excludeRoute,
+                        Journey* journey);
+    // 不乘 excludeRoute 时 o 到 target 的 Pareto 前沿（段数升序、时间递减）
+    static void frontier(const BusNetwork& network, const OriginPatterns& o, StopId target, int excludeRoute,
+                         QVector<Evaluation>& out);
+    int settle(const Edit& edit);
+    bool affected(const BusNetwork& network, StopId origin, int route, const QVector<bool>& onOld,
+                  const QVector<bool>& onNew, const QHash<quint64, int>& oldLegs) const;
+
+    QVector<OriginPatterns> origins;    // 按起点的 StopId；未计算的为空
+    QVector<Edit> pending;              // 按修改先后
+    QVector<StopId> requested;          // 查询过、还没有模式的起点，不重复
+    QVector<quint64> lastUsed;          // 按起点：最近一次查询的序号，0 表示没查询过
+    quint64 clock = 0;
+    qsizetype memoryLimit = DEFAULT_MEMORY_LIMIT;
+};
+
+#endif // TRANSFERPATTERNS_H
@@ -0,0 +1,61 @@
+#include "utils.h"
+#include <algorithm>
+
+QVector<QString> getStopPath(const Route& route, const QString& start, const QString& end) {
+    int startIndex = route.indexOf(start);
+    int endIndex = route.indexOf(end);
+    if (startIndex == -1 || endIndex == -1) return {};
+
+    if (startIndex < endIndex) {
+        return route.stops.mid(startIndex, endIndex - startIndex + 1);
+    } else {
+        auto reversed = route.stops.mid(endIndex, startIndex - endIndex + 1);
+        std::reverse(reversed.begin(), reversed.end());
+        return reversed;
+    }
+}
+
+int calculateTravelTime(const Route& route, const QString& from, const QString& to)
+{
+    // 编辑用的 Route 不带索引，按线路长度线性查找；查询路径上用 RouteView::travelTime() 的前缀和
+    return route.travelTime(from, to);
+}
+
+QVector<Route> findDirectRoutes(const BusNetwork& network, const QString& start, const QString& end)
+{
+    QVector<Route> found;
+    const StopId startId = network.stopId(start);
+    const StopId endId = network.stopId(end);
+    for (const StopVisit& v : network.visitsAt(startId)) {
+        if (network.positionOf(endId, v.route) != -1)
+            found.append(network.route(v.route).toRoute());
+    }
+    return found;
+}
+
+QVector<TransferPlan> calculateTransfers(const BusNetwork& network,
+                                         const QString& startStop,
+                                         const QString& endStop) {
+    QVector<TransferPlan> results;
+    const StopId startId = network.stopId(startStop);
+    const StopId endId = network.stopId(endStop);
+
+    // 起终点所在线路直接取自倒排索引，两条线路的共同站点取自换乘图
+    for (const StopVisit& sv : network.visitsAt(startId)) {
+        const RouteView r1 = network.route(sv.route);
+        for (const StopVisit& ev : network.visitsAt(endId)) {
+            // 记录按在 r1 上的位置升序，第一条即 r1 上最先到达的换乘点；同一条线路之间没有记录
+            const TransferRange<TransferLink> links = network.transfers().between(int(sv.route), int(ev.route));
+            if (links.isEmpty()) continue;
+            const QString& trans = network.stopName(links.begin()->stop);
+            TransferPlan plan;
+            plan.route1 = r1.toRoute();
+            plan.route2 = network.route(ev.route).toRoute();
+            plan.transferStop = trans;
+            plan.path1 = getStopPath(plan.route1, startStop, trans);
+            plan.path2 = getStopPath(plan.route2, trans, endStop);
+            results.append(plan);
+        }
+    }
+    return results;
+}
@@ -1,7 +1,7 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#include "mainwindow.h"
+#include "network.h"
 #include <QVector>
 
 struct TransferPlan {
@@ -13,7 +13,9 @@ struct TransferPlan {
 };
 
 QVector<QString> getStopPath(const Route& route, const QString& start, const QString& end);
-QVector<TransferPlan> calculateTransfers(const QVector<Route>& routes,
+int calculateTravelTime(const Route& route, const QString& from, const QString& to);
+QVector<Route> findDirectRoutes(const BusNetwork& network, const QString& start, const QString& end);
+QVector<TransferPlan> calculateTransfers(const BusNetwork& network,
                                          const QString& startStop,
                                          const QString& endStop);
 
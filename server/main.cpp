@@ -0,0 +1,71 @@
+#include "routeserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QHostAddress>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("busrouter-server");
+
+    const RouteServer::Options defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "公交线路查询服务。启动时读入一次线网，以 HTTP/JSON 接口提供查询：\n"
+        "  GET  /search?from=起点&to=终点[&at=HH:mm][&k=5][&maxTransfers=n]\n"
+        "  POST /search     请求体 {\"from\",\"to\",\"at\",\"k\",\"maxTransfers\"}\n"
+        "  GET  /route?id=线路编号\n"
+        "  POST /reload     重新读入数据文件，进行中的查询不受影响\n"
+        "  GET  /metrics    Prometheus 文本格式的运行指标\n"
+        "  GET  /health");
+    parser.addHelpOption();
+    QCommandLineOption fileOption({ "f", "file" }, "线路数据文件", "file", defaults.dataFile);
+    QCommandLineOption addressOption("listen", "监听地址（默认只接受本机连接）", "address", "127.0.0.1");
+    QCommandLineOption portOption({ "p", "port" }, "监听端口", "port", "8080");
+    QCommandLineOption threadsOption({ "j", "threads" }, "查询线程数（默认等于 CPU 核数）", "n", "0");
+    QCommandLineOption pendingOption("max-pending", "排队请求数上限，超过时以 503 拒绝", "n",
+                                     QString::number(defaults.maxPending));
+    QCommandLineOption cacheOption("cache", "查询结果缓存的条目数", "n", QString::number(defaults.cacheSize));
+    parser.addOption(fileOption);
+    parser.addOption(addressOption);
+    parser.addOption(portOption);
+    parser.addOption(threadsOption);
+    parser.addOption(pendingOption);
+    parser.addOption(cacheOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    RouteServer::Options options;
+    options.dataFile = parser.value(fileOption);
+    options.threads = parser.value(threadsOption).toInt();
+    options.maxPending = qMax(1, parser.value(pendingOption).toInt());
+    options.cacheSize = qMax(1, parser.value(cacheOption).toInt());
+
+    bool ok = false;
+    const int port = parser.value(portOption).toInt(&ok);
+    if (!ok || port < 0 || port > 65535) {
+        err << "无效的端口：" << parser.value(portOption) << "\n";
+        return 1;
+    }
+    const QHostAddress address(parser.value(addressOption));
+    if (address.isNull()) {
+        err << "无效的监听地址：" << parser.value(addressOption) << "\n";
+        return 1;
+    }
+
+    RouteServer server(options);
+    QString error;
+    if (!server.load(&error)) {
+        err << "无法读取线路数据 " << options.dataFile << "：" << error << "\n";
+        return 1;
+    }
+    if (!server.listen(address, quint16(port))) {
+        err << "无法监听 " << address.toString() << ":" << port << "：" << server.errorString() << "\n";
+        return 1;
+    }
+    err << "正在监听 http://" << address.toString() << ":" << server.port() << "/\n";
+    err.flush();
+    return app.exec();
+}
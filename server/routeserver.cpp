@@ -0,0 +1,402 @@
+#include "routeserver.h"
+#include "routeio.h"
+#include "routejournal.h"
+
+#include <QTcpSocket>
+#include <QPointer>
+#include <QUrlQuery>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QTime>
+#include <QThread>
+
+namespace {
+
+const char* reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    }
+    return "Unknown";
+}
+
+} // namespace
+
+EnginePool::EnginePool(const RouteEngine& engine)
+    : prototype(engine)
+{
+}
+
+std::unique_ptr<RouteEngine> EnginePool::acquire()
+{
+    {
+        QMutexLocker locker(&lock);
+        if (!idle.empty()) {
+            std::unique_ptr<RouteEngine> engine = std::move(idle.back());
+            idle.pop_back();
+            return engine;
+        }
+    }
+    return std::make_unique<RouteEngine>(prototype);
+}
+
+void EnginePool::release(std::unique_ptr<RouteEngine> engine)
+{
+    QMutexLocker locker(&lock);
+    idle.push_back(std::move(engine));
+}
+
+RouteServer::RouteServer(const Options& options, QObject* parent)
+    : QObject(parent), opts(options), cache(options.cacheSize)
+{
+    workers.setMaxThreadCount(opts.threads > 0 ? opts.threads : QThread::idealThreadCount());
+
+    searchSeconds = metrics.histogram("busrouter_server_request_seconds", "请求从收到到生成应答的耗时（秒）",
+                                      "endpoint=\"search\"");
+    routeSeconds = metrics.histogram("busrouter_server_request_seconds", "", "endpoint=\"route\"");
+    reloadSeconds = metrics.histogram("busrouter_server_request_seconds", "", "endpoint=\"reload\"");
+    requestErrors = metrics.counter("busrouter_server_errors_total", "以 4xx/5xx 应答的请求数");
+    rejected = metrics.counter("busrouter_server_rejected_total", "排队请求过多、直接以 503 拒绝的请求数");
+    reloads = metrics.counter("busrouter_server_reloads_total", "成功重新加载线网的次数");
+    pendingGauge = metrics.gauge("busrouter_server_pending", "已收到还没应答的查询数");
+    connectionGauge = metrics.gauge("busrouter_server_connections", "当前连接数");
+    cacheHits = metrics.counter("busrouter_query_cache_hits_total", "查询结果缓存命中数");
+    cacheMisses = metrics.counter("busrouter_query_cache_misses_total", "查询结果缓存未命中数");
+    routeGauge = metrics.gauge("busrouter_routes", "当前线路条数");
+
+    connect(&server, &QTcpServer::newConnection, this, &RouteServer::onNewConnection);
+}
+
+RouteServer::~RouteServer()
+{
+    // 工作线程完成后投递回来的应答随本对象一起丢弃
+    server.close();
+    workers.waitForDone();
+}
+
+bool RouteServer::loadEngine(const QString& dataFile, RouteEngine& engine, QString* error)
+{
+    // 与命令行工具相同：快照或 JSON，再重放界面还没写回数据文件的修改日志
+    BusNetwork network;
+    if (!RouteJournal::load(dataFile, network, nullptr, error)) return false;
+    engine.setNetwork(network);
+    engine.prepareLandmarks(dataFile);     // 各副本共用，前 k 方案不必每次从终点做 Dijkstra
+    return true;
+}
+
+bool RouteServer::load(QString* error)
+{
+    RouteEngine engine;
+    if (!loadEngine(opts.dataFile, engine, error)) return false;
+    routeGauge->set(engine.network().routeCount());
+    QMutexLocker locker(&poolLock);
+    pool = std::make_shared<EnginePool>(engine);
+    return true;
+}
+
+bool RouteServer::listen(const QHostAddress& address, quint16 port)
+{
+    return server.listen(address, port);
+}
+
+std::shared_ptr<EnginePool> RouteServer::currentPool() const
+{
+    QMutexLocker locker(&poolLock);
+    return pool;
+}
+
+void RouteServer::onNewConnection()
+{
+    while (server.hasPendingConnections()) {
+        QTcpSocket* socket = server.nextPendingConnection();
+        connections.insert(socket, Connection());
+        connectionGauge->add(1);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket] { readRequests(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket] {
+            connections.remove(socket);
+            connectionGauge->add(-1);
+            socket->deleteLater();
+        });
+    }
+}
+
+void RouteServer::readRequests(QTcpSocket* socket)
+{
+    auto it = connections.find(socket);
+    if (it == connections.end()) return;
+    Connection& conn = it.value();
+    conn.buffer += socket->readAll();
+    if (conn.busy) return;       // 上一条还没应答，应答后再接着解析
+
+    HttpRequest request;
+    const int status = takeRequest(conn.buffer, request);
+    if (status == 0) return;
+    conn.busy = true;
+    if (status != 200) {
+        // 请求格式有误时无法确定下一条从哪里开始，应答后关闭连接
+        conn.buffer.clear();
+        send(socket, error(status, QString("无法解析的请求（%1）").arg(status)), false);
+        return;
+    }
+    dispatch(socket, request);
+}
+
+int RouteServer::takeRequest(QByteArray& buffer, HttpRequest& request) const
+{
+    const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) return buffer.size() > MAX_HEADER_BYTES ? 431 : 0;
+    if (headerEnd > MAX_HEADER_BYTES) return 431;
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine[2].startsWith("HTTP/1.")) return 400;
+    request.method = requestLine[0];
+    const QByteArray& target = requestLine[1];
+    const qsizetype q = target.indexOf('?');
+    request.path = q < 0 ? target : target.left(q);
+    request.query = q < 0 ? QByteArray() : target.mid(q + 1);
+    request.keepAlive = requestLine[2] == "HTTP/1.1";
+
+    qint64 length = 0;
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const QByteArray& line = lines[i];
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed().toLower();
+        if (name == "content-length") {
+            bool ok = false;
+            length = value.toLongLong(&ok);
+            if (!ok || length < 0) return 400;
+        } else if (name == "transfer-encoding") {
+            return 501;     // 请求体都很小，不支持分块传输
+        } else if (name == "connection") {
+            if (value == "close") request.keepAlive = false;
+            else if (value == "keep-alive") request.keepAlive = true;
+        }
+    }
+    if (length > MAX_BODY_BYTES) return 413;
+    const qint64 total = headerEnd + 4 + length;
+    if (buffer.size() < total) return 0;
+    request.body = buffer.mid(headerEnd + 4, length);
+    buffer.remove(0, total);
+    return 200;
+}
+
+void RouteServer::dispatch(QTcpSocket* socket, const HttpRequest& request)
+{
+    // 存活检查与指标都很便宜，直接在主线程应答，繁忙时也能拿到
+    if (request.path == "/health") {
+        send(socket, HttpResponse{ 200, "text/plain; charset=utf-8", "ok\n" }, request.keepAlive);
+        return;
+    }
+    if (request.path == "/metrics") {
+        send(socket, metricsText(), request.keepAlive);
+        return;
+    }
+    if (pending >= opts.maxPending) {
+        rejected->add();
+        send(socket, error(503, "服务繁忙，请稍后重试"), request.keepAlive);
+        return;
+    }
+
+    ++pending;
+    pendingGauge->set(pending);
+    QPointer<QTcpSocket> target = socket;
+    workers.start([this, target, request] {
+        const HttpResponse response = handle(request);
+        QMetaObject::invokeMethod(this, [this, target, response, keepAlive = request.keepAlive] {
+            --pending;
+            pendingGauge->set(pending);
+            if (target) send(target, response, keepAlive);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RouteServer::send(QTcpSocket* socket, const HttpResponse& response, bool keepAlive)
+{
+    if (response.status >= 400) requestErrors->add();
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    head += "Content-Type: " + response.contentType + "\r\n";
+    head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    head += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    socket->write(head + response.body);
+
+    if (!keepAlive) {
+        connections.remove(socket);
+        socket->disconnectFromHost();
+        return;
+    }
+    auto it = connections.find(socket);
+    if (it == connections.end()) return;
+    it.value().busy = false;
+    // 客户端可能已经把后面的请求一并发来了（流水线）
+    if (!it.value().buffer.isEmpty()) readRequests(socket);
+}
+
+HttpResponse RouteServer::error(int status, const QString& message)
+{
+    QString text = QLatin1String("{\"error\":");
+    PlanRenderer::appendJsonString(text, message);
+    text += '}';
+    return HttpResponse{ status, "application/json; charset=utf-8", text.toUtf8() };
+}
+
+HttpResponse RouteServer::handle(const HttpRequest& request)
+{
+    if (request.path == "/search") {
+        QString start, end, at;
+        int k = 5;
+        int maxTransfers = -1;
+        if (request.method == "GET") {
+            const QUrlQuery q(QString::fromUtf8(request.query));
+            start = q.queryItemValue("from", QUrl::FullyDecoded);
+            end = q.queryItemValue("to", QUrl::FullyDecoded);
+            at = q.queryItemValue("at", QUrl::FullyDecoded);
+            bool ok = true;
+            if (q.hasQueryItem("k")) k = q.queryItemValue("k").toInt(&ok);
+            if (ok && q.hasQueryItem("maxTransfers")) maxTransfers = q.queryItemValue("maxTransfers").toInt(&ok);
+            if (!ok) return error(400, "k 与 maxTransfers 应为整数");
+        } else if (request.method == "POST") {
+            const QJsonDocument doc = QJsonDocument::fromJson(request.body);
+            if (!doc.isObject()) return error(400, "请求体应为 JSON 对象");
+            const QJsonObject obj = doc.object();
+            start = obj["from"].toString();
+            end = obj["to"].toString();
+            at = obj["at"].toString();
+            k = obj["k"].toInt(k);
+            maxTransfers = obj["maxTransfers"].toInt(maxTransfers);
+        } else {
+            return error(405, "/search 只接受 GET 或 POST");
+        }
+        QElapsedTimer timer;
+        timer.start();
+        HttpResponse response = search(start.trimmed(), end.trimmed(), at.trimmed(), k, maxTransfers);
+        searchSeconds->observe(timer.nsecsElapsed());
+        return response;
+    }
+    if (request.path == "/route") {
+        if (request.method != "GET") return error(405, "/route 只接受 GET");
+        QElapsedTimer timer;
+        timer.start();
+        const QUrlQuery q(QString::fromUtf8(request.query));
+        HttpResponse response = routeById(q.queryItemValue("id", QUrl::FullyDecoded).trimmed());
+        routeSeconds->observe(timer.nsecsElapsed());
+        return response;
+    }
+    if (request.path == "/reload") {
+        if (request.method != "POST") return error(405, "/reload 只接受 POST");
+        QElapsedTimer timer;
+        timer.start();
+        HttpResponse response = reload();
+        reloadSeconds->observe(timer.nsecsElapsed());
+        return response;
+    }
+    return error(404, "未知的路径：" + QString::fromUtf8(request.path));
+}
+
+HttpResponse RouteServer::search(const QString& start, const QString& end, const QString& at, int k, int maxTransfers)
+{
+    if (start.isEmpty() || end.isEmpty()) return error(400, "缺少起点或终点（from、to）");
+    if (k < 1 || k > MAX_PLANS) return error(400, QString("k 应在 1~%1 之间").arg(MAX_PLANS));
+    int departMinutes = -1;
+    if (!at.isEmpty()) {
+        const QTime t = QTime::fromString(at, "HH:mm");
+        if (!t.isValid()) return error(400, "出发时间格式应为 HH:mm：" + at);
+        departMinutes = t.hour() * 60 + t.minute();
+    }
+
+    // 先取缓存代数再取线网：重新加载先换线网、后清缓存，这样拿到旧线网时代数必然也是旧的，结果不会写进缓存
+    const quint64 generation = cache.generation();
+    const std::shared_ptr<EnginePool> version = currentPool();
+    const BusNetwork& net = version->network();
+    for (const QString& stop : { start, end })
+        if (net.stopId(stop) == INVALID_STOP) return error(404, "未知站点：" + stop);
+    if (start == end) return error(400, "起点与终点相同，无需乘车。");
+
+    const QString key = QueryCache::key(start, end, departMinutes >= 0 ? "at " + at
+                                                                       : QString("top %1 %2").arg(k).arg(maxTransfers));
+    QString text;
+    if (cache.lookup(key, text)) return HttpResponse{ 200, "application/json; charset=utf-8", text.toUtf8() };
+
+    std::unique_ptr<RouteEngine> engine = version->acquire();
+    QVector<Journey> journeys;
+    if (departMinutes >= 0) {
+        const Journey j = engine->searchAt(start, end, departMinutes);
+        if (!j.legs.isEmpty()) journeys.append(j);
+    } else {
+        journeys = engine->searchTopK(start, end, k, maxTransfers);
+    }
+    version->release(std::move(engine));
+
+    // 与 busrouter-cli --format json 的每行输出相同
+    text = QLatin1String("{\"from\":");
+    PlanRenderer::appendJsonString(text, start);
+    text += QLatin1String(",\"to\":");
+    PlanRenderer::appendJsonString(text, end);
+    text += QLatin1String(",\"journeys\":");
+    renderer.renderPlans(text, net, journeys, start, end);
+    text += '}';
+    cache.insert(key, generation, text, net, start, end, journeys);
+    return HttpResponse{ 200, "application/json; charset=utf-8", text.toUtf8() };
+}
+
+HttpResponse RouteServer::routeById(const QString& id)
+{
+    if (id.isEmpty()) return error(400, "缺少线路编号（id）");
+    const std::shared_ptr<EnginePool> version = currentPool();
+    const int index = version->network().routeIndex(id);
+    if (index < 0) return error(404, "未找到线路：" + id);
+    const QByteArray body = QJsonDocument(routeToJson(version->network().route(index).toRoute()))
+                                .toJson(QJsonDocument::Compact);
+    return HttpResponse{ 200, "application/json; charset=utf-8", body };
+}
+
+HttpResponse RouteServer::reload()
+{
+    if (!reloading.testAndSetAcquire(0, 1)) return error(409, "已有一次重新加载正在进行");
+
+    // 读入和编译都在这个工作线程里完成，期间其他查询照常用旧线网
+    RouteEngine engine;
+    QString message;
+    const bool ok = loadEngine(opts.dataFile, engine, &message);
+    if (ok) {
+        auto next = std::make_shared<EnginePool>(engine);
+        {
+            QMutexLocker locker(&poolLock);
+            pool = next;
+        }
+        cache.clear();
+        reloads->add();
+        routeGauge->set(engine.network().routeCount());
+    }
+    reloading.storeRelease(0);
+    if (!ok) return error(500, "无法读取线路数据 " + opts.dataFile + "：" + message);
+
+    const BusNetwork& net = engine.network();
+    int stops = 0;
+    for (int s = 0; s < net.stopCount(); ++s)
+        if (net.stopInUse(StopId(s))) ++stops;
+    const QByteArray body = QString("{\"routes\":%1,\"stops\":%2}").arg(net.routeCount()).arg(stops).toUtf8();
+    return HttpResponse{ 200, "application/json; charset=utf-8", body };
+}
+
+HttpResponse RouteServer::metricsText()
+{
+    // 缓存自己的统计只增不减，导出前按差额补到计数器上
+    const QueryCacheStats st = cache.stats();
+    cacheHits->add(st.hits - cacheHits->load());
+    cacheMisses->add(st.misses - cacheMisses->load());
+    return HttpResponse{ 200, "text/plain; version=0.0.4; charset=utf-8", metrics.toPrometheus() };
+}
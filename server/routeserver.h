@@ -0,0 +1,137 @@
+#ifndef ROUTESERVER_H
+#define ROUTESERVER_H
+
+#include "routeengine.h"
+#include "planrenderer.h"
+#include "querycache.h"
+#include "metrics.h"
+#include <QObject>
+#include <QTcpServer>
+#include <QThreadPool>
+#include <QHostAddress>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <memory>
+#include <vector>
+
+class QTcpSocket;
+
+// 一条 HTTP 请求中查询用得到的部分
+struct HttpRequest {
+    QByteArray method;
+    QByteArray path;        // 不含查询串
+    QByteArray query;       // "?" 之后的部分（未解码）
+    QByteArray body;
+    bool keepAlive = true;
+};
+
+struct HttpResponse {
+    int status = 200;
+    QByteArray contentType = "application/json; charset=utf-8";
+    QByteArray body;
+};
+
+// 某一版线网及其查询引擎池。RouteEngine 持有可复用的临时数组，
+// 用完放回池里给下一个请求，避免每次查询都按站点数重新分配；池中引擎数不超过同时进行的查询数。
+// 重新加载时整体换成新的一份，正在进行的查询拿着旧版本的引用照常完成
+class EnginePool
+{
+public:
+    explicit EnginePool(const RouteEngine& engine);
+
+    const BusNetwork& network() const { return prototype.network(); }
+    std::unique_ptr<RouteEngine> acquire();
+    void release(std::unique_ptr<RouteEngine> engine);
+
+private:
+    RouteEngine prototype;      // 只用来复制，线网与时刻表在各副本间隐式共享
+    QMutex lock;
+    std::vector<std::unique_ptr<RouteEngine>> idle;
+};
+
+// 无界面的查询服务：启动时读入一次线网，在本机地址上以 HTTP/1.1 提供 JSON 接口：
+//   GET  /search?from=起点&to=终点[&at=HH:mm][&k=5][&maxTransfers=n]   与图形界面相同的查询
+//   POST /search   请求体 {"from","to","at","k","maxTransfers"}，字段含义同上
+//   GET  /route?id=线路编号                                             线路详情
+//   POST /reload   重新读入数据文件，读完后原子地换上新线网
+//   GET  /metrics  Prometheus 文本格式的运行指标；GET /health 存活检查
+// 连接的读写都在主线程的事件循环里，查询交给线程池；同一连接上的请求按顺序应答（支持 keep-alive 与流水线）。
+// 排队的请求超过上限时直接回 503，而不是让所有请求的延迟一起变长
+class RouteServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString dataFile = "bus_routes.json";
+        int threads = 0;                // <= 0 时使用 QThread::idealThreadCount()
+        int maxPending = 1024;          // 已收到还没应答的请求数上限
+        int cacheSize = 4096;           // 查询结果缓存的条目数
+    };
+
+    static constexpr int MAX_HEADER_BYTES = 16 * 1024;
+    static constexpr int MAX_BODY_BYTES = 1024 * 1024;
+    static constexpr int MAX_PLANS = 20;
+
+    explicit RouteServer(const Options& options, QObject* parent = nullptr);
+    ~RouteServer() override;
+
+    // 读入线网（启动时同步调用一次）
+    bool load(QString* error = nullptr);
+    bool listen(const QHostAddress& address, quint16 port);
+    quint16 port() const { return server.serverPort(); }
+    QString errorString() const { return server.errorString(); }
+
+private:
+    struct Connection {
+        QByteArray buffer;      // 已收到、尚未解析的数据
+        bool busy = false;      // 有请求正在处理；处理完再解析下一条
+    };
+
+    void onNewConnection();
+    void readRequests(QTcpSocket* socket);
+    // 从缓冲区头部取出一条完整的请求并返回 200；数据还不够时返回 0，请求有误时返回应回复的错误码
+    int takeRequest(QByteArray& buffer, HttpRequest& request) const;
+    void dispatch(QTcpSocket* socket, const HttpRequest& request);
+    void send(QTcpSocket* socket, const HttpResponse& response, bool keepAlive);
+    HttpResponse metricsText();
+
+    // 以下在工作线程中执行
+    HttpResponse handle(const HttpRequest& request);
+    HttpResponse search(const QString& start, const QString& end, const QString& at, int k, int maxTransfers);
+    HttpResponse routeById(const QString& id);
+    HttpResponse reload();
+
+    static bool loadEngine(const QString& dataFile, RouteEngine& engine, QString* error);
+    static HttpResponse error(int status, const QString& message);
+    std::shared_ptr<EnginePool> currentPool() const;
+
+    Options opts;
+    QTcpServer server;
+    QThreadPool workers;
+    QHash<QTcpSocket*, Connection> connections;
+
+    mutable QMutex poolLock;            // 只保护 pool 指针本身的读写
+    std::shared_ptr<EnginePool> pool;
+    QAtomicInt reloading;
+    int pending = 0;                    // 只在主线程读写
+
+    PlanRenderer renderer{PlanRenderer::Json};     // 片段缓存加锁，各工作线程共用
+    QueryCache cache;
+
+    MetricsRegistry metrics;
+    MetricHistogram* searchSeconds;
+    MetricHistogram* routeSeconds;
+    MetricHistogram* reloadSeconds;
+    MetricCounter* requestErrors;
+    MetricCounter* rejected;
+    MetricCounter* reloads;
+    MetricGauge* pendingGauge;
+    MetricGauge* connectionGauge;
+    MetricCounter* cacheHits;
+    MetricCounter* cacheMisses;
+    MetricGauge* routeGauge;
+};
+
+#endif // ROUTESERVER_H
@@ -0,0 +1,20 @@
+# 查询服务：无界面常驻进程，以本机 HTTP/JSON 接口提供与图形界面相同的查询
+QT = core network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = busrouter-server
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp \
+    routeserver.cpp
+
+HEADERS += \
+    routeserver.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target